@@ -0,0 +1,174 @@
+#include "clock.h"
+
+#if TRAM8_CLOCK
+
+#include <util/atomic.h>
+
+#include "../../protocol/tram8_sysex.h"
+#include "eeprom_queue.h"
+#include "gpio.h"
+#include "trigger.h"
+
+// Longest clock interval that still counts towards the tempo estimate
+#define PERIOD_MAX_MS 250
+
+static uint8_t div_mask = 0;
+static uint8_t run_mask = 0;
+static uint8_t reset_mask = 0;
+static uint8_t running = 0;
+static uint8_t count[NUM_GATES];
+static uint8_t offbeat = 0; // next pulse on this gate is the swung one
+static uint16_t last_clock = 0;
+static uint16_t period_q4 = 20 << 4; // ms per clock in 1/16 ms, 125 BPM until measured
+
+static volatile uint16_t now = 0;
+static volatile uint8_t delayed = 0;
+static volatile uint16_t delay_left[NUM_GATES];
+
+static void load(void) {
+  div_mask = 0;
+  run_mask = 0;
+  reset_mask = 0;
+  for (uint8_t g = 0; g < NUM_GATES; g++) {
+    uint8_t role = eeprom_queue_read(EEPROM_CLOCK_DIV_ADDR + g);
+    uint8_t bit = (uint8_t)(1 << g);
+    if (role == TRAM8_CLOCK_RUN)
+      run_mask |= bit;
+    else if (role == TRAM8_CLOCK_RESET)
+      reset_mask |= bit;
+    else if (role >= 1 && role <= TRAM8_CLOCK_DIV_MAX)
+      div_mask |= bit;
+  }
+  trigger_set_clocked(div_mask | run_mask | reset_mask);
+  gate_set_claimed(run_mask, running ? run_mask : 0);
+}
+
+void clock_init(void) {
+  load();
+}
+
+void clock_config(uint8_t gate, uint8_t divider, uint8_t swing) {
+  if (gate >= NUM_GATES)
+    return;
+  eeprom_queue_write(EEPROM_CLOCK_DIV_ADDR + gate, divider & 0x7F);
+  eeprom_queue_write(EEPROM_CLOCK_SWING_ADDR + gate, swing & 0x7F);
+
+  uint8_t bit = (uint8_t)(1 << gate);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    delayed &= (uint8_t)~bit;
+  }
+  count[gate] = 0;
+  offbeat &= (uint8_t)~bit;
+  load();
+}
+
+// Delay of a swung pulse: the part of the step past the straight 50%
+static uint16_t swing_delay(uint8_t gate, uint8_t divider) {
+  uint8_t swing = eeprom_queue_read(EEPROM_CLOCK_SWING_ADDR + gate);
+  if (swing <= 50 || swing > 100) // straight, or erased EEPROM
+    return 0;
+  if (swing > TRAM8_CLOCK_SWING_MAX)
+    swing = TRAM8_CLOCK_SWING_MAX;
+  uint32_t q4 = (uint32_t)period_q4 * divider * (uint8_t)(swing - 50) / 50;
+  return (uint16_t)((q4 + 8) >> 4);
+}
+
+static void on_clock(void) {
+  uint16_t t;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    t = now;
+  }
+  uint16_t dt = (uint16_t)(t - last_clock);
+  last_clock = t;
+  if (dt <= PERIOD_MAX_MS) // a gap in the clock is not a tempo change
+    period_q4 = (uint16_t)(period_q4 + (((int16_t)(dt << 4) - (int16_t)period_q4 + 2) >> 2));
+
+  if (!running)
+    return;
+
+  uint8_t fire = 0;
+  uint8_t gates = div_mask;
+  for (uint8_t g = 0; gates; g++, gates >>= 1) {
+    if (!(gates & 1))
+      continue;
+    uint8_t bit = (uint8_t)(1 << g);
+    uint8_t divider = eeprom_queue_read(EEPROM_CLOCK_DIV_ADDR + g);
+
+    if (count[g] == 0) {
+      uint16_t delay = (offbeat & bit) ? swing_delay(g, divider) : 0;
+      offbeat ^= bit;
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (delayed & bit) // tempo jumped: the late pulse goes out now
+          fire |= bit;
+        if (delay) {
+          delay_left[g] = delay;
+          delayed |= bit;
+        } else {
+          delayed &= (uint8_t)~bit;
+          fire |= bit;
+        }
+      }
+    }
+    if (++count[g] >= divider)
+      count[g] = 0;
+  }
+  trigger_pulse(fire);
+}
+
+static void start(void) {
+  for (uint8_t g = 0; g < NUM_GATES; g++)
+    count[g] = 0;
+  offbeat = 0;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    delayed = 0;
+  }
+  running = 1;
+  trigger_pulse(reset_mask);
+  gate_set_claimed(run_mask, run_mask);
+}
+
+void clock_realtime(uint8_t byte) {
+  switch (byte) {
+    case 0xF8:
+      on_clock();
+      break;
+    case 0xFA:
+      start();
+      break;
+    case 0xFB:
+      running = 1;
+      gate_set_claimed(run_mask, run_mask);
+      break;
+    case 0xFC:
+      clock_reset();
+      break;
+    default:
+      break;
+  }
+}
+
+void clock_reset(void) {
+  running = 0;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    delayed = 0;
+  }
+  gate_set_claimed(run_mask, 0);
+}
+
+uint8_t clock_running(void) {
+  return running;
+}
+
+void clock_tick(void) {
+  now++;
+  uint8_t live = delayed;
+  for (uint8_t g = 0; live; g++, live >>= 1) {
+    if (!(live & 1) || --delay_left[g])
+      continue;
+    uint8_t bit = (uint8_t)(1 << g);
+    delayed &= (uint8_t)~bit;
+    trigger_pulse(bit);
+  }
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+#include "hardware_config.h"
+
+// Clock outputs generated from MIDI real-time bytes. Each gate can pulse
+// every N clocks of 24 PPQN (with optional swing), follow the transport
+// (run), or pulse on start (reset). Edges go out through the trigger
+// module, so the timer sets the pulse width rather than the host.
+// Built in with TRAM8_CLOCK; without it these are no-ops.
+
+#if TRAM8_CLOCK
+
+// Loads the gate roles from the EEPROM image
+void clock_init(void);
+
+// divider is TRAM8_CLOCK_OFF, 1-TRAM8_CLOCK_DIV_MAX, TRAM8_CLOCK_RUN or
+// TRAM8_CLOCK_RESET; swing is in percent (queued EEPROM write)
+void clock_config(uint8_t gate, uint8_t divider, uint8_t swing);
+
+// Feeds one real-time byte (F8 clock, FA start, FB continue, FC stop)
+void clock_realtime(uint8_t byte);
+
+// Stops the transport and drops any swung pulse still waiting
+void clock_reset(void);
+
+uint8_t clock_running(void);
+
+// Timer ISR, once per tick
+void clock_tick(void);
+
+#else
+
+static inline void clock_init(void) {}
+
+static inline void clock_config(uint8_t gate, uint8_t divider, uint8_t swing) {
+  (void)gate;
+  (void)divider;
+  (void)swing;
+}
+
+static inline void clock_realtime(uint8_t byte) {
+  (void)byte;
+}
+
+static inline void clock_reset(void) {}
+
+static inline uint8_t clock_running(void) {
+  return 0;
+}
+
+static inline void clock_tick(void) {}
+
+#endif
+
+#endif
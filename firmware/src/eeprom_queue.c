@@ -0,0 +1,98 @@
+#include "eeprom_queue.h"
+
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+static uint8_t image[EEPROM_IMAGE_SIZE];
+static volatile uint8_t dirty[(EEPROM_IMAGE_SIZE + 7) / 8];
+static volatile uint8_t cursor = 0;
+
+#define RUN1_INDEX EEPROM_RUN0_SIZE
+#define RUN2_INDEX (EEPROM_RUN0_SIZE + EEPROM_RUN1_SIZE)
+#define NOT_MIRRORED 0xFF
+
+// Image slot of an EEPROM address, NOT_MIRRORED for gaps and outside
+static uint8_t image_index(uint16_t addr) {
+  if (addr >= EEPROM_RUN0_ADDR && addr < EEPROM_RUN0_ADDR + EEPROM_RUN0_SIZE)
+    return (uint8_t)(addr - EEPROM_RUN0_ADDR);
+  if (addr >= EEPROM_RUN1_ADDR && addr < EEPROM_RUN1_ADDR + EEPROM_RUN1_SIZE)
+    return (uint8_t)(RUN1_INDEX + addr - EEPROM_RUN1_ADDR);
+  if (addr >= EEPROM_RUN2_ADDR && addr < EEPROM_RUN2_ADDR + EEPROM_RUN2_SIZE)
+    return (uint8_t)(RUN2_INDEX + addr - EEPROM_RUN2_ADDR);
+  return NOT_MIRRORED;
+}
+
+static uint16_t image_addr(uint8_t i) {
+  if (i < RUN1_INDEX)
+    return EEPROM_RUN0_ADDR + i;
+  if (i < RUN2_INDEX)
+    return EEPROM_RUN1_ADDR + (i - RUN1_INDEX);
+  return EEPROM_RUN2_ADDR + (i - RUN2_INDEX);
+}
+
+void eeprom_queue_init(void) {
+  eeprom_busy_wait();
+  eeprom_read_block(image, (const void*)(uintptr_t)EEPROM_RUN0_ADDR, EEPROM_RUN0_SIZE);
+  eeprom_read_block(&image[RUN1_INDEX], (const void*)(uintptr_t)EEPROM_RUN1_ADDR, EEPROM_RUN1_SIZE);
+  eeprom_read_block(&image[RUN2_INDEX], (const void*)(uintptr_t)EEPROM_RUN2_ADDR, EEPROM_RUN2_SIZE);
+}
+
+uint8_t eeprom_queue_read(uint16_t addr) {
+  uint8_t i = image_index(addr);
+  return i == NOT_MIRRORED ? 0xFF : image[i];
+}
+
+void eeprom_queue_read_block(void* dst, uint16_t addr, uint8_t len) {
+  uint8_t* out = (uint8_t*)dst;
+  for (uint8_t i = 0; i < len; i++)
+    out[i] = eeprom_queue_read(addr + i);
+}
+
+void eeprom_queue_write(uint16_t addr, uint8_t value) {
+  uint8_t i = image_index(addr);
+  if (i == NOT_MIRRORED || image[i] == value)
+    return;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    image[i] = value;
+    dirty[i >> 3] |= (uint8_t)(1 << (i & 7));
+    EECR |= (1 << EERIE); // fires as soon as the EEPROM is ready
+  }
+}
+
+void eeprom_queue_write_block(const void* src, uint16_t addr, uint8_t len) {
+  const uint8_t* in = (const uint8_t*)src;
+  for (uint8_t i = 0; i < len; i++)
+    eeprom_queue_write(addr + i, in[i]);
+}
+
+uint8_t eeprom_queue_busy(void) {
+  return (EECR & ((1 << EERIE) | (1 << EEWE))) != 0;
+}
+
+// Programs the next dirty byte, scanning on from the last one written
+ISR(EE_RDY_vect) {
+  for (uint8_t n = 0; n < EEPROM_IMAGE_SIZE; n++) {
+    uint8_t i = cursor;
+    cursor = (i + 1 < EEPROM_IMAGE_SIZE) ? i + 1 : 0;
+
+    uint8_t bit = (uint8_t)(1 << (i & 7));
+    if (!(dirty[i >> 3] & bit))
+      continue;
+    dirty[i >> 3] &= (uint8_t)~bit;
+
+    uint16_t addr = image_addr(i);
+    if (eeprom_read_byte((const uint8_t*)(uintptr_t)addr) == image[i])
+      continue; // already holds the value, spare the cell
+
+    EEAR = addr;
+    EEDR = image[i];
+    EECR |= (1 << EEMWE);
+    EECR |= (1 << EEWE);
+    return;
+  }
+
+  EECR &= (uint8_t)~(1 << EERIE);
+}
@@ -0,0 +1,40 @@
+#ifndef EEPROM_QUEUE_H
+#define EEPROM_QUEUE_H
+
+#include <stdint.h>
+
+#include "hardware_config.h"
+
+// RAM image of the settings block. Reads come from the image; writes update
+// it and mark bytes dirty, and the EE_RDY interrupt programs them one at a
+// time in the background (~3.3 ms each) so a save never stalls the MIDI loop.
+//
+// Only the three runs that hold settings are mirrored, not the unused gaps
+// between them: channel and note map, mode, then calibration through the
+// gate map. Addresses in a gap read 0xFF and ignore writes.
+#define EEPROM_RUN0_ADDR EEPROM_CHANNEL_ADDR
+#define EEPROM_RUN0_SIZE (1 + NUM_GATES)
+#define EEPROM_RUN1_ADDR EEPROM_MODE_ADDR
+#define EEPROM_RUN1_SIZE 1
+#define EEPROM_RUN2_ADDR EEPROM_CAL_ADDR
+#define EEPROM_RUN2_SIZE (EEPROM_MAP_CHANNEL_ADDR + EEPROM_MAP_SIZE - EEPROM_CAL_ADDR)
+
+#define EEPROM_IMAGE_BASE EEPROM_RUN0_ADDR
+#define EEPROM_IMAGE_END (EEPROM_RUN2_ADDR + EEPROM_RUN2_SIZE)
+#define EEPROM_IMAGE_SIZE (EEPROM_RUN0_SIZE + EEPROM_RUN1_SIZE + EEPROM_RUN2_SIZE)
+
+// Loads the image from EEPROM (blocking, only at startup)
+void eeprom_queue_init(void);
+
+// addr is an absolute EEPROM address inside the image
+uint8_t eeprom_queue_read(uint16_t addr);
+void eeprom_queue_read_block(void* dst, uint16_t addr, uint8_t len);
+
+// Bytes equal to what the image already holds are not rewritten
+void eeprom_queue_write(uint16_t addr, uint8_t value);
+void eeprom_queue_write_block(const void* src, uint16_t addr, uint8_t len);
+
+// True while dirty bytes are waiting or a write is in progress
+uint8_t eeprom_queue_busy(void);
+
+#endif
@@ -2,10 +2,16 @@
 
 #include <avr/eeprom.h>
 #include <avr/io.h>
+#include <util/atomic.h>
 #include <util/delay.h>
 
-// Gate polarity: 1 = active high (v1.2+), 0 = active low (v1.1)
-static uint8_t gate_active_high = 1;
+// Gate polarity, XORed into every port write: 0x00 = active high (v1.2+), 0xFF = active low (v1.1)
+static uint8_t gate_polarity = 0x00;
+// Logical gate state, bit n = gate n
+static volatile uint8_t gate_state = 0;
+#if TRAM8_TRIGGER
+static volatile uint8_t gate_claimed = 0;
+#endif
 
 static void detect_hardware_version(void) {
   VERSION_DDR &= ~(1 << VERSION_PIN); // Input
@@ -14,10 +20,10 @@ static void detect_hardware_version(void) {
 
   if (VERSION_PIN_REG & (1 << VERSION_PIN)) {
     // v1.1 - PB1 floating/high, has inverters, ACTIVE LOW
-    gate_active_high = 0;
+    gate_polarity = 0xFF;
   } else {
     // v1.2+ - PB1 tied to GND, no inverters, ACTIVE HIGH
-    gate_active_high = 1;
+    gate_polarity = 0x00;
   }
 }
 
@@ -56,28 +62,52 @@ uint8_t read_button(void) {
   return BUTTON_PIN_REG & (1 << BUTTON_PIN);
 }
 
-void gate_set(uint8_t gate_index, uint8_t state) {
-  if (gate_index >= NUM_GATES) {
-    return;
+// Gate 0 is PB0 and gates 1-7 are PD1-PD7, so the mask maps onto the two
+// ports bit for bit. PD0 is the UART RX pin and is left alone.
+static inline void gate_write_ports(uint8_t mask) {
+  uint8_t hw = mask ^ gate_polarity;
+  gate_state = mask;
+  GATE_PORT_B = (uint8_t)((GATE_PORT_B & ~(1 << GATE_PIN_0)) | (hw & 0x01));
+  GATE_PORT_D = (uint8_t)((GATE_PORT_D & 0x01) | (hw & 0xFE));
+}
+
+#if TRAM8_TRIGGER
+void gate_set_mask(uint8_t mask) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    gate_write_ports((uint8_t)((gate_state & gate_claimed) | (mask & ~gate_claimed)));
   }
+}
+
+void gate_claim(uint8_t mask) {
+  gate_claimed = mask;
+}
 
-  // Invert state for v1.1 hardware (active low)
-  uint8_t hw_state = gate_active_high ? state : !state;
+void gate_set_claimed(uint8_t bits, uint8_t mask) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    bits &= gate_claimed;
+    gate_write_ports((uint8_t)((gate_state & ~bits) | (mask & bits)));
+  }
+}
+#else
+// Without trigger mode nothing claims a gate
+void gate_set_mask(uint8_t mask) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    gate_write_ports(mask);
+  }
+}
+#endif
 
-  volatile uint8_t* port_reg;
-  uint8_t mask;
+uint8_t gate_get_mask(void) {
+  return gate_state;
+}
 
-  if (gate_index == 0) {
-    port_reg = &PORTB;
-    mask = (uint8_t)(1 << PB0);
-  } else {
-    port_reg = &PORTD;
-    mask = (uint8_t)(1 << (PD1 + gate_index - 1));
+void gate_set(uint8_t gate_index, uint8_t state) {
+  if (gate_index >= NUM_GATES) {
+    return;
   }
 
-  if (hw_state) {
-    *port_reg |= mask;
-  } else {
-    *port_reg &= (uint8_t)~mask;
+  uint8_t bit = (uint8_t)(1 << gate_index);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    gate_write_ports(state ? (gate_state | bit) : (gate_state & (uint8_t)~bit));
   }
 }
@@ -13,6 +13,15 @@ void gpio_init(void);
 void led_init(void);
 void button_init(void);
 void gate_set(uint8_t gate_index, uint8_t state);
+// Writes every gate except claimed ones
+void gate_set_mask(uint8_t mask);
+#if TRAM8_TRIGGER
+// Claimed gates are driven by their owner (the trigger timer) through
+// gate_set_claimed() only; gate_set() still overrides for UI feedback.
+void gate_claim(uint8_t mask);
+void gate_set_claimed(uint8_t bits, uint8_t mask);
+#endif
+uint8_t gate_get_mask(void);
 void led_on(void);
 void led_off(void);
 uint8_t read_button(void);
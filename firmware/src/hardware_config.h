@@ -30,6 +30,12 @@
 #define GATE_PIN_0 PB0
 #define GATE_PIN_1 PD1
 
+// Wait between loading the DACs and raising gates so no gate edge sees stale CV
+#define DAC_SETTLE_US 10
+
+// Clock output pulse width for gates without a trigger width of their own
+#define CLOCK_PULSE_MS 5
+
 // DAC control pins
 #define LDAC_PIN PC2
 #define CLR_PIN PC3
@@ -48,8 +54,44 @@
 #define EEPROM_CHANNEL_ADDR 0x100
 #define EEPROM_NOTEMAP_ADDR 0x101
 #define EEPROM_MODE_ADDR 0x110
+#define EEPROM_CAL_ADDR 0x120 // pitch calibration: per channel offset, gain (LE 16-bit)
+#define EEPROM_CAL_SIZE (NUM_GATES * 4)
+#define EEPROM_TRIG_PULSE_ADDR 0x140 // trigger pulse width per gate, ms (0 = gate mode)
+#define EEPROM_TRIG_GAP_ADDR 0x148 // legato retrigger gap per gate, ms
+#define EEPROM_TRIG_SIZE (NUM_GATES * 2)
+#define EEPROM_CLOCK_DIV_ADDR 0x150 // clock role per gate: divider, run or reset (0 = off)
+#define EEPROM_CLOCK_SWING_ADDR 0x158 // clock swing per gate, percent
+#define EEPROM_CLOCK_SIZE (NUM_GATES * 2)
+#define EEPROM_MAP_CHANNEL_ADDR 0x160 // MIDI channel per gate (0xFF = stock channel byte)
+#define EEPROM_MAP_HIGH_ADDR 0x168 // last note of each gate's range (0xFF = single note)
+#define EEPROM_MAP_SIZE (NUM_GATES * 2)
+
+// Optional features, 1 to build in. The core firmware nearly fills the 7 KB
+// application area (the bootloader takes the top 1 KB of flash), so they are
+// off by default: build one in with e.g. make FEATURES=-DTRAM8_TRIGGER=1 and
+// check make size. SysEx frames for a feature that is left out are ignored.
+// The host tests build every feature.
+#ifndef TRAM8_SCHEDULER
+#define TRAM8_SCHEDULER 0 // scheduled state (0x13)
+#endif
+#ifndef TRAM8_RAMP
+#define TRAM8_RAMP 0 // DAC ramps (0x14)
+#endif
+#ifndef TRAM8_MODULATOR
+#define TRAM8_MODULATOR 0 // LFO / envelope generators (0x15)
+#endif
+#ifndef TRAM8_TRIGGER
+#define TRAM8_TRIGGER 0 // trigger-mode gates (0x16)
+#endif
+#ifndef TRAM8_CLOCK
+#define TRAM8_CLOCK 0 // clock outputs from MIDI real-time bytes (0x17)
+#endif
+#if TRAM8_CLOCK && !TRAM8_TRIGGER
+#error "TRAM8_CLOCK needs TRAM8_TRIGGER, which times its pulses"
+#endif
 
 // MIDI modes
 #define MODE_VELOCITY 1
 #define MODE_CC 2
 #define MODE_SYSEX 3
+#define MODE_PITCH 4
@@ -1,13 +1,19 @@
 #include "../../protocol/tram8_sysex.h"
+#include "clock.h"
+#include "eeprom_queue.h"
 #include "gpio.h"
 #include "hardware_config.h"
 #include "max5825_control.h"
 #include "midi_learn.h"
 #include "midi_mapper.h"
 #include "midi_parser.h"
+#include "modulator.h"
+#include "pitch_cal.h"
+#include "ramp.h"
+#include "scheduler.h"
+#include "trigger.h"
 #include "twi_control.h"
 #include "ui.h"
-#include <avr/eeprom.h>
 #include <avr/interrupt.h>
 #include <avr/io.h>
 #include <stdbool.h>
@@ -15,20 +21,49 @@
 #include <util/atomic.h>
 #include <util/delay.h>
 
+// Host builds use these to drive the firmware one pass at a time and to see
+// when outputs change (see tests/mock/host_main.c). LOOP_HOOK runs at the top
+// of every main loop pass, OUTPUTS_HOOK once staged outputs are loaded.
+#ifndef LOOP_HOOK
+#define LOOP_HOOK()
+#endif
+#ifndef OUTPUTS_HOOK
+#define OUTPUTS_HOOK()
+#endif
+
 #define RB_SIZE 64
 #define RB_MASK (RB_SIZE - 1)
 
 static volatile uint8_t rb[RB_SIZE];
 static volatile uint8_t rb_head = 0;
 static volatile uint8_t rb_tail = 0;
-static volatile uint8_t rb_overflow = 0;
+// Dropped bytes leave a gap just before a ring slot. The first gap still
+// ahead of the reader is at rb_gap; if more follow before it is reached,
+// only the latest of them, rb_gap_next, is kept.
+#define GAP_NONE 0
+#define GAP_ONE 1
+#define GAP_MORE 2
+static volatile uint8_t rb_overflow = GAP_NONE;
+static volatile uint8_t rb_gap = 0;
+static volatile uint8_t rb_gap_next = 0;
 static volatile uint8_t timer_ticks = 0;
+static volatile uint16_t tick_count = 0; // free-running, reported in latency pongs
+
+// Device statistics, reported in reply to a stats query
+static volatile uint16_t stat_rx_bytes = 0;
+static volatile uint16_t stat_overflows = 0;
+static volatile uint8_t stat_rb_peak = 0;
+static uint16_t stat_frames = 0;
+static uint16_t stat_parse_errors = 0;
+static uint8_t stat_loop_max = 0;
 
 static button_t learn_button = {BUTTON_IDLE, 0, read_button};
 static uint8_t module_mode = MODE_VELOCITY;
 
 static void handle_velocity(const MidiMsg* msg);
 static void handle_cc(const MidiMsg* msg);
+static void handle_pitch(const MidiMsg* msg);
+static void handle_cv_message(const MidiMsg* msg);
 static void (*handle_midi_message)(const MidiMsg* msg) = handle_velocity;
 
 void USART_Init(unsigned int ubrr) {
@@ -49,17 +84,125 @@ ISR(USART_RXC_vect) {
   uint8_t byte = UDR;
   uint8_t head = rb_head;
   uint8_t next = (head + 1) & RB_MASK;
+  stat_rx_bytes++;
 
   if (next == rb_tail) {
-    rb_overflow = 1;
+    if (rb_overflow == GAP_NONE) {
+      rb_gap = head;
+      rb_overflow = GAP_ONE;
+    } else if (head != rb_gap) {
+      rb_gap_next = head;
+      rb_overflow = GAP_MORE;
+    }
+    stat_overflows++;
     return;
   }
   rb[head] = byte;
   rb_head = next;
+
+  uint8_t used = (next - rb_tail) & RB_MASK;
+  if (used > stat_rb_peak)
+    stat_rb_peak = used;
 }
 
 ISR(TIMER2_COMP_vect) {
   timer_ticks++;
+  tick_count++;
+  sched_tick();
+  ramp_tick();
+  mod_tick(gate_get_mask());
+  trigger_tick();
+  clock_tick();
+}
+
+// Free-running tick count, for timing pong replies
+static uint16_t now_ticks(void) {
+  uint16_t now;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    now = tick_count;
+  }
+  return now;
+}
+
+// Consumes the timer ticks since the last call; the largest count seen is the
+// longest main loop iteration
+static uint8_t take_ticks(void) {
+  uint8_t ticks;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    ticks = timer_ticks;
+    timer_ticks = 0;
+  }
+  if (ticks > stat_loop_max)
+    stat_loop_max = ticks;
+  return ticks;
+}
+
+// Replies go out one byte per pass. TXD is PD1 (gate 1), so the transmitter
+// is only enabled while a reply is in flight.
+static uint8_t tx_buf[TRAM8_LEN_STATS]; // the largest reply
+static uint8_t tx_len = 0;
+static uint8_t tx_pos = 0;
+
+static void start_tx(uint8_t len) {
+  tx_len = len;
+  tx_pos = 0;
+  UCSRA = (1 << TXC); // clear a stale transmit-complete flag
+  UCSRB |= (1 << TXEN);
+}
+
+// A ping holds its pong until the outputs have caught up with everything
+// received before it. One ping is held at a time; a newer one replaces it.
+static uint8_t pong_pending = 0;
+static uint16_t pong_seq;
+static uint16_t pong_ticks;
+
+static void hold_pong(uint16_t seq) {
+  pong_seq = seq;
+  pong_ticks = now_ticks();
+  pong_pending = 1;
+}
+
+static void send_pong(void) {
+  if (tx_len)
+    return; // retried on the next pass
+  uint16_t dwell = now_ticks() - pong_ticks;
+  if (dwell > TRAM8_PONG_DWELL_MAX)
+    dwell = TRAM8_PONG_DWELL_MAX;
+  pong_pending = 0;
+  start_tx(tram8_pack_pong(tx_buf, pong_seq, pong_ticks, (uint8_t)dwell));
+}
+
+static void send_stats(void) {
+  if (tx_len)
+    return; // previous reply still going out
+  uint16_t stats[TRAM8_STAT_COUNT];
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    stats[TRAM8_STAT_RX_BYTES] = stat_rx_bytes;
+    stats[TRAM8_STAT_OVERFLOWS] = stat_overflows;
+    stats[TRAM8_STAT_RB_PEAK] = stat_rb_peak;
+    stat_rb_peak = 0;
+  }
+  stats[TRAM8_STAT_FRAMES] = stat_frames;
+  stats[TRAM8_STAT_PARSE_ERRORS] = stat_parse_errors;
+  stats[TRAM8_STAT_LOOP_MAX] = stat_loop_max;
+  stat_loop_max = 0;
+  stats[TRAM8_STAT_DAC_SKIPPED] = max5825_skipped_writes();
+  stats[TRAM8_STAT_DAC_COALESCED] = max5825_coalesced_writes();
+  stats[TRAM8_STAT_SCHED_LATE] = sched_late_count();
+
+  start_tx(tram8_pack_stats(tx_buf, stats));
+}
+
+static void service_tx(void) {
+  if (!tx_len)
+    return;
+  if (tx_pos < tx_len) {
+    if (UCSRA & (1 << UDRE))
+      UDR = tx_buf[tx_pos++];
+  } else if (UCSRA & (1 << TXC)) {
+    UCSRB &= (uint8_t)~(1 << TXEN); // PD1 back to the gate
+    tx_len = 0;
+  }
 }
 
 static inline uint8_t rb_pop(uint8_t* out) {
@@ -71,6 +214,24 @@ static inline uint8_t rb_pop(uint8_t* out) {
   return 1;
 }
 
+// True once every byte ahead of a gap has been read, so the next one follows
+// lost bytes and whatever was being parsed has to start over
+static uint8_t take_gap(void) {
+  uint8_t at_gap = 0;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (rb_overflow != GAP_NONE && rb_tail == rb_gap) {
+      at_gap = 1;
+      if (rb_overflow == GAP_MORE) {
+        rb_gap = rb_gap_next;
+        rb_overflow = GAP_ONE;
+      } else {
+        rb_overflow = GAP_NONE;
+      }
+    }
+  }
+  return at_gap;
+}
+
 static void gate_wipe(void) {
   for (uint8_t i = 0; i < NUM_GATES; i++) {
     gate_set(i, 1);
@@ -79,22 +240,107 @@ static void gate_wipe(void) {
   }
 }
 
-static inline uint8_t pop_lsb(uint8_t* mask) {
-  uint8_t value = *mask;
-  uint8_t gate = 0;
-  while (((value >> gate) & 1u) == 0u) {
-    ++gate;
+// Gate state the outputs are heading for once staged DAC writes have landed
+static uint8_t gate_target = 0;
+static uint8_t latch_requested = 0;
+
+// Runs once the staged DAC writes are on the chip: load them, let the outputs
+// settle, then raise gates so no gate edge sees stale CV
+static void latch_outputs(void) {
+  max5825_ldac_pulse();
+  _delay_us(DAC_SETTLE_US);
+  gate_set_mask(gate_target);
+  trigger_fire_pending();
+  OUTPUTS_HOOK();
+}
+
+static void request_load(void) {
+  latch_requested = 1;
+}
+
+// Falling gates go out at once; rising gates wait for the DAC writes staged ahead of them.
+// Trigger-mode gates fire on a rising bit and ignore falling ones.
+static void apply_gates(uint8_t mask) {
+  trigger_queue(mask & (uint8_t)~gate_target);
+  gate_target = mask;
+  sched_set_gates(mask);
+  gate_set_mask(gate_get_mask() & mask);
+  request_load();
+}
+
+// Note-on/off for gates. A note-on always fires trigger gates, even ones
+// whose last note was never released.
+static void gates_on(uint8_t bits) {
+  trigger_queue(bits);
+  apply_gates(gate_target | bits);
+}
+
+static void gates_off(uint8_t bits) {
+  apply_gates(gate_target & (uint8_t)~bits);
+}
+
+// A generator that is on owns its DAC: frames, bends, ramps and scheduled
+// state leave its channel alone
+static uint8_t unowned(uint8_t mask) {
+  return mask & (uint8_t)~mod_channels();
+}
+
+// Sends staged DAC values when the bus frees up, then latches once it has drained.
+// Anything staged outside a frame or note needs request_load() to reach the outputs.
+static void service_outputs(void) {
+  sched_service();
+  if (sched_take_fired())
+    gate_target = sched_gates();
+  uint16_t values[NUM_GATES];
+  uint8_t ramped = ramp_take(values);
+  if (ramped) {
+    max5825_stage_codes(values, ramped);
+    request_load();
   }
-  *mask = (uint8_t)(value & (value - 1));
-  return gate;
+  uint8_t modulated = mod_take(values); // generators win over ramps
+  if (modulated) {
+    max5825_stage_codes(values, modulated);
+    request_load();
+  }
+  // A preloaded scheduled event owns the CODE registers and LDAC until it fires
+  if (!sched_holds_dac()) {
+    max5825_service();
+    if (latch_requested && !max5825_busy()) {
+      latch_requested = 0;
+      latch_outputs();
+    }
+  }
+  if (pong_pending && !latch_requested && !max5825_busy())
+    send_pong();
+  service_tx();
 }
 
+// Pitch mode: MIDI channels 1-8 drive output pairs 1-8, one voice each.
+// Only the last note played on a channel releases its gate. set_mode() clears
+// the notes, at boot as well, so a stray note-off can't match a stale one.
+#define PITCH_NOTE_NONE 0xFF
+static uint8_t pitch_note[NUM_GATES];
+
 static void set_mode(uint8_t mode) {
   module_mode = mode;
-  handle_midi_message = (mode == MODE_CC) ? handle_cc : handle_velocity;
+  clock_reset();
+  trigger_reset();
+  sched_clear();
+  ramp_stop(0xFF);
+  mod_reset();
+  if (mode == MODE_CC) {
+    handle_midi_message = handle_cc;
+  } else if (mode == MODE_PITCH) {
+    handle_midi_message = handle_pitch;
+  } else if (mode == MODE_SYSEX) {
+    handle_midi_message = handle_cv_message;
+  } else {
+    handle_midi_message = handle_velocity;
+  }
   for (uint8_t i = 0; i < NUM_GATES; ++i) {
     gate_set(i, 0);
     max5825_write(i, 0);
+    pitch_note[i] = PITCH_NOTE_NONE;
   }
 }
 
@@ -106,42 +352,30 @@ static void handle_velocity(const MidiMsg* msg) {
 
   if (learn_is_active()) {
     if (status == 0x90 && velocity > 0) {
-      if (g_learn.gate == 0) {
-        midi_mapper_set_channel(channel);
-      }
-      learn_on_note(note);
+      learn_on_note(channel, note);
     }
     return;
   }
 
-  if (channel != midi_mapper_get_channel()) {
+  if (status != 0x90 && status != 0x80) {
     return;
   }
 
-  uint8_t gate_candidates;
+  const uint8_t gate_mask = midi_mapper_get_gates(channel, note);
+  if (!gate_mask) {
+    return;
+  }
 
-  switch (status) {
-    case 0x90:
-      gate_candidates = midi_mapper_get_gates(note);
-      while (gate_candidates) {
-        uint8_t gate_index = pop_lsb(&gate_candidates);
-        if (velocity > 0) {
-          gate_set(gate_index, 1);
-          max5825_write(gate_index, (uint16_t)velocity << 5);
-        } else {
-          gate_set(gate_index, 0);
-          max5825_write(gate_index, 0);
-        }
-      }
-      break;
-    case 0x80:
-      gate_candidates = midi_mapper_get_gates(note);
-      while (gate_candidates) {
-        uint8_t gate_index = pop_lsb(&gate_candidates);
-        gate_set(gate_index, 0);
-        max5825_write(gate_index, 0);
-      }
-      break;
+  const uint8_t on = status == 0x90 && velocity > 0;
+  uint16_t values[NUM_GATES];
+  for (uint8_t i = 0; i < NUM_GATES; ++i) {
+    values[i] = on ? (uint16_t)velocity << 5 : 0;
+  }
+  max5825_stage_codes(values, gate_mask);
+  if (on) {
+    gates_on(gate_mask);
+  } else {
+    gates_off(gate_mask);
   }
 }
 
@@ -153,165 +387,226 @@ static void handle_cc(const MidiMsg* msg) {
 
   if (learn_is_active()) {
     if (status == 0x90 && velocity > 0) {
-      if (g_learn.gate == 0) {
-        midi_mapper_set_channel(channel);
-      }
-      learn_on_note(note);
+      learn_on_note(channel, note);
     }
     return;
   }
 
-  if (channel != midi_mapper_get_channel()) {
-    return;
-  }
-
-  uint8_t gate_candidates;
-
   switch (status) {
     case 0x90:
-      gate_candidates = midi_mapper_get_gates(note);
-      while (gate_candidates) {
-        uint8_t gate_index = pop_lsb(&gate_candidates);
-        if (velocity > 0) {
-          gate_set(gate_index, 1);
-        } else {
-          gate_set(gate_index, 0);
-        }
+      if (velocity > 0) {
+        gates_on(midi_mapper_get_gates(channel, note));
+      } else {
+        gates_off(midi_mapper_get_gates(channel, note));
       }
       break;
     case 0x80:
-      gate_candidates = midi_mapper_get_gates(note);
-      while (gate_candidates) {
-        uint8_t gate_index = pop_lsb(&gate_candidates);
-        gate_set(gate_index, 0);
-      }
+      gates_off(midi_mapper_get_gates(channel, note));
       break;
     case 0xB0:
-      if (msg->d1 >= 69 && msg->d1 <= 76) {
+      // CV n follows the channel gate n is mapped to
+      if (msg->d1 >= 69 && msg->d1 <= 76 && midi_mapper_get_map(msg->d1 - 69)->channel == channel) {
         uint8_t dac_ch = msg->d1 - 69;
-        max5825_write(dac_ch, (uint16_t)msg->d2 << 5);
+        max5825_stage(dac_ch, (uint16_t)msg->d2 << 5);
+        request_load();
       }
       break;
   }
 }
 
-static void handle_sysex(const uint8_t* buf, uint8_t len) {
-  uint8_t gate_mask;
-  uint16_t dac[TRAM8_NUM_GATES];
-  tram8_form_t form;
+static void handle_pitch(const MidiMsg* msg) {
+  const uint8_t status = msg->status & 0xF0;
+  const uint8_t channel = msg->status & 0x0F;
+  const uint8_t note = msg->d1;
+  const uint8_t velocity = msg->d2;
 
-  if (tram8_parse(buf, len, &gate_mask, dac, &form) != 0)
+  if (learn_is_active() || channel >= NUM_GATES) {
     return;
+  }
 
-  for (uint8_t i = 0; i < TRAM8_NUM_GATES; i++)
-    gate_set(i, (gate_mask >> i) & 1);
-  if (form != TRAM8_FORM_GATES) {
-    for (uint8_t i = 0; i < TRAM8_NUM_GATES; i++)
-      max5825_write(i, dac[i]);
+  const uint8_t bit = (uint8_t)(1 << channel);
+  if (status == 0x90 && velocity > 0) {
+    pitch_note[channel] = note;
+    max5825_stage(channel, pitch_cal_code(channel, note));
+    gates_on(bit);
+  } else if ((status == 0x80 || status == 0x90) && note == pitch_note[channel]) {
+    gates_off(bit);
   }
 }
 
-static void sysex_mode_loop(void) {
-  uint8_t syx_buf[TRAM8_LEN_FULL];
-  uint8_t syx_len = 0;
-  uint8_t in_sysex = 0;
+// Every SysEx frame is collected whole and applied at its F7, so a frame cut
+// short never reaches the outputs. Calibration, trigger/clock setup, gate
+// mapping, stats queries and pings are accepted in every mode; state frames,
+// scheduled state, ramps and modulators only in SysEx mode. Frames for a
+// feature left out of the build are ignored like unknown commands.
+static uint8_t frame_buf[TRAM8_LEN_MAX];
+static uint8_t frame_len = 0;
+
+// Returns 1 if the frame was applied, -1 if it was one of ours but rejected
+// and 0 if it was not for this handler
+static int8_t handle_frame(const uint8_t* buf, uint8_t len) {
+  if ((buf[2] == TRAM8_CMD_STATE || buf[2] == TRAM8_CMD_DELTA) && module_mode == MODE_SYSEX) {
+    uint8_t gate_mask, dac_mask;
+    uint16_t dac[NUM_GATES];
+    tram8_form_t form;
+    if (tram8_parse(buf, len, &gate_mask, dac, &dac_mask, &form) != 0)
+      return -1;
+    dac_mask = unowned(dac_mask);
+    ramp_stop(dac_mask);
+    max5825_stage_codes(dac, dac_mask);
+    apply_gates(gate_mask);
+  } else if (buf[2] == TRAM8_CMD_CAL) {
+    uint8_t channel;
+    int16_t offset;
+    uint16_t gain;
+    if (tram8_parse_cal(buf, len, &channel, &offset, &gain) != 0)
+      return -1;
+    pitch_cal_set(channel, offset, gain);
+  } else if (TRAM8_TRIGGER && buf[2] == TRAM8_CMD_TRIGGER) {
+    uint8_t gate, pulse, gap;
+    if (tram8_parse_trigger(buf, len, &gate, &pulse, &gap) != 0)
+      return -1;
+    trigger_config(gate, pulse, gap);
+  } else if (TRAM8_CLOCK && buf[2] == TRAM8_CMD_CLOCK) {
+    uint8_t gate, divider, swing;
+    if (tram8_parse_clock(buf, len, &gate, &divider, &swing) != 0)
+      return -1;
+    clock_config(gate, divider, swing);
+  } else if (buf[2] == TRAM8_CMD_MAP) {
+    uint8_t gate, channel, low, high;
+    if (tram8_parse_map(buf, len, &gate, &channel, &low, &high) != 0)
+      return -1;
+    midi_mapper_set_range(gate, channel == TRAM8_MAP_OFF ? MAPPER_NONE : channel, low, high);
+    midi_mapper_save();
+  } else if (buf[2] == TRAM8_CMD_STATS_QUERY) {
+    if (tram8_parse_stats_query(buf, len) != 0)
+      return -1;
+    send_stats();
+  } else if (buf[2] == TRAM8_CMD_PING) {
+    uint16_t seq;
+    if (tram8_parse_ping(buf, len, &seq) != 0)
+      return -1;
+    hold_pong(seq);
+  } else if (TRAM8_SCHEDULER && buf[2] == TRAM8_CMD_SCHEDULED && module_mode == MODE_SYSEX) {
+    uint16_t ticks;
+    uint8_t gates, dac_mask;
+    uint16_t dac[NUM_GATES];
+    if (tram8_parse_scheduled(buf, len, &ticks, &gates, dac, &dac_mask) != 0)
+      return -1;
+    dac_mask = unowned(dac_mask);
+    if (!sched_push(ticks, gates, dac, dac_mask))
+      return -1;
+    ramp_stop(dac_mask);
+  } else if (TRAM8_RAMP && buf[2] == TRAM8_CMD_RAMP && module_mode == MODE_SYSEX) {
+    uint8_t channel;
+    uint16_t target, duration;
+    tram8_curve_t curve;
+    if (tram8_parse_ramp(buf, len, &channel, &target, &duration, &curve) != 0)
+      return -1;
+    if (unowned((uint8_t)(1 << channel)))
+      ramp_start(channel, max5825_get(channel), target, duration, curve);
+  } else if (TRAM8_MODULATOR && buf[2] == TRAM8_CMD_MOD && module_mode == MODE_SYSEX) {
+    uint8_t slot;
+    tram8_mod_param_t param;
+    uint16_t value;
+    if (tram8_parse_mod(buf, len, &slot, &param, &value) != 0)
+      return -1;
+    mod_set(slot, param, value);
+    // Whatever else was heading for a generator's channel stops here
+    ramp_stop(mod_channels());
+    sched_drop_dac(mod_channels());
+  } else {
+    return 0;
+  }
+  return 1;
+}
 
-  for (;;) {
-    uint8_t overflow;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-      overflow = rb_overflow;
-    }
-    if (rb_tail == rb_head && overflow) {
-      in_sysex = 0;
-      syx_len = 0;
-      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        rb_overflow = 0;
-      }
+static void feed_frame(uint8_t byte) {
+  if (byte == TRAM8_SYSEX_START) {
+    frame_len = 0;
+  } else if (frame_len == 0 || (byte & 0x80 && byte != TRAM8_SYSEX_END) || frame_len >= TRAM8_LEN_MAX) {
+    frame_len = 0;
+    return;
+  }
+  frame_buf[frame_len++] = byte;
+
+  if (byte == TRAM8_SYSEX_END) {
+    if (frame_len > TRAM8_HEADER_LEN) {
+      int8_t result = handle_frame(frame_buf, frame_len);
+      if (result > 0)
+        stat_frames++;
+      else if (result < 0)
+        stat_parse_errors++;
     }
+    frame_len = 0;
+  }
+}
 
-    uint8_t byte;
-    if (rb_pop(&byte)) {
-      if (byte >= 0xF8)
-        continue; // skip real-time
-
-      if (byte == TRAM8_SYSEX_START) {
-        in_sysex = 1;
-        syx_len = 0;
-        syx_buf[syx_len++] = byte;
-        continue;
-      }
-
-      if (!in_sysex)
-        continue;
-
-      if (byte == TRAM8_SYSEX_END) {
-        syx_buf[syx_len++] = byte;
-        handle_sysex(syx_buf, syx_len);
-        in_sysex = 0;
-        syx_len = 0;
-        continue;
-      }
+static void handle_cv_message(const MidiMsg* msg) {
+  const uint8_t status = msg->status & 0xF0;
+  const uint8_t channel = msg->status & 0x0F;
 
-      if (byte >= 0x80) {
-        in_sysex = 0;
-        syx_len = 0;
-        continue;
+  switch (status) {
+    case TRAM8_CV_NOTE_ON:
+    case TRAM8_CV_NOTE_OFF:
+      if (channel == TRAM8_CV_GATE_CHANNEL && msg->d1 < NUM_GATES) {
+        uint8_t bit = (uint8_t)(1 << msg->d1);
+        if (status == TRAM8_CV_NOTE_ON && msg->d2 > 0) {
+          gates_on(bit);
+        } else {
+          gates_off(bit);
+        }
       }
-
-      if (syx_len < TRAM8_LEN_FULL - 1) {
-        syx_buf[syx_len++] = byte;
-      } else {
-        in_sysex = 0;
-        syx_len = 0;
+      break;
+    case TRAM8_CV_BEND:
+      if (channel < NUM_GATES && unowned((uint8_t)(1 << channel))) {
+        ramp_stop((uint8_t)(1 << channel));
+        max5825_stage(channel, tram8_bend_to_dac(msg->d1, msg->d2));
+        request_load();
       }
-    }
-
-    uint8_t ticks;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-      ticks = timer_ticks;
-      timer_ticks = 0;
-    }
-    if (ticks) {
-      button_update(&learn_button, ticks);
-      if (learn_button.state == BUTTON_HELD)
-        return;
-    }
+      break;
   }
 }
 
+// Every mode but the menu runs here; set_mode() picks the channel message handler
 static void play_mode_loop(void) {
   MidiParser parser;
   midi_parser_init(&parser);
+  gate_target = gate_get_mask();
+  sched_set_gates(gate_target);
+  latch_requested = 0;
 
   for (;;) {
-    uint8_t overflow;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-      overflow = rb_overflow;
-    }
-    if (rb_tail == rb_head && overflow) {
+    LOOP_HOOK();
+    service_outputs();
+
+    if (take_gap()) {
+      // The frame or message in progress lost bytes; drop it
+      frame_len = 0;
       midi_parser_force_desync(&parser);
-      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        rb_overflow = 0;
-      }
     }
 
     uint8_t byte;
     if (rb_pop(&byte)) {
       MidiMsg msg;
+      if (byte < 0xF8)
+        feed_frame(byte);
+      else
+        clock_realtime(byte);
       if (midi_parse(&parser, byte, &msg)) {
         handle_midi_message(&msg);
       }
     }
 
-    uint8_t ticks;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-      ticks = timer_ticks;
-      timer_ticks = 0;
-    }
+    uint8_t ticks = take_ticks();
     if (ticks) {
       button_update(&learn_button, ticks);
 
       if (learn_button.state == BUTTON_HELD) {
+        clock_reset();
+        trigger_reset();
+        sched_clear();
+        ramp_stop(0xFF);
         return;
       }
     }
@@ -325,6 +620,7 @@ static void menu_mode_loop(void) {
   }
 
   for (;;) {
+    LOOP_HOOK();
     uint8_t ticks;
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
       ticks = timer_ticks;
@@ -337,30 +633,20 @@ static void menu_mode_loop(void) {
     button_update(&learn_button, ticks);
 
     if (learn_button.state == BUTTON_PRESSED) {
-      menu_index = (uint8_t)((menu_index + 1) % 4);
+      menu_index = (uint8_t)((menu_index + 1) % 5);
       for (uint8_t gate = 0; gate < NUM_GATES; ++gate) {
         gate_set(gate, gate == menu_index);
       }
     }
 
     if (learn_button.state == BUTTON_HELD) {
-      switch (menu_index) {
-        case 0:
-          learn_begin();
-          return;
-        case 1:
-          set_mode(MODE_VELOCITY);
-          eeprom_update_byte((uint8_t*)EEPROM_MODE_ADDR, module_mode);
-          break;
-        case 2:
-          set_mode(MODE_CC);
-          eeprom_update_byte((uint8_t*)EEPROM_MODE_ADDR, module_mode);
-          break;
-        case 3:
-          set_mode(MODE_SYSEX);
-          eeprom_update_byte((uint8_t*)EEPROM_MODE_ADDR, module_mode);
-          break;
+      if (menu_index == 0) {
+        learn_begin();
+        return;
       }
+      // Entries 1-4 are the modes, MODE_VELOCITY to MODE_PITCH in order
+      set_mode(menu_index);
+      eeprom_queue_write(EEPROM_MODE_ADDR, module_mode);
 
       for (uint8_t gate = 0; gate < NUM_GATES; ++gate) {
         gate_set(gate, 0);
@@ -374,16 +660,16 @@ int main(void) {
   gpio_init();
   twi_init();
   max5825_init();
+  eeprom_queue_init();
   midi_mapper_init();
+  trigger_init();
+  clock_init();
 
-  uint8_t mode = eeprom_read_byte((uint8_t*)EEPROM_MODE_ADDR);
-  if (mode == MODE_CC) {
-    set_mode(MODE_CC);
-  } else if (mode == MODE_SYSEX) {
-    set_mode(MODE_SYSEX);
-  } else {
-    set_mode(MODE_VELOCITY);
+  uint8_t mode = eeprom_queue_read(EEPROM_MODE_ADDR);
+  if (mode < MODE_VELOCITY || mode > MODE_PITCH) {
+    mode = MODE_VELOCITY; // erased EEPROM
   }
+  set_mode(mode);
 
   gate_wipe();
 
@@ -393,11 +679,7 @@ int main(void) {
   sei();
 
   for (;;) {
-    if (module_mode == MODE_SYSEX) {
-      sysex_mode_loop();
-    } else {
-      play_mode_loop();
-    }
+    play_mode_loop();
     menu_mode_loop();
   }
 }
@@ -0,0 +1,118 @@
+#include "max5825_control.h"
+
+static uint16_t shadow[8];
+static uint8_t shadow_known = 0; // channels whose shadow matches the chip
+static uint16_t skipped = 0;
+
+static uint16_t staged[8];
+static uint8_t staged_mask = 0;
+static uint16_t coalesced = 0;
+
+void max5825_init(void) {
+  _delay_us(250); // Wait for DAC power-up calibration (200us typ)
+  twi_start();
+  twi_write(MAX5825_ADDR);
+  twi_write(MAX5825_REG_REF | 0b101); // Setup command for reference voltage
+  twi_write(0x00);
+  twi_write(0x00);
+  twi_stop();
+
+  twi_start();
+  twi_write(MAX5825_ADDR); // Device address with write bit
+  twi_write(MAX5825_REG_CODE_ALL_LOAD_ALL);
+  twi_write(0x00);
+  twi_write(0x00);
+  twi_stop();
+
+  for (uint8_t ch = 0; ch < 8; ch++)
+    shadow[ch] = 0;
+  shadow_known = 0xFF;
+}
+
+void max5825_write(uint8_t channel, uint16_t value) {
+  twi_async_flush();
+  twi_start();
+  twi_write(MAX5825_ADDR);
+  twi_write(MAX5825_REG_CODEn_LOADn | (channel & 0x0F));
+
+  twi_write((uint8_t)(value >> 4));
+  twi_write((uint8_t)((value & 0x0F) << 4));
+  twi_stop();
+
+  channel &= 0x07;
+  shadow[channel] = value;
+  shadow_known |= (uint8_t)(1 << channel);
+  staged_mask &= (uint8_t)~(1 << channel); // superseded
+}
+
+uint8_t max5825_dirty_mask(const uint16_t values[8], uint8_t mask) {
+  uint8_t dirty = 0;
+  for (uint8_t ch = 0; ch < 8; ch++) {
+    uint8_t bit = (uint8_t)(1 << ch);
+    if ((mask & bit) && (!(shadow_known & bit) || values[ch] != shadow[ch]))
+      dirty |= bit;
+  }
+  return dirty;
+}
+
+uint8_t max5825_write_codes_async(const uint16_t values[8], uint8_t mask) {
+  uint8_t dirty = max5825_dirty_mask(values, mask);
+  uint8_t data[TWI_MAX_DATA];
+  uint8_t len = 0;
+  for (uint8_t ch = 0; ch < 8; ch++) {
+    if (!((dirty >> ch) & 1)) {
+      if ((mask >> ch) & 1)
+        skipped++;
+      continue;
+    }
+    data[len++] = MAX5825_REG_CODEn | ch;
+    data[len++] = (uint8_t)(values[ch] >> 4);
+    data[len++] = (uint8_t)((values[ch] & 0x0F) << 4);
+    shadow[ch] = values[ch];
+  }
+  shadow_known |= dirty;
+  if (len)
+    twi_async_write(MAX5825_ADDR, data, len);
+  return dirty;
+}
+
+void max5825_stage(uint8_t channel, uint16_t value) {
+  channel &= 0x07;
+  uint8_t bit = (uint8_t)(1 << channel);
+  if (staged_mask & bit)
+    coalesced++;
+  staged[channel] = value;
+  staged_mask |= bit;
+}
+
+void max5825_stage_codes(const uint16_t values[8], uint8_t mask) {
+  for (uint8_t ch = 0; ch < 8; ch++) {
+    if ((mask >> ch) & 1)
+      max5825_stage(ch, values[ch]);
+  }
+}
+
+uint8_t max5825_service(void) {
+  if (!staged_mask || twi_async_busy())
+    return 0;
+  uint8_t mask = staged_mask;
+  staged_mask = 0;
+  return max5825_write_codes_async(staged, mask);
+}
+
+uint16_t max5825_get(uint8_t channel) {
+  channel &= 0x07;
+  return ((staged_mask >> channel) & 1) ? staged[channel] : shadow[channel];
+}
+
+uint8_t max5825_busy(void) {
+  return staged_mask || twi_async_busy();
+}
+
+uint16_t max5825_coalesced_writes(void) {
+  return coalesced;
+}
+
+uint16_t max5825_skipped_writes(void) {
+  return skipped;
+}
@@ -1,39 +1,58 @@
 #ifndef MAX5825_CONTROL_H
 #define MAX5825_CONTROL_H
 
+#include "hardware_config.h"
 #include "twi_control.h"
 #include <util/delay.h>
 
 #define MAX5825_ADDR 0x20
 #define MAX5825_REG_REF 0x20
 #define MAX5825_REG_CODE_ALL_LOAD_ALL 0xC2
+#define MAX5825_REG_CODEn 0x80
 #define MAX5825_REG_CODEn_LOADn 0xB0
 
-static inline void max5825_init(void) {
-  _delay_us(250); // Wait for DAC power-up calibration (200us typ)
-  twi_start();
-  twi_write(MAX5825_ADDR);
-  twi_write(MAX5825_REG_REF | 0b101); // Setup command for reference voltage
-  twi_write(0x00);
-  twi_write(0x00);
-  twi_stop();
-
-  twi_start();
-  twi_write(MAX5825_ADDR); // Device address with write bit
-  twi_write(MAX5825_REG_CODE_ALL_LOAD_ALL);
-  twi_write(0x00);
-  twi_write(0x00);
-  twi_stop();
+static inline void max5825_ldac_pulse(void) {
+  LDAC_PORT &= (uint8_t)~(1 << LDAC_PIN);
+  LDAC_PORT |= (1 << LDAC_PIN);
 }
 
-static inline void max5825_write(uint8_t channel, uint16_t value) {
-  twi_start();
-  twi_write(MAX5825_ADDR);
-  twi_write(MAX5825_REG_CODEn_LOADn | (channel & 0x0F));
+// The driver keeps a shadow of the last code sent to each channel; writes
+// that would not change a channel are dropped before reaching the bus.
 
-  twi_write((uint8_t)(value >> 4));
-  twi_write((uint8_t)((value & 0x0F) << 4));
-  twi_stop();
-}
+void max5825_init(void);
+
+// Blocking CODEn_LOADn, always sent
+void max5825_write(uint8_t channel, uint16_t value);
+
+// Queues CODEn writes (no load) for the channels in mask whose code differs
+// from the shadow. The chip accepts successive command/data triplets after
+// one address byte, so this is a single transaction however many channels
+// are set. Returns the mask of channels actually written.
+uint8_t max5825_write_codes_async(const uint16_t values[8], uint8_t mask);
+
+// Channels in mask whose code differs from the shadow
+uint8_t max5825_dirty_mask(const uint16_t values[8], uint8_t mask);
+
+// Latest-wins staging. Handlers drop values into per-channel slots and
+// max5825_service() sends whatever is staged to the CODE registers once the
+// bus is idle, so a channel updated again before its write goes out only
+// sends the newest value. Loading the outputs is left to the caller.
+void max5825_stage(uint8_t channel, uint16_t value);
+void max5825_stage_codes(const uint16_t values[8], uint8_t mask);
+
+// Call from the main loop. Returns the mask of channels sent.
+uint8_t max5825_service(void);
+
+// Latest value for a channel: staged if pending, else the shadow
+uint16_t max5825_get(uint8_t channel);
+
+// True while values are staged or the bus is still sending
+uint8_t max5825_busy(void);
+
+// Staged values replaced before they were sent
+uint16_t max5825_coalesced_writes(void);
+
+// Channel writes dropped because the shadow already held the value
+uint16_t max5825_skipped_writes(void);
 
 #endif
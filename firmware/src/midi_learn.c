@@ -31,12 +31,12 @@ void learn_exit(void) {
   led_off();
 }
 
-uint8_t learn_on_note(uint8_t note) {
+uint8_t learn_on_note(uint8_t channel, uint8_t note) {
   if (!g_learn.active) {
     return 0;
   }
 
-  midi_mapper_set_gate(note, g_learn.gate);
+  midi_mapper_set_gate(g_learn.gate, channel, note);
   gate_set(g_learn.gate, 0);
   g_learn.gate++;
 
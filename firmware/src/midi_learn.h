@@ -14,7 +14,8 @@ extern LearnState g_learn;
 
 void learn_begin(void);
 void learn_exit(void);
-uint8_t learn_on_note(uint8_t note);
+// Maps the current gate to the note on its channel; returns 1 once all are learned
+uint8_t learn_on_note(uint8_t channel, uint8_t note);
 uint8_t learn_get_current_gate(void);
 uint8_t learn_is_active(void);
 
@@ -1,87 +1,115 @@
 #include "midi_mapper.h"
 
-#include <avr/eeprom.h>
-#include <string.h>
-
+#include "eeprom_queue.h"
 #include "hardware_config.h"
 
-// 128-byte lookup: note -> gate bitmask. Stock EEPROM stores 8 notes at 0x101.
-static uint8_t note_to_gates[128];
-static uint8_t midi_channel = 9;
-static const uint8_t default_notes[NUM_GATES] = {60, 61, 62, 63, 64, 65, 66, 67};
+// gate_map is the whole lookup: 24 bytes, compared entry by entry, where a
+// note table would cost 128 of the part's 1 KB of RAM.
+// Stock EEPROM stores 1 channel at 0x100 and 8 notes at 0x101; the per-gate
+// channels and range ends live past the stock block.
+static GateMap gate_map[NUM_GATES];
+
+#define DEFAULT_CHANNEL 9
+#define DEFAULT_NOTE 60 // gate n answers note 60 + n
+#define NOTE_NONE 0x80 // stored for an unmapped gate; 0xFF in gate 0 means erased
+
+static void map(uint8_t gate, uint8_t channel, uint8_t low, uint8_t high) {
+  GateMap* m = &gate_map[gate];
+  if (channel > 15 || low > 127) {
+    m->channel = MAPPER_NONE;
+    m->low = m->high = 0;
+    return;
+  }
+  m->channel = channel;
+  m->low = low;
+  m->high = (high > 127 || high < low) ? low : high;
+}
 
 void midi_mapper_init(void) {
   midi_mapper_load();
 }
 
-uint8_t midi_mapper_get_gates(uint8_t note) {
-  return note_to_gates[note & 0x7F];
+uint8_t midi_mapper_get_gates(uint8_t channel, uint8_t note) {
+  uint8_t gates = 0;
+  channel &= 0x0F;
+  note &= 0x7F;
+  for (uint8_t gate = 0; gate < NUM_GATES; ++gate) {
+    const GateMap* m = &gate_map[gate];
+    // an unmapped gate's MAPPER_NONE never equals a channel
+    if (m->channel == channel && note >= m->low && note <= m->high) {
+      gates |= (uint8_t)(1 << gate);
+    }
+  }
+  return gates;
+}
+
+void midi_mapper_set_gate(uint8_t gate, uint8_t channel, uint8_t note) {
+  midi_mapper_set_range(gate, channel, note, note);
 }
 
-void midi_mapper_set_gate(uint8_t note, uint8_t gate) {
+void midi_mapper_set_range(uint8_t gate, uint8_t channel, uint8_t low, uint8_t high) {
   if (gate < NUM_GATES) {
-    note_to_gates[note & 0x7F] |= (uint8_t)(1 << gate);
+    map(gate, channel, low, high);
   }
 }
 
 void midi_mapper_clear(void) {
-  memset(note_to_gates, 0, sizeof(note_to_gates));
+  for (uint8_t gate = 0; gate < NUM_GATES; ++gate) {
+    gate_map[gate].channel = MAPPER_NONE;
+  }
 }
 
 void midi_mapper_load(void) {
-  midi_mapper_clear();
-
-  midi_channel = eeprom_read_byte((uint8_t*)EEPROM_CHANNEL_ADDR);
-  if (midi_channel > 15) {
-    midi_channel = 9;
+  uint8_t channel = eeprom_queue_read(EEPROM_CHANNEL_ADDR);
+  if (channel > 15) {
+    channel = DEFAULT_CHANNEL;
   }
 
   uint8_t notes[NUM_GATES];
-  eeprom_read_block(notes, (uint8_t*)EEPROM_NOTEMAP_ADDR, NUM_GATES);
+  eeprom_queue_read_block(notes, EEPROM_NOTEMAP_ADDR, NUM_GATES);
+  const uint8_t erased = notes[0] == 0xFF;
 
-  if (notes[0] == 0xFF) {
-    for (uint8_t gate = 0; gate < NUM_GATES; ++gate) {
-      note_to_gates[default_notes[gate]] |= (uint8_t)(1 << gate);
+  for (uint8_t gate = 0; gate < NUM_GATES; ++gate) {
+    uint8_t ch = eeprom_queue_read(EEPROM_MAP_CHANNEL_ADDR + gate);
+    if (ch > 15) {
+      ch = channel; // stock image: every gate on the one channel
     }
-  } else {
-    for (uint8_t gate = 0; gate < NUM_GATES; ++gate) {
-      if (notes[gate] < 128) {
-        note_to_gates[notes[gate]] |= (uint8_t)(1 << gate);
-      }
+    if (erased) {
+      map(gate, channel, DEFAULT_NOTE + gate, DEFAULT_NOTE + gate);
+    } else {
+      map(gate, ch, notes[gate], eeprom_queue_read(EEPROM_MAP_HIGH_ADDR + gate));
     }
   }
 }
 
 void midi_mapper_save(void) {
-  eeprom_update_byte((uint8_t*)EEPROM_CHANNEL_ADDR, midi_channel);
-
   uint8_t notes[NUM_GATES];
+  uint8_t channels[NUM_GATES];
+  uint8_t highs[NUM_GATES];
   for (uint8_t gate = 0; gate < NUM_GATES; ++gate) {
-    notes[gate] = midi_mapper_get_note_for_gate(gate);
+    const GateMap* m = &gate_map[gate];
+    const uint8_t mapped = m->channel != MAPPER_NONE;
+    notes[gate] = mapped ? m->low : NOTE_NONE;
+    channels[gate] = m->channel;
+    highs[gate] = mapped ? m->high : 0xFF;
   }
 
-  eeprom_update_block(notes, (uint8_t*)EEPROM_NOTEMAP_ADDR, NUM_GATES);
-}
-
-uint8_t midi_mapper_get_channel(void) {
-  return midi_channel;
+  // stock firmware reads the channel of gate 0
+  if (gate_map[0].channel != MAPPER_NONE) {
+    eeprom_queue_write(EEPROM_CHANNEL_ADDR, gate_map[0].channel);
+  }
+  eeprom_queue_write_block(notes, EEPROM_NOTEMAP_ADDR, NUM_GATES);
+  eeprom_queue_write_block(channels, EEPROM_MAP_CHANNEL_ADDR, NUM_GATES);
+  eeprom_queue_write_block(highs, EEPROM_MAP_HIGH_ADDR, NUM_GATES);
 }
 
-void midi_mapper_set_channel(uint8_t channel) {
-  midi_channel = channel & 0x0F;
+const GateMap* midi_mapper_get_map(uint8_t gate) {
+  return &gate_map[gate & (NUM_GATES - 1)];
 }
 
 uint8_t midi_mapper_get_note_for_gate(uint8_t gate) {
-  if (gate >= NUM_GATES) {
+  if (gate >= NUM_GATES || gate_map[gate].channel == MAPPER_NONE) {
     return 0xFF;
   }
-
-  uint8_t mask = (uint8_t)(1 << gate);
-  for (uint8_t note = 0; note < 128; ++note) {
-    if (note_to_gates[note] & mask) {
-      return note;
-    }
-  }
-
-  return 0xFF;
+  return gate_map[gate].low;
 }
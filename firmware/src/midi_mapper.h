@@ -5,29 +5,45 @@
 
 #include "hardware_config.h"
 
-// Initialize mapper (load from EEPROM)
+// Each gate listens to one MIDI channel and a note range, so one unit can
+// follow a drum channel and a bass channel at once, or split a keyboard
+// across its gates. A lookup compares against all eight gate maps, so it
+// takes the same time whatever the note.
+
+#define MAPPER_NONE 0xFF // channel of a gate that listens to nothing
+
+typedef struct {
+  uint8_t channel; // 0-15, or MAPPER_NONE
+  uint8_t low; // first note
+  uint8_t high; // last note, >= low
+} GateMap;
+
+// Initialize mapper (load from the EEPROM image)
 void midi_mapper_init(void);
 
-// Get gate bitmask for a note (O(1) lookup)
-uint8_t midi_mapper_get_gates(uint8_t note);
+// Get gate bitmask for a note on a channel (eight compares, no tables)
+uint8_t midi_mapper_get_gates(uint8_t channel, uint8_t note);
+
+// Map a gate to one note (used during learn mode)
+void midi_mapper_set_gate(uint8_t gate, uint8_t channel, uint8_t note);
 
-// Set a gate for a note (used during learn mode)
-void midi_mapper_set_gate(uint8_t note, uint8_t gate);
+// Map a gate to notes low-high on a channel; channel MAPPER_NONE unmaps it.
+// Ranges may overlap: a note then drives every gate that holds it.
+void midi_mapper_set_range(uint8_t gate, uint8_t channel, uint8_t low, uint8_t high);
 
 // Clear all mappings
 void midi_mapper_clear(void);
 
-// Load mappings from EEPROM
+// Load mappings from the EEPROM image
 void midi_mapper_load(void);
 
-// Save mappings to EEPROM
+// Save mappings to EEPROM (queued, returns immediately)
 void midi_mapper_save(void);
 
-// Get/set MIDI channel
-uint8_t midi_mapper_get_channel(void);
-void midi_mapper_set_channel(uint8_t channel);
+// Mapping of a gate (O(1) reverse lookup)
+const GateMap* midi_mapper_get_map(uint8_t gate);
 
-// Get note assigned to a gate (for save compatibility)
+// Get first note assigned to a gate, 0xFF if none (for save compatibility)
 uint8_t midi_mapper_get_note_for_gate(uint8_t gate);
 
 #endif
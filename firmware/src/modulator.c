@@ -0,0 +1,264 @@
+#include "modulator.h"
+
+#if TRAM8_MODULATOR
+
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#define ENV_IDLE 0
+#define ENV_ATTACK 1
+#define ENV_DECAY 2
+#define ENV_SUSTAIN 3
+#define ENV_RELEASE 4
+
+typedef struct {
+  uint8_t type;
+  uint8_t dest;
+  uint8_t trigger;
+  uint8_t stage; // envelope stage
+  uint16_t depth;
+  uint16_t offset;
+  uint16_t sustain; // Q16 level
+  uint16_t attack; // segment steps per tick (Q16 of the segment)
+  uint16_t decay;
+  uint16_t release;
+  uint32_t inc; // LFO phase step per tick
+  uint32_t phase; // LFO phase, or envelope segment position in the low 16 bits
+  uint16_t level; // envelope level (Q16), or the held S&H value
+  uint16_t from; // envelope level at the start of the segment
+} mod_t;
+
+// Exponential fall from 1 to 0 over a segment, 64 steps plus end point:
+// (e^(-4x) - e^-4) / (1 - e^-4). Attack runs it backwards for an RC-like rise.
+static const uint16_t exp_curve[65] PROGMEM = {
+    65535, 61490, 57691, 54121, 50768, 47618, 44659, 41879,
+    39268, 36815, 34510, 32345, 30311, 28401, 26606, 24920,
+    23336, 21848, 20450, 19137, 17904, 16745, 15656, 14634,
+    13673, 12770, 11923, 11126, 10378, 9675, 9015, 8395,
+    7812, 7265, 6750, 6267, 5814, 5387, 4987, 4611,
+    4257, 3925, 3613, 3320, 3045, 2786, 2544, 2315,
+    2101, 1900, 1710, 1533, 1366, 1209, 1062, 923,
+    793, 671, 556, 449, 347, 252, 163, 79,
+    0,
+};
+
+static mod_t mods[TRAM8_MOD_SLOTS];
+static uint8_t last_gates = 0;
+static uint16_t lfsr = 0xACE1;
+static volatile uint8_t updated = 0;
+static uint8_t force = 0; // channels to report next tick even if unchanged
+static volatile uint16_t values_out[NUM_GATES];
+
+static uint16_t curve_at(uint16_t pos) {
+  uint8_t i = (uint8_t)(pos >> 10);
+  uint16_t a = pgm_read_word(&exp_curve[i]);
+  uint16_t b = pgm_read_word(&exp_curve[i + 1]);
+  return (uint16_t)(a - (uint16_t)(((uint32_t)(a - b) * (pos & 0x3FF)) >> 10));
+}
+
+static uint16_t ms_to_step(uint16_t ms) {
+  return ms ? (uint16_t)(0xFFFFUL / ms) : 0xFFFF;
+}
+
+static uint16_t random16(void) {
+  // Galois LFSR, period 65535
+  lfsr = (uint16_t)((lfsr >> 1) ^ (-(lfsr & 1) & 0xB400));
+  return lfsr;
+}
+
+void mod_set(uint8_t slot, tram8_mod_param_t param, uint16_t value) {
+  if (slot >= TRAM8_MOD_SLOTS)
+    return;
+  mod_t* m = &mods[slot];
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    switch (param) {
+      case TRAM8_MOD_DEST:
+        m->dest = value & 0x07;
+        force |= (uint8_t)(1 << m->dest);
+        break;
+      case TRAM8_MOD_TYPE:
+        force |= (uint8_t)(1 << m->dest);
+        m->type = value < TRAM8_MOD_TYPE_COUNT ? (uint8_t)value : TRAM8_MOD_OFF;
+        m->phase = 0;
+        m->stage = ENV_IDLE;
+        m->level = 0;
+        break;
+      case TRAM8_MOD_RATE:
+        m->inc = (uint32_t)value * 42950UL; // 0.01 Hz -> 2^32 / 100000 per tick
+        break;
+      case TRAM8_MOD_DEPTH:
+        m->depth = value > TRAM8_DAC_MAX ? TRAM8_DAC_MAX : value;
+        break;
+      case TRAM8_MOD_OFFSET:
+        m->offset = value > TRAM8_DAC_MAX ? TRAM8_DAC_MAX : value;
+        break;
+      case TRAM8_MOD_ATTACK:
+        m->attack = ms_to_step(value);
+        break;
+      case TRAM8_MOD_DECAY:
+        m->decay = ms_to_step(value);
+        break;
+      case TRAM8_MOD_SUSTAIN:
+        m->sustain = value > TRAM8_DAC_MAX ? 0xFFFF : (uint16_t)(value << 4);
+        break;
+      case TRAM8_MOD_RELEASE:
+        m->release = ms_to_step(value);
+        break;
+      case TRAM8_MOD_TRIGGER:
+        m->trigger = value < NUM_GATES ? (uint8_t)value : TRAM8_MOD_TRIGGER_NONE;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void mod_reset(void) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    for (uint8_t i = 0; i < TRAM8_MOD_SLOTS; i++) {
+      mods[i].type = TRAM8_MOD_OFF;
+      mods[i].trigger = TRAM8_MOD_TRIGGER_NONE;
+    }
+    updated = 0;
+  }
+}
+
+uint8_t mod_channels(void) {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < TRAM8_MOD_SLOTS; i++) {
+    if (mods[i].type != TRAM8_MOD_OFF)
+      mask |= (uint8_t)(1 << mods[i].dest);
+  }
+  return mask;
+}
+
+static void env_enter(mod_t* m, uint8_t stage) {
+  m->stage = stage;
+  m->from = m->level;
+  m->phase = 0;
+}
+
+// Advances the segment; returns 1 when it has finished
+static uint8_t env_advance(mod_t* m, uint16_t step) {
+  uint32_t pos = (m->phase & 0xFFFF) + step;
+  if (pos > 0xFFFF)
+    return 1;
+  m->phase = pos;
+  return 0;
+}
+
+// Envelope level in Q16
+static uint16_t env_tick(mod_t* m, uint8_t rise, uint8_t fall) {
+  if (rise)
+    env_enter(m, ENV_ATTACK); // retrigger from the current level
+  if (fall && m->type == TRAM8_MOD_ADSR && m->stage != ENV_IDLE)
+    env_enter(m, ENV_RELEASE);
+
+  uint16_t floor = m->type == TRAM8_MOD_ADSR ? m->sustain : 0;
+  switch (m->stage) {
+    case ENV_ATTACK:
+      if (env_advance(m, m->attack)) {
+        m->level = 0xFFFF;
+        env_enter(m, ENV_DECAY);
+      } else {
+        uint16_t rise_by = (uint16_t)(((uint32_t)(0xFFFF - m->from) * (0xFFFF - curve_at((uint16_t)m->phase))) >> 16);
+        m->level = m->from + rise_by;
+      }
+      break;
+    case ENV_DECAY:
+      if (env_advance(m, m->decay)) {
+        m->level = floor;
+        env_enter(m, m->type == TRAM8_MOD_ADSR ? ENV_SUSTAIN : ENV_IDLE);
+      } else {
+        m->level = floor + (uint16_t)(((uint32_t)(0xFFFF - floor) * curve_at((uint16_t)m->phase)) >> 16);
+      }
+      break;
+    case ENV_RELEASE:
+      if (env_advance(m, m->release)) {
+        m->level = 0;
+        env_enter(m, ENV_IDLE);
+      } else {
+        m->level = (uint16_t)(((uint32_t)m->from * curve_at((uint16_t)m->phase)) >> 16);
+      }
+      break;
+    default:
+      break;
+  }
+  return m->level;
+}
+
+// Bipolar LFO sample, -32768..32767
+static int16_t lfo_tick(mod_t* m, uint8_t rise) {
+  if (rise)
+    m->phase = 0;
+  uint32_t prev = m->phase;
+  m->phase += m->inc;
+  uint16_t p = (uint16_t)(m->phase >> 16);
+
+  switch (m->type) {
+    case TRAM8_MOD_TRI:
+      return (int16_t)(p < 0x8000 ? (int32_t)p * 2 - 32768 : 32767 - ((int32_t)p - 32768) * 2);
+    case TRAM8_MOD_SAW:
+      return (int16_t)((int32_t)p - 32768);
+    case TRAM8_MOD_SQUARE:
+      return p < 0x8000 ? 32767 : -32768;
+    default:
+      // sample & hold: new value each cycle
+      if (rise || m->phase < prev)
+        m->level = random16();
+      return (int16_t)(m->level ^ 0x8000);
+  }
+}
+
+void mod_tick(uint8_t gates) {
+  uint8_t rising = gates & (uint8_t)~last_gates;
+  uint8_t falling = last_gates & (uint8_t)~gates;
+  last_gates = gates;
+
+  for (uint8_t i = 0; i < TRAM8_MOD_SLOTS; i++) {
+    mod_t* m = &mods[i];
+    if (m->type == TRAM8_MOD_OFF)
+      continue;
+
+    uint8_t rise = 0, fall = 0;
+    if (m->trigger < NUM_GATES) {
+      rise = (rising >> m->trigger) & 1;
+      fall = (falling >> m->trigger) & 1;
+    }
+
+    int32_t value;
+    if (m->type >= TRAM8_MOD_AD) {
+      value = m->offset + (int32_t)(((uint32_t)m->depth * env_tick(m, rise, fall)) >> 16);
+    } else {
+      // depth is peak-to-peak around offset
+      value = m->offset + (((int32_t)m->depth * lfo_tick(m, rise)) >> 16);
+    }
+    if (value < 0)
+      value = 0;
+    if (value > TRAM8_DAC_MAX)
+      value = TRAM8_DAC_MAX;
+
+    uint8_t bit = (uint8_t)(1 << m->dest);
+    if (values_out[m->dest] != (uint16_t)value || (force & bit)) {
+      values_out[m->dest] = (uint16_t)value;
+      updated |= bit;
+    }
+  }
+  force = 0;
+}
+
+uint8_t mod_take(uint16_t values[NUM_GATES]) {
+  uint8_t mask;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    mask = updated;
+    updated = 0;
+    for (uint8_t ch = 0; ch < NUM_GATES; ch++) {
+      if ((mask >> ch) & 1)
+        values[ch] = values_out[ch];
+    }
+  }
+  return mask;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef MODULATOR_H
+#define MODULATOR_H
+
+#include <stdint.h>
+
+#include "../../protocol/tram8_sysex.h"
+#include "hardware_config.h"
+
+// Bank of LFO / envelope generators run from the 1 kHz timer. Each slot
+// drives one DAC channel and can be retriggered by a gate. Like ramps, the
+// ISR only computes values; the main loop collects them with mod_take().
+// Built in with TRAM8_MODULATOR; without it these are no-ops.
+
+#if TRAM8_MODULATOR
+
+void mod_set(uint8_t slot, tram8_mod_param_t param, uint16_t value);
+
+// Turns every generator off
+void mod_reset(void);
+
+// Timer ISR, once per tick. gates is the current gate mask.
+void mod_tick(uint8_t gates);
+
+// Copies values updated since the last call; returns their channel mask
+uint8_t mod_take(uint16_t values[NUM_GATES]);
+
+// Channels currently owned by a generator
+uint8_t mod_channels(void);
+
+#else
+
+static inline void mod_set(uint8_t slot, tram8_mod_param_t param, uint16_t value) {
+  (void)slot;
+  (void)param;
+  (void)value;
+}
+
+static inline void mod_reset(void) {}
+
+static inline void mod_tick(uint8_t gates) {
+  (void)gates;
+}
+
+static inline uint8_t mod_take(uint16_t values[NUM_GATES]) {
+  (void)values;
+  return 0;
+}
+
+static inline uint8_t mod_channels(void) {
+  return 0;
+}
+
+#endif
+
+#endif
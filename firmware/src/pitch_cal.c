@@ -0,0 +1,27 @@
+#include "pitch_cal.h"
+
+#include "../../protocol/tram8_sysex.h"
+#include "eeprom_queue.h"
+
+uint16_t pitch_cal_code(uint8_t channel, uint8_t note) {
+  uint8_t raw[4];
+  eeprom_queue_read_block(raw, EEPROM_CAL_ADDR + (channel & 0x07) * 4, sizeof(raw));
+
+  int16_t offset = (int16_t)(raw[0] | (raw[1] << 8));
+  uint16_t gain = (uint16_t)(raw[2] | (raw[3] << 8));
+  if (gain == 0xFFFF) {
+    // Erased EEPROM
+    offset = TRAM8_CAL_OFFSET_DEFAULT;
+    gain = TRAM8_CAL_GAIN_DEFAULT;
+  }
+  return tram8_pitch_to_dac(note, offset, gain);
+}
+
+void pitch_cal_set(uint8_t channel, int16_t offset, uint16_t gain) {
+  uint8_t raw[4];
+  raw[0] = (uint8_t)offset;
+  raw[1] = (uint8_t)((uint16_t)offset >> 8);
+  raw[2] = (uint8_t)gain;
+  raw[3] = (uint8_t)(gain >> 8);
+  eeprom_queue_write_block(raw, EEPROM_CAL_ADDR + (channel & 0x07) * 4, sizeof(raw));
+}
@@ -0,0 +1,17 @@
+#ifndef PITCH_CAL_H
+#define PITCH_CAL_H
+
+#include <stdint.h>
+
+#include "hardware_config.h"
+
+// Per-channel 1 V/oct calibration for pitch mode, kept in the EEPROM image.
+// Erased entries fall back to the nominal offset/gain.
+
+// Note -> 12-bit DAC code through the channel's calibration
+uint16_t pitch_cal_code(uint8_t channel, uint8_t note);
+
+// Stores a channel's calibration (queued EEPROM write)
+void pitch_cal_set(uint8_t channel, int16_t offset, uint16_t gain);
+
+#endif
@@ -0,0 +1,100 @@
+#include "ramp.h"
+
+#if TRAM8_RAMP
+
+#include <util/atomic.h>
+
+#define RAMP_PHASE_ONE (1UL << 24)
+
+typedef struct {
+  uint16_t from;
+  int16_t span; // target - from
+  uint32_t phase; // progress, RAMP_PHASE_ONE at the target
+  uint32_t step; // phase advance per tick
+  uint16_t left; // ticks to go
+  uint8_t curve;
+} ramp_t;
+
+static ramp_t ramps[NUM_GATES];
+static volatile uint8_t active = 0;
+static volatile uint8_t updated = 0;
+static volatile uint16_t values_out[NUM_GATES];
+
+// Shapes linear progress p (0-65535) into curve progress (0-65535)
+static uint16_t shape(uint8_t curve, uint16_t p) {
+  uint16_t q;
+  switch (curve) {
+    case TRAM8_CURVE_EASE_IN:
+      return (uint16_t)(((uint32_t)p * p) >> 16);
+    case TRAM8_CURVE_EASE_OUT:
+      q = 0xFFFF - p;
+      return (uint16_t)(0xFFFF - (((uint32_t)q * q) >> 16));
+    case TRAM8_CURVE_S:
+      // 3p^2 - 2p^3
+      q = (uint16_t)(((uint32_t)p * p) >> 16);
+      return (uint16_t)(((uint32_t)(q >> 1) * (98304UL - p)) >> 14);
+    default:
+      return p;
+  }
+}
+
+void ramp_start(uint8_t channel, uint16_t from, uint16_t target, uint16_t duration_ms, tram8_curve_t curve) {
+  channel &= 0x07;
+  uint8_t bit = (uint8_t)(1 << channel);
+  ramp_t* r = &ramps[channel];
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (active & bit)
+      from = values_out[channel]; // retarget from where the running ramp is
+    r->from = from;
+    r->span = (int16_t)(target - from);
+    r->phase = 0;
+    r->step = duration_ms ? RAMP_PHASE_ONE / duration_ms : RAMP_PHASE_ONE;
+    r->left = duration_ms ? duration_ms : 1;
+    r->curve = curve;
+    active |= bit;
+  }
+}
+
+void ramp_stop(uint8_t mask) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    active &= (uint8_t)~mask;
+    updated &= (uint8_t)~mask;
+  }
+}
+
+void ramp_tick(void) {
+  uint8_t live = active;
+  for (uint8_t ch = 0; live; ch++, live >>= 1) {
+    if (!(live & 1))
+      continue;
+    ramp_t* r = &ramps[ch];
+    r->phase += r->step;
+
+    uint16_t value;
+    if (--r->left == 0) {
+      value = (uint16_t)(r->from + r->span);
+      active &= (uint8_t)~(1 << ch);
+    } else {
+      uint16_t p = (uint16_t)(r->phase >> 8);
+      value = (uint16_t)(r->from + (int16_t)(((int32_t)r->span * shape(r->curve, p)) >> 16));
+    }
+    values_out[ch] = value;
+    updated |= (uint8_t)(1 << ch);
+  }
+}
+
+uint8_t ramp_take(uint16_t values[NUM_GATES]) {
+  uint8_t mask;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    mask = updated;
+    updated = 0;
+    for (uint8_t ch = 0; ch < NUM_GATES; ch++) {
+      if ((mask >> ch) & 1)
+        values[ch] = values_out[ch];
+    }
+  }
+  return mask;
+}
+
+#endif
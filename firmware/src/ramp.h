@@ -0,0 +1,52 @@
+#ifndef RAMP_H
+#define RAMP_H
+
+#include <stdint.h>
+
+#include "../../protocol/tram8_sysex.h"
+#include "hardware_config.h"
+
+// Per-channel DAC ramps interpolated in the 1 kHz timer tick. The ISR only
+// updates the accumulators; the main loop collects the new values with
+// ramp_take() and sends them through the staged DAC path. Built in with
+// TRAM8_RAMP; without it these are no-ops.
+
+#if TRAM8_RAMP
+
+// from is ignored if the channel is already ramping; the new ramp picks up
+// from the running one's current value
+void ramp_start(uint8_t channel, uint16_t from, uint16_t target, uint16_t duration_ms, tram8_curve_t curve);
+
+// Cancels ramps on the channels in mask (a direct write took over)
+void ramp_stop(uint8_t mask);
+
+// Timer ISR, once per tick
+void ramp_tick(void);
+
+// Copies values updated since the last call; returns their channel mask
+uint8_t ramp_take(uint16_t values[NUM_GATES]);
+
+#else
+
+static inline void ramp_start(uint8_t channel, uint16_t from, uint16_t target, uint16_t duration_ms, tram8_curve_t curve) {
+  (void)channel;
+  (void)from;
+  (void)target;
+  (void)duration_ms;
+  (void)curve;
+}
+
+static inline void ramp_stop(uint8_t mask) {
+  (void)mask;
+}
+
+static inline void ramp_tick(void) {}
+
+static inline uint8_t ramp_take(uint16_t values[NUM_GATES]) {
+  (void)values;
+  return 0;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,187 @@
+#include "scheduler.h"
+
+#if TRAM8_SCHEDULER
+
+#include <util/atomic.h>
+
+#include "gpio.h"
+#include "max5825_control.h"
+#include "trigger.h"
+
+typedef struct {
+  uint16_t due;
+  uint8_t gates;
+  uint8_t dac_mask;
+  uint16_t dac[NUM_GATES];
+} sched_event_t;
+
+#define ARM_NONE 0 // head codes not written yet
+#define ARM_QUEUED 1 // head codes on the TWI queue
+#define ARM_READY 2 // head codes in the CODE registers, waiting for LDAC
+
+static sched_event_t events[SCHED_QUEUE_SIZE];
+static volatile uint8_t ev_head = 0;
+static volatile uint8_t ev_count = 0;
+static volatile uint8_t armed = ARM_NONE;
+static volatile uint16_t now = 0;
+static uint16_t last_due = 0;
+static volatile uint8_t fired = 0;
+static volatile uint8_t target = 0; // gate target, from the last event or sched_set_gates()
+static volatile uint8_t settling = 0; // CV loaded this tick, rising gates wait for the next
+static volatile uint8_t raising = 0; // gates the settling event holds high
+static volatile uint8_t rising = 0; // trigger gates to fire with them
+static uint16_t late = 0;
+
+static inline uint8_t is_due(uint16_t due, uint16_t t) {
+  return (int16_t)(t - due) >= 0;
+}
+
+void sched_clear(void) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    ev_count = 0;
+    armed = ARM_NONE;
+    settling = 0;
+    raising = 0;
+    rising = 0;
+  }
+}
+
+uint8_t sched_push(uint16_t ticks, uint8_t gates, const uint16_t dac[NUM_GATES], uint8_t dac_mask) {
+  if (ev_count >= SCHED_QUEUE_SIZE)
+    return 0;
+
+  uint16_t t;
+  uint8_t slot;
+  uint8_t queued;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    t = now;
+    queued = ev_count;
+    slot = (ev_head + ev_count) % SCHED_QUEUE_SIZE;
+  }
+
+  sched_event_t* e = &events[slot];
+  // Chain off the previous event unless the schedule has run dry
+  e->due = (queued ? last_due : t) + ticks;
+  e->gates = gates;
+  e->dac_mask = dac_mask;
+  for (uint8_t ch = 0; ch < NUM_GATES; ch++)
+    e->dac[ch] = dac[ch];
+  last_due = e->due;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    ev_count++;
+  }
+  return 1;
+}
+
+// Head event's codes are in the CODE registers: load them and drop falling
+// gates at once. Rising gates and triggers go up on the next tick, by when
+// the CV has long settled, rather than busy-waiting DAC_SETTLE_US in the ISR.
+static void fire_head(void) {
+  const sched_event_t* e = &events[ev_head];
+  if (e->dac_mask) {
+    max5825_ldac_pulse();
+    settling = 1;
+  }
+  // Claimed trigger gates ignore the mask and pulse on a rising bit instead
+  uint8_t up = e->gates & (uint8_t)~target;
+  target = e->gates;
+  if (settling) {
+    gate_set_mask(gate_get_mask() & e->gates);
+    raising = e->gates;
+    rising = (rising | up) & e->gates;
+  } else {
+    gate_set_mask(e->gates);
+    trigger_fire(up);
+  }
+
+  ev_head = (ev_head + 1) % SCHED_QUEUE_SIZE;
+  ev_count--;
+  armed = ARM_NONE;
+  fired++;
+}
+
+// Gate-only events need nothing preloaded
+static inline uint8_t head_ready(void) {
+  return armed == ARM_READY || events[ev_head].dac_mask == 0;
+}
+
+void sched_tick(void) {
+  now++;
+  if (settling) {
+    // Only the event's own gates go up. Others raised since wait for their
+    // own DAC writes, and any dropped since stay down.
+    settling = 0;
+    gate_set_mask(gate_get_mask() | (raising & target));
+    trigger_fire(rising);
+    rising = 0;
+  }
+  while (ev_count && head_ready() && is_due(events[ev_head].due, now))
+    fire_head();
+}
+
+void sched_service(void) {
+  if (!ev_count)
+    return;
+
+  if (armed == ARM_NONE) {
+    uint8_t head = ev_head;
+    uint16_t t;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      t = now;
+    }
+    // Gate-only events fire from the ISR as they are; others preload just
+    // before their tick, since other DAC loads are held off meanwhile
+    if (!events[head].dac_mask || !is_due(events[head].due - SCHED_PRELOAD_TICKS, t))
+      return;
+    // Shadowed writes skip channels already holding the code
+    max5825_write_codes_async(events[head].dac, events[head].dac_mask);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if (ev_count && ev_head == head)
+        armed = ARM_QUEUED; // otherwise the ISR fired it meanwhile
+    }
+  }
+  if (armed == ARM_QUEUED && !twi_async_busy()) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      armed = ARM_READY;
+      if (is_due(events[ev_head].due, now)) {
+        late++;
+        fire_head();
+      }
+    }
+  }
+}
+
+void sched_drop_dac(uint8_t mask) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    for (uint8_t i = 0; i < ev_count; i++)
+      events[(ev_head + i) % SCHED_QUEUE_SIZE].dac_mask &= (uint8_t)~mask;
+  }
+}
+
+uint8_t sched_holds_dac(void) {
+  return armed != ARM_NONE;
+}
+
+uint8_t sched_gates(void) {
+  return target;
+}
+
+void sched_set_gates(uint8_t mask) {
+  target = mask;
+}
+
+uint8_t sched_take_fired(void) {
+  uint8_t n;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    n = fired;
+    fired = 0;
+  }
+  return n;
+}
+
+uint16_t sched_late_count(void) {
+  return late;
+}
+
+#endif
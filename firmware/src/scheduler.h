@@ -0,0 +1,106 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+#include "hardware_config.h"
+
+// Scheduled state changes fired from the 1 kHz timer.
+//
+// Events are due a number of ticks after the previous event (or after now if
+// the schedule has run dry), so the queue stays in due order. The main loop
+// preloads the head event's codes into the DAC CODE registers shortly before
+// its tick; the timer ISR then only has to pulse LDAC and drop falling gates,
+// landing the CV on the exact tick. Gates the event raises go up one tick
+// later, once the CV has settled. An event whose codes have not landed by
+// its tick fires from the main loop as soon as they have.
+//
+// LDAC loads every channel at once, so any other load while codes are
+// preloaded would put the event's CV out early. Immediate DAC traffic
+// (frames, ramps, bends) on any channel therefore waits while
+// sched_holds_dac() is set, at most SCHED_PRELOAD_TICKS plus the bus time.
+//
+// Built in with TRAM8_SCHEDULER; without it these are no-ops and nothing is
+// ever queued.
+
+#define SCHED_QUEUE_SIZE 4
+#define SCHED_PRELOAD_TICKS 2 // a full eight-channel write takes under 1 ms at 400 kHz
+
+#if TRAM8_SCHEDULER
+
+// Returns 0 if the queue is full
+uint8_t sched_push(uint16_t ticks, uint8_t gates, const uint16_t dac[NUM_GATES], uint8_t dac_mask);
+
+// Drops everything queued
+void sched_clear(void);
+
+// Timer ISR, once per tick
+void sched_tick(void);
+
+// Main loop: preloads the head event and fires late ones
+void sched_service(void);
+
+// Takes the channels in mask out of every queued event's DAC writes. Codes
+// already preloaded stay in the CODE registers until something overwrites them.
+void sched_drop_dac(uint8_t mask);
+
+// True while the head event's codes are queued or waiting in the CODE
+// registers; other DAC writes and LDAC pulses must wait until it fires
+uint8_t sched_holds_dac(void);
+
+// Number of events fired since the last call; gates may have changed
+uint8_t sched_take_fired(void);
+
+// Gate mask of the last event fired; the outputs reach it by the next tick
+uint8_t sched_gates(void);
+
+// Gate target set outside the schedule. Events fire trigger gates on the
+// bits they raise relative to it.
+void sched_set_gates(uint8_t mask);
+
+// Events that fired after their tick
+uint16_t sched_late_count(void);
+
+#else
+
+static inline uint8_t sched_push(uint16_t ticks, uint8_t gates, const uint16_t dac[NUM_GATES], uint8_t dac_mask) {
+  (void)ticks;
+  (void)gates;
+  (void)dac;
+  (void)dac_mask;
+  return 0;
+}
+
+static inline void sched_clear(void) {}
+
+static inline void sched_tick(void) {}
+
+static inline void sched_service(void) {}
+
+static inline void sched_drop_dac(uint8_t mask) {
+  (void)mask;
+}
+
+static inline uint8_t sched_holds_dac(void) {
+  return 0;
+}
+
+static inline uint8_t sched_take_fired(void) {
+  return 0;
+}
+
+static inline uint8_t sched_gates(void) {
+  return 0;
+}
+
+static inline void sched_set_gates(uint8_t mask) {
+  (void)mask;
+}
+
+static inline uint16_t sched_late_count(void) {
+  return 0;
+}
+
+#endif
+
+#endif
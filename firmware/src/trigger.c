@@ -0,0 +1,149 @@
+#include "trigger.h"
+
+#if TRAM8_TRIGGER
+
+#include <util/atomic.h>
+
+#include "eeprom_queue.h"
+#include "gpio.h"
+
+static uint8_t trig_mask = 0;
+static uint8_t clock_mask = 0;
+static uint8_t pending = 0;
+static uint8_t pulse_ms[NUM_GATES];
+static volatile uint8_t count[NUM_GATES];
+static volatile uint8_t in_pulse = 0;
+static volatile uint8_t in_gap = 0;
+
+static void load(uint8_t gate) {
+  uint8_t ms = eeprom_queue_read(EEPROM_TRIG_PULSE_ADDR + gate);
+  uint8_t bit = (uint8_t)(1 << gate);
+  if (ms == 0 || ms == 0xFF) { // off, or erased EEPROM
+    pulse_ms[gate] = 0;
+    trig_mask &= (uint8_t)~bit;
+  } else {
+    pulse_ms[gate] = ms;
+    trig_mask |= bit;
+  }
+}
+
+static uint8_t width(uint8_t gate) {
+  return pulse_ms[gate] ? pulse_ms[gate] : CLOCK_PULSE_MS;
+}
+
+static void claim(void) {
+  gate_claim(trig_mask | clock_mask);
+}
+
+void trigger_init(void) {
+  for (uint8_t g = 0; g < NUM_GATES; g++)
+    load(g);
+  claim();
+}
+
+void trigger_config(uint8_t gate, uint8_t pulse, uint8_t gap_ms) {
+  if (gate >= NUM_GATES)
+    return;
+  eeprom_queue_write(EEPROM_TRIG_PULSE_ADDR + gate, pulse & 0x7F);
+  eeprom_queue_write(EEPROM_TRIG_GAP_ADDR + gate, gap_ms & 0x7F);
+
+  uint8_t bit = (uint8_t)(1 << gate);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    in_pulse &= (uint8_t)~bit;
+    in_gap &= (uint8_t)~bit;
+    gate_set_claimed(bit, 0);
+    load(gate);
+    claim();
+  }
+}
+
+#if TRAM8_CLOCK
+void trigger_set_clocked(uint8_t mask) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    uint8_t released = clock_mask & (uint8_t)~mask & (uint8_t)~trig_mask;
+    in_pulse &= (uint8_t)~released;
+    in_gap &= (uint8_t)~released;
+    gate_set_claimed(released, 0);
+    clock_mask = mask;
+    claim();
+  }
+}
+#endif
+
+uint8_t trigger_gates(void) {
+  return trig_mask;
+}
+
+void trigger_queue(uint8_t bits) {
+  pending |= bits & trig_mask;
+}
+
+static void fire(uint8_t bits) {
+  for (uint8_t g = 0; bits; g++, bits >>= 1) {
+    if (!(bits & 1))
+      continue;
+    uint8_t bit = (uint8_t)(1 << g);
+    uint8_t gap = eeprom_queue_read(EEPROM_TRIG_GAP_ADDR + g);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if ((gate_get_mask() & bit) && gap && gap != 0xFF) {
+        // Legato: low for the gap, then the pulse
+        gate_set_claimed(bit, 0);
+        count[g] = gap;
+        in_pulse &= (uint8_t)~bit;
+        in_gap |= bit;
+      } else {
+        gate_set_claimed(bit, bit);
+        count[g] = width(g);
+        in_gap &= (uint8_t)~bit;
+        in_pulse |= bit;
+      }
+    }
+  }
+}
+
+void trigger_fire_pending(void) {
+  uint8_t bits = pending;
+  pending = 0;
+  fire(bits);
+}
+
+#if TRAM8_CLOCK
+void trigger_pulse(uint8_t bits) {
+  fire(bits & clock_mask);
+}
+#endif
+
+void trigger_fire(uint8_t bits) {
+  fire(bits & trig_mask);
+}
+
+void trigger_reset(void) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    pending = 0;
+    in_pulse = 0;
+    in_gap = 0;
+    gate_set_claimed(trig_mask | clock_mask, 0);
+  }
+}
+
+void trigger_tick(void) {
+  uint8_t live = in_pulse | in_gap;
+  for (uint8_t g = 0; live; g++, live >>= 1) {
+    if (!(live & 1) || --count[g])
+      continue;
+
+    uint8_t bit = (uint8_t)(1 << g);
+    if (in_gap & bit) {
+      in_gap &= (uint8_t)~bit;
+      in_pulse |= bit;
+      count[g] = width(g);
+      gate_set_claimed(bit, bit);
+    } else {
+      in_pulse &= (uint8_t)~bit;
+      gate_set_claimed(bit, 0);
+    }
+  }
+}
+
+#endif
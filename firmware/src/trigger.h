@@ -0,0 +1,77 @@
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include <stdint.h>
+
+#include "hardware_config.h"
+
+// Per-gate trigger mode. A gate with a pulse width set is claimed from the
+// normal gate path: note-ons fire a pulse that the 1 kHz timer ends, so no
+// note-off is needed. Firing a gate that is still high drops it for the
+// gate's legato gap first, so the retrigger is a clean edge. Built in with
+// TRAM8_TRIGGER; without it these are no-ops.
+
+#if TRAM8_TRIGGER
+
+// Loads the widths from the EEPROM image and claims trigger gates
+void trigger_init(void);
+
+// pulse_ms = 0 returns the gate to normal gate mode (queued EEPROM write)
+void trigger_config(uint8_t gate, uint8_t pulse_ms, uint8_t gap_ms);
+
+uint8_t trigger_gates(void);
+
+// Marks gates to fire at the next trigger_fire_pending(); non-trigger
+// gates in bits are ignored
+void trigger_queue(uint8_t bits);
+
+// Fires the queued pulses. Called once the CV they go with has landed.
+void trigger_fire_pending(void);
+
+#if TRAM8_CLOCK
+// Gates driven by the clock outputs. They are claimed like trigger gates
+// but only fire through trigger_pulse(); their width is the gate's trigger
+// width if it has one, else CLOCK_PULSE_MS.
+void trigger_set_clocked(uint8_t mask);
+
+// Fires clock gates in bits straight away (safe from the timer ISR)
+void trigger_pulse(uint8_t bits);
+#endif
+
+// Fires trigger gates in bits straight away (safe from the timer ISR), for
+// note-ons that arrive through scheduled frames
+void trigger_fire(uint8_t bits);
+
+// Ends every pulse and drops the trigger gates
+void trigger_reset(void);
+
+// Timer ISR, once per tick
+void trigger_tick(void);
+
+#else
+
+static inline void trigger_init(void) {}
+
+static inline void trigger_config(uint8_t gate, uint8_t pulse_ms, uint8_t gap_ms) {
+  (void)gate;
+  (void)pulse_ms;
+  (void)gap_ms;
+}
+
+static inline void trigger_queue(uint8_t bits) {
+  (void)bits;
+}
+
+static inline void trigger_fire_pending(void) {}
+
+static inline void trigger_fire(uint8_t bits) {
+  (void)bits;
+}
+
+static inline void trigger_reset(void) {}
+
+static inline void trigger_tick(void) {}
+
+#endif
+
+#endif
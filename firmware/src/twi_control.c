@@ -0,0 +1,87 @@
+#include "twi_control.h"
+
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/twi.h>
+
+// Byte ring of queued transactions, each stored as <addr> <len> <data...>.
+// The ISR frees bytes as it sends them.
+static volatile uint8_t queue[TWI_QUEUE_SIZE];
+static volatile uint8_t q_head = 0;
+static volatile uint8_t q_tail = 0;
+static volatile uint8_t q_left = 0;
+static volatile uint8_t q_busy = 0;
+
+void twi_async_write(uint8_t addr, const uint8_t* data, uint8_t len) {
+  if (len > TWI_MAX_DATA)
+    len = TWI_MAX_DATA;
+
+  uint8_t head = q_head;
+  while ((uint8_t)((q_tail - head - 1) & TWI_QUEUE_MASK) < len + 2)
+    ; // full: the ISR frees bytes as it sends them
+
+  queue[head] = addr;
+  head = (head + 1) & TWI_QUEUE_MASK;
+  queue[head] = len;
+  head = (head + 1) & TWI_QUEUE_MASK;
+  for (uint8_t i = 0; i < len; i++) {
+    queue[head] = data[i];
+    head = (head + 1) & TWI_QUEUE_MASK;
+  }
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    q_head = head;
+    if (!q_busy) {
+      q_busy = 1;
+      TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
+    }
+  }
+}
+
+uint8_t twi_async_busy(void) {
+  return q_busy;
+}
+
+void twi_async_flush(void) {
+  while (q_busy)
+    ;
+}
+
+ISR(TWI_vect) {
+  uint8_t tail = q_tail;
+  uint8_t cr = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
+
+  switch (TW_STATUS) {
+    case TW_START:
+    case TW_REP_START:
+      TWDR = queue[tail];
+      q_left = queue[(tail + 1) & TWI_QUEUE_MASK];
+      q_tail = (tail + 2) & TWI_QUEUE_MASK;
+      TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+      return;
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+      if (q_left) {
+        TWDR = queue[tail];
+        q_tail = (tail + 1) & TWI_QUEUE_MASK;
+        q_left--;
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+        return;
+      }
+      break;
+    default:
+      // NACK or arbitration loss: drop the rest of the transaction, release the bus
+      q_tail = (tail + q_left) & TWI_QUEUE_MASK;
+      q_left = 0;
+      cr |= (1 << TWSTO);
+      break;
+  }
+
+  if (q_tail != q_head) {
+    TWCR = cr;
+    return;
+  }
+
+  TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+  q_busy = 0;
+}
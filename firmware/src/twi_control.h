@@ -2,6 +2,7 @@
 #define TWI_CONTROL_H
 
 #include <avr/io.h>
+#include <stdint.h>
 
 #ifndef F_CPU
 #define F_CPU 16000000UL
@@ -11,12 +12,18 @@
 #define TWI_FREQ 400000UL
 #endif
 
+#define TWI_QUEUE_SIZE 64
+#define TWI_QUEUE_MASK (TWI_QUEUE_SIZE - 1)
+#define TWI_MAX_DATA 24
+
 static inline void twi_init(void) {
   TWSR = 0x00;
   TWBR = (uint8_t)(((F_CPU / TWI_FREQ) - 16) / 2);
   TWCR = (1 << TWEN);
 }
 
+// Blocking primitives. Only valid while the async queue is idle (see twi_async_flush).
+
 static inline void twi_start(void) {
   TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
   while (!(TWCR & (1 << TWINT)))
@@ -35,4 +42,13 @@ static inline void twi_write(uint8_t data) {
     ;
 }
 
+// Interrupt-driven transmit queue. Each entry is one START/SLA+W/data/STOP
+// transaction; back-to-back entries are chained with a repeated START.
+// twi_async_write() returns as soon as the transaction is queued and only
+// waits if the queue is full, so it must be called with interrupts enabled.
+
+void twi_async_write(uint8_t addr, const uint8_t* data, uint8_t len);
+uint8_t twi_async_busy(void);
+void twi_async_flush(void);
+
 #endif
@@ -0,0 +1,313 @@
+#include "../../protocol/tram8_sysex.h"
+#include "../src/gpio.h"
+#include "../src/hardware_config.h"
+#include "../src/max5825_control.h"
+#include "mock/host_main.h"
+#include <stdio.h>
+#include <string.h>
+
+// Hot-path regression suite: boots the whole firmware on the host, plays
+// message streams into it, and totals main loop passes, TWI bytes and port
+// accesses per stream. The mocked peripherals make every count exact, so
+// each scenario carries a budget and any increase fails the run. Lower a
+// budget when a change beats it.
+
+#define MAX_MSGS 128
+
+// Output checks run after a scenario to make sure the firmware did the work
+#define CHECK_GATES 0x01 // gates match the last state sent
+#define CHECK_DACS 0x02 // DACs match the last values sent
+#define CHECK_STATS 0x04 // one well-formed stats reply per query
+
+typedef struct {
+  const char* name;
+  uint8_t mode;
+  uint32_t (*build)(void); // fills msgs, returns the count
+  uint8_t checks;
+  host_cost_t budget; // totals over the stream; tx_bytes unchecked
+} scenario_t;
+
+static uint8_t pool[MAX_MSGS][TRAM8_LEN_MAX];
+static host_msg_t msgs[MAX_MSGS];
+static host_cost_t costs[MAX_MSGS];
+static uint16_t last_dac[TRAM8_NUM_GATES];
+static uint8_t last_gates;
+
+static uint32_t rng = 0x2545F491u;
+
+static uint32_t rng_next(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void add(uint32_t i, uint8_t len) {
+  msgs[i].bytes = pool[i];
+  msgs[i].len = len;
+}
+
+static void add3(uint32_t i, uint8_t status, uint8_t d1, uint8_t d2) {
+  pool[i][0] = status;
+  pool[i][1] = d1;
+  pool[i][2] = d2;
+  add(i, 3);
+}
+
+static void random_dacs(void) {
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    last_dac[ch] = (uint16_t)(rng_next() & TRAM8_DAC_MAX);
+}
+
+static uint32_t build_gates(void) {
+  for (uint32_t i = 0; i < 64; i++) {
+    last_gates = (uint8_t)rng_next();
+    add(i, tram8_pack(pool[i], last_gates, last_dac, TRAM8_FORM_GATES));
+  }
+  return 64;
+}
+
+static uint32_t build_full(void) {
+  for (uint32_t i = 0; i < 64; i++) {
+    last_gates = (uint8_t)rng_next();
+    random_dacs();
+    add(i, tram8_pack(pool[i], last_gates, last_dac, TRAM8_FORM_FULL));
+  }
+  return 64;
+}
+
+static uint32_t build_delta(void) {
+  memset(last_dac, 0, sizeof(last_dac));
+  for (uint32_t i = 0; i < 64; i++) {
+    uint8_t ch = (uint8_t)(i % TRAM8_NUM_GATES);
+    last_gates = (uint8_t)(1 << ch);
+    last_dac[ch] = (uint16_t)(rng_next() & TRAM8_DAC_MAX);
+    add(i, tram8_pack_delta(pool[i], last_gates, last_dac, (uint8_t)(1 << ch)));
+  }
+  return 64;
+}
+
+// Every other frame is cut short, by a status byte or by the next frame's
+// F0: none of what it carried may reach the outputs
+static uint32_t build_aborted(void) {
+  memset(last_dac, 0, sizeof(last_dac));
+  last_gates = 0;
+  for (uint32_t i = 0; i < 64; i++) {
+    uint8_t ch = (uint8_t)((i / 2) % TRAM8_NUM_GATES);
+    if (!(i & 1)) {
+      last_gates ^= (uint8_t)(1 << ch);
+      last_dac[ch] = (uint16_t)(rng_next() & TRAM8_DAC_MAX);
+      add(i, tram8_pack_delta(pool[i], last_gates, last_dac, (uint8_t)(1 << ch)));
+      continue;
+    }
+    uint16_t junk[TRAM8_NUM_GATES];
+    for (int c = 0; c < TRAM8_NUM_GATES; c++)
+      junk[c] = (uint16_t)(rng_next() & TRAM8_DAC_MAX);
+    uint8_t len = tram8_pack_delta(pool[i], (uint8_t)~last_gates, junk, 0xFF);
+    if (i & 2)
+      pool[i][len - 1] = TRAM8_CV_NOTE_OFF; // status byte instead of F7
+    else
+      len--; // no F7 at all
+    add(i, len);
+  }
+  return 64;
+}
+
+// An idle envelope on channel 3 holds it at its floor. Frames, bends, ramps
+// and scheduled state all aim at that channel too and must not take it over.
+#define OWNED_CH 3
+#define OWNED_LEVEL 0x600
+
+static uint32_t build_owned(void) {
+  static const uint16_t setup[][2] = {
+      {TRAM8_MOD_DEST, OWNED_CH}, {TRAM8_MOD_DEPTH, 0}, {TRAM8_MOD_OFFSET, OWNED_LEVEL}, {TRAM8_MOD_TYPE, TRAM8_MOD_AD}};
+  uint32_t n = 0;
+  for (; n < 4; n++)
+    add(n, tram8_pack_mod(pool[n], 0, (tram8_mod_param_t)setup[n][0], setup[n][1]));
+
+  memset(last_dac, 0, sizeof(last_dac));
+  last_gates = 0;
+  for (; n < 64; n++) {
+    uint16_t value = (uint16_t)(rng_next() & TRAM8_DAC_MAX);
+    switch (n & 3) {
+      case 0:
+        last_gates = (uint8_t)rng_next();
+        random_dacs();
+        add(n, tram8_pack(pool[n], last_gates, last_dac, TRAM8_FORM_FULL));
+        break;
+      case 1: {
+        uint8_t lsb, msb;
+        tram8_dac_to_bend(value, &lsb, &msb);
+        add3(n, TRAM8_CV_BEND | OWNED_CH, lsb, msb);
+        break;
+      }
+      case 2:
+        add(n, tram8_pack_ramp(pool[n], OWNED_CH, value, 0, TRAM8_CURVE_LINEAR));
+        break;
+      default:
+        last_dac[OWNED_CH] = value;
+        add(n, tram8_pack_scheduled(pool[n], 0, last_gates, last_dac, 0xFF));
+        break;
+    }
+  }
+  last_dac[OWNED_CH] = OWNED_LEVEL;
+  return 64;
+}
+
+// The same full frame over and over: every DAC write is skipped by the shadow
+static uint32_t build_repeat(void) {
+  last_gates = 0x5A;
+  random_dacs();
+  for (uint32_t i = 0; i < 64; i++)
+    add(i, tram8_pack(pool[i], last_gates, last_dac, TRAM8_FORM_FULL));
+  return 64;
+}
+
+static uint32_t build_bend(void) {
+  for (uint32_t i = 0; i < 64; i++) {
+    uint8_t ch = (uint8_t)(i % TRAM8_NUM_GATES);
+    uint8_t lsb, msb;
+    last_dac[ch] = (uint16_t)(rng_next() & TRAM8_DAC_MAX);
+    tram8_dac_to_bend(last_dac[ch], &lsb, &msb);
+    add3(i, (uint8_t)(TRAM8_CV_BEND | ch), lsb, msb);
+  }
+  return 64;
+}
+
+static uint32_t build_gate_notes(void) {
+  for (uint32_t i = 0; i < 64; i++) {
+    uint8_t gate = (uint8_t)((i / 2) % TRAM8_NUM_GATES);
+    if (i & 1)
+      add3(i, TRAM8_CV_NOTE_OFF, gate, 0);
+    else
+      add3(i, TRAM8_CV_NOTE_ON, gate, TRAM8_CV_GATE_ON_VELOCITY);
+  }
+  last_gates = 0;
+  return 64;
+}
+
+// Default mapping: channel 10, notes 60-67 on gates 0-7
+static uint32_t build_velocity(void) {
+  for (uint32_t i = 0; i < 64; i++) {
+    uint8_t note = (uint8_t)(60 + (i / 2) % NUM_GATES);
+    add3(i, (i & 1) ? 0x89 : 0x99, note, (uint8_t)(16 + i));
+  }
+  return 64;
+}
+
+static uint32_t build_cc(void) {
+  for (uint32_t i = 0; i < 64; i++)
+    add3(i, 0xB9, (uint8_t)(69 + i % NUM_GATES), (uint8_t)(rng_next() & 0x7F));
+  return 64;
+}
+
+static uint32_t build_pitch(void) {
+  for (uint32_t i = 0; i < 64; i++) {
+    uint8_t ch = (uint8_t)((i / 2) % NUM_GATES);
+    uint8_t note = (uint8_t)(36 + (i * 7) % 24);
+    if (i & 1)
+      add3(i, (uint8_t)(0x80 | ch), pool[i - 1][1], 0);
+    else
+      add3(i, (uint8_t)(0x90 | ch), note, 100);
+  }
+  return 64;
+}
+
+static uint32_t build_stats(void) {
+  for (uint32_t i = 0; i < 8; i++)
+    add(i, tram8_pack_stats_query(pool[i]));
+  return 8;
+}
+
+static const scenario_t scenarios[] = {
+    {"sysex gates", MODE_SYSEX, build_gates, CHECK_GATES, {512, 0, 640, 0}},
+    {"sysex full", MODE_SYSEX, build_full, CHECK_GATES | CHECK_DACS, {1472, 1600, 640, 0}},
+    {"sysex delta", MODE_SYSEX, build_delta, CHECK_GATES | CHECK_DACS, {832, 256, 640, 0}},
+    {"sysex repeat", MODE_SYSEX, build_repeat, CHECK_GATES | CHECK_DACS, {1409, 25, 640, 0}},
+    {"sysex bend", MODE_SYSEX, build_bend, CHECK_DACS, {384, 256, 384, 0}},
+    {"sysex notes", MODE_SYSEX, build_gate_notes, CHECK_GATES, {320, 0, 640, 0}},
+    {"velocity", MODE_VELOCITY, build_velocity, 0, {384, 256, 640, 0}},
+    {"cc", MODE_CC, build_cc, 0, {384, 256, 384, 0}},
+    {"pitch", MODE_PITCH, build_pitch, 0, {352, 128, 640, 0}},
+    {"stats query", MODE_SYSEX, build_stats, CHECK_STATS, {296, 0, 0, 0}},
+    {"sysex aborted", MODE_SYSEX, build_aborted, CHECK_GATES | CHECK_DACS, {1200, 128, 320, 0}},
+    {"sysex owned", MODE_SYSEX, build_owned, CHECK_GATES | CHECK_DACS, {993, 334, 302, 0}},
+};
+
+static int outputs_match(const scenario_t* s, uint32_t count) {
+  if ((s->checks & CHECK_GATES) && gate_get_mask() != last_gates)
+    return 0;
+  if (s->checks & CHECK_DACS) {
+    for (int ch = 0; ch < TRAM8_NUM_GATES; ch++) {
+      if (max5825_get((uint8_t)ch) != last_dac[ch])
+        return 0;
+    }
+  }
+  if (s->checks & CHECK_STATS) {
+    uint16_t stats[TRAM8_STAT_COUNT];
+    if (host_tx_len != count * TRAM8_LEN_STATS || tram8_parse_stats(host_tx, TRAM8_LEN_STATS, stats) != 0)
+      return 0;
+  }
+  return 1;
+}
+
+static int run(const scenario_t* s) {
+  uint32_t count = s->build();
+  if (host_run(s->mode, msgs, count, costs) != 0) {
+    printf("%-13s did not go idle\n", s->name);
+    return 1;
+  }
+
+  host_cost_t total = {0, 0, 0, 0};
+  uint32_t max_passes = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    total.passes += costs[i].passes;
+    total.i2c_bytes += costs[i].i2c_bytes;
+    total.port_accesses += costs[i].port_accesses;
+    total.tx_bytes += costs[i].tx_bytes;
+    if (costs[i].passes > max_passes)
+      max_passes = costs[i].passes;
+  }
+
+  printf("%-13s %4u msgs  passes %5u (%5.1f/msg, max %3u)  i2c %5u B (%5.1f/msg)  ports %6u (%6.1f/msg)",
+         s->name,
+         count,
+         total.passes,
+         (double)total.passes / count,
+         max_passes,
+         total.i2c_bytes,
+         (double)total.i2c_bytes / count,
+         total.port_accesses,
+         (double)total.port_accesses / count);
+  if (total.tx_bytes)
+    printf("  tx %u B", total.tx_bytes);
+
+  int failed = 0;
+  if (!outputs_match(s, count)) {
+    printf("  OUTPUTS WRONG");
+    failed = 1;
+  }
+  if (total.passes > s->budget.passes || total.i2c_bytes > s->budget.i2c_bytes ||
+      total.port_accesses > s->budget.port_accesses) {
+    printf("  OVER BUDGET (%u/%u/%u)", s->budget.passes, s->budget.i2c_bytes, s->budget.port_accesses);
+    failed = 1;
+  } else if (total.passes < s->budget.passes || total.i2c_bytes < s->budget.i2c_bytes ||
+             total.port_accesses < s->budget.port_accesses) {
+    printf("  under budget");
+  }
+  printf("\n");
+  return failed;
+}
+
+int main(void) {
+  printf("Firmware hot-path benchmark\n\n");
+  int failed = 0;
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+    failed |= run(&scenarios[i]);
+  if (failed) {
+    printf("\nFirmware benchmark FAILED\n");
+    return 1;
+  }
+  printf("\nAll firmware budgets met!\n");
+  return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef MOCK_AVR_EEPROM_H
+#define MOCK_AVR_EEPROM_H
+
+// EEPROM contents live in mock_eeprom; tests commit EEDR into it when the
+// firmware strobes EEWE.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MOCK_EEPROM_SIZE 512
+
+extern uint8_t mock_eeprom[MOCK_EEPROM_SIZE];
+
+uint8_t eeprom_read_byte(const uint8_t* addr);
+void eeprom_read_block(void* dst, const void* src, size_t n);
+
+#define eeprom_busy_wait()
+#define eeprom_is_ready() 1
+
+#endif
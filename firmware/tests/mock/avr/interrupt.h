@@ -0,0 +1,8 @@
+#ifndef MOCK_AVR_INTERRUPT_H
+#define MOCK_AVR_INTERRUPT_H
+
+#define ISR(vector) void vector(void)
+#define sei()
+#define cli()
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef MOCK_AVR_IO_H
+#define MOCK_AVR_IO_H
+
+// Host stand-ins for the ATmega8A registers the firmware touches.
+// Registers are plain variables; tests play the peripheral side.
+
+#include <stdint.h>
+
+// Output ports count every access (read or write) so the firmware harness
+// can report port traffic per message
+extern volatile uint8_t mock_portb, mock_portc, mock_portd;
+extern uint32_t mock_port_accesses;
+volatile uint8_t* mock_port(volatile uint8_t* reg);
+
+#define PORTB (*mock_port(&mock_portb))
+#define PORTC (*mock_port(&mock_portc))
+#define PORTD (*mock_port(&mock_portd))
+
+extern volatile uint8_t DDRB, DDRC, DDRD;
+extern volatile uint8_t PINB, PINC;
+extern volatile uint8_t TWBR, TWSR, TWDR, TWCR;
+extern volatile uint16_t EEAR;
+extern volatile uint8_t EEDR, EECR;
+extern volatile uint8_t UBRRH, UBRRL, UCSRA, UCSRB, UCSRC;
+extern volatile uint16_t UDR; // wider than the hardware so a harness can spot writes
+extern volatile uint8_t TCCR2, OCR2, TCNT2, TIMSK;
+
+#define PB0 0
+#define PB1 1
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PD1 1
+
+#define TWIE 0
+#define TWEN 2
+#define TWWC 3
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA 6
+#define TWINT 7
+
+#define EERE 0
+#define EEWE 1
+#define EEMWE 2
+#define EERIE 3
+
+#define UDRE 5
+#define TXC 6
+#define RXC 7
+#define TXEN 3
+#define RXEN 4
+#define RXCIE 7
+#define UCSZ0 1
+#define UCSZ1 2
+#define URSEL 7
+
+#define CS22 2
+#define WGM21 3
+#define OCIE2 7
+
+#endif
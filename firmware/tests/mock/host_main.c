@@ -0,0 +1,325 @@
+#include "host_main.h"
+#include "mock_twi_bus.h"
+
+#include <avr/eeprom.h>
+#include <setjmp.h>
+#include <string.h>
+
+void EE_RDY_vect(void);
+static void host_pass(void);
+static void host_outputs_loaded(void);
+
+// main.c is compiled in whole so the runner can see when its ring, latch and
+// reply are idle
+#define LOOP_HOOK() host_pass()
+#define OUTPUTS_HOOK() host_outputs_loaded()
+#define main firmware_main
+#include "../../src/main.c"
+#undef main
+
+#define UDR_EMPTY 0x100 // no byte written since the last pass
+#define NEVER 0xFFFFFFFFu
+#define SIM_DRAIN_US 1000000 // how long the firmware may stay busy after the last byte
+
+typedef enum { PHASE_BOOT, PHASE_MSG, PHASE_TICK, PHASE_SIM } host_phase_t;
+
+uint8_t host_tx[HOST_TX_SIZE];
+uint32_t host_tx_len;
+
+static jmp_buf host_exit;
+static host_phase_t phase;
+static host_cost_t acc;
+
+// host_run()
+static const host_msg_t* run_msgs;
+static uint32_t run_count;
+static host_cost_t* run_costs;
+static uint32_t run_index;
+static uint32_t phase_passes;
+
+// host_sim()
+static const host_timing_t* sim_timing;
+static const uint8_t* sim_bytes;
+static const uint32_t* sim_sent;
+static uint32_t sim_count;
+static host_byte_time_t* sim_times;
+static uint32_t sim_now;
+static uint32_t sim_wire_free; // when the byte in flight is off the wire
+static uint32_t sim_next_rx; // next byte to come off the wire
+static uint32_t sim_next_tick;
+static uint32_t sim_twi_due; // NEVER while the bus is idle
+static uint32_t sim_ring_index[RB_SIZE]; // stream index of each byte in the receive ring
+static uint8_t sim_tail; // ring slot the runner has seen consumed up to
+static uint32_t sim_consumed; // stream bytes up to here have left the ring
+static uint32_t sim_done; // stream bytes up to here have out_us set
+
+// A fresh boot on the AVR clears .bss; the host has to do it by hand
+static void reset_main_state(void) {
+  rb_head = rb_tail = 0;
+  rb_overflow = GAP_NONE;
+  rb_gap = rb_gap_next = 0;
+  timer_ticks = 0;
+  tick_count = 0;
+  stat_rx_bytes = stat_overflows = stat_frames = stat_parse_errors = 0;
+  stat_rb_peak = stat_loop_max = 0;
+  tx_len = tx_pos = 0;
+  pong_pending = 0;
+  latch_requested = 0;
+  frame_len = 0;
+  learn_button.state = BUTTON_IDLE;
+  learn_button.ticks = 0;
+}
+
+static void boot(uint8_t mode) {
+  memset(mock_eeprom, 0xFF, sizeof(mock_eeprom));
+  mock_eeprom[EEPROM_MODE_ADDR] = mode;
+  EECR = 0;
+  PINB = 0; // v1.2+ hardware, active-high gates
+  PINC = 0; // button released
+  UDR = UDR_EMPTY;
+  mock_twi_reset();
+  host_tx_len = 0;
+  reset_main_state();
+  phase = PHASE_BOOT;
+}
+
+static void ee_step(void) {
+  if (EECR & (1 << EEWE)) {
+    mock_eeprom[EEAR] = EEDR;
+    EECR &= (uint8_t)~((1 << EEWE) | (1 << EEMWE));
+  }
+  if (EECR & (1 << EERIE))
+    EE_RDY_vect();
+}
+
+// UART transmit and EEPROM are always instant
+static void uart_ee_step(void) {
+  if (UDR != UDR_EMPTY && (UCSRB & (1 << TXEN))) {
+    if (host_tx_len < HOST_TX_SIZE)
+      host_tx[host_tx_len++] = (uint8_t)UDR;
+    acc.tx_bytes++;
+  }
+  UDR = UDR_EMPTY;
+  UCSRA |= (1 << UDRE) | (1 << TXC);
+
+  ee_step();
+}
+
+static uint8_t firmware_idle(void) {
+  return rb_tail == rb_head && !latch_requested && !max5825_busy() && !tx_len && !pong_pending;
+}
+
+static void receive(uint8_t byte) {
+  UDR = byte;
+  USART_RXC_vect();
+  UDR = UDR_EMPTY;
+}
+
+/*
+ * host_run(): one message at a time, instant peripherals
+ */
+
+static void start_message(void) {
+  if (run_index == run_count)
+    longjmp(host_exit, 1);
+  memset(&acc, 0, sizeof(acc));
+  mock_port_accesses = 0;
+  const host_msg_t* msg = &run_msgs[run_index];
+  for (uint8_t i = 0; i < msg->len; i++)
+    receive(msg->bytes[i]);
+  phase = PHASE_MSG;
+  phase_passes = 0;
+}
+
+static void run_pass(void) {
+  mock_twi_run();
+  for (int i = 0; i < bus_len; i++)
+    acc.i2c_bytes += bus[i] >= 0;
+  bus_len = 0;
+  uart_ee_step();
+
+  if (phase == PHASE_BOOT) {
+    start_message();
+  } else if (phase_passes && firmware_idle()) {
+    if (phase == PHASE_MSG) {
+      TIMER2_COMP_vect(); // one 1 ms tick between messages
+      phase = PHASE_TICK;
+      phase_passes = 0;
+    } else {
+      acc.port_accesses = mock_port_accesses;
+      run_costs[run_index++] = acc;
+      start_message();
+    }
+  } else if (acc.passes >= HOST_PASS_LIMIT) {
+    longjmp(host_exit, 2);
+  }
+
+  phase_passes++;
+  acc.passes++;
+}
+
+int host_run(uint8_t mode, const host_msg_t* msgs, uint32_t count, host_cost_t* costs) {
+  boot(mode);
+  sim_timing = NULL;
+  run_msgs = msgs;
+  run_count = count;
+  run_costs = costs;
+  run_index = 0;
+
+  if (setjmp(host_exit) == 0)
+    firmware_main();
+  return run_index == run_count ? 0 : -1;
+}
+
+/*
+ * host_sim(): simulated clock
+ */
+
+// Bus time of the command last written to TWCR: START and STOP take about
+// one bit, SLA+W and data bytes a third of a DAC write each
+static uint32_t twi_cost(uint8_t cr) {
+  uint32_t byte_us = sim_timing->dac_write_us / 3;
+  if (cr & ((1 << TWSTA) | (1 << TWSTO)))
+    return (byte_us + 8) / 9;
+  return byte_us;
+}
+
+static uint32_t sim_rx_due(void) {
+  if (sim_next_rx == sim_count)
+    return NEVER;
+  uint32_t start = sim_sent[sim_next_rx] > sim_wire_free ? sim_sent[sim_next_rx] : sim_wire_free;
+  return start + sim_timing->byte_us;
+}
+
+// Every consumed byte not yet placed gets its output time
+static void sim_finish(uint32_t t) {
+  for (; sim_done < sim_consumed; sim_done++) {
+    if (sim_times[sim_done].out_us != HOST_DROPPED)
+      sim_times[sim_done].out_us = t;
+  }
+}
+
+static void host_outputs_loaded(void) {
+  if (phase == PHASE_SIM)
+    sim_finish(sim_now + DAC_SETTLE_US);
+}
+
+// Returns 1 if the pass that just ended took a byte from the ring
+static uint8_t sim_consume(void) {
+  uint8_t took = 0;
+  while (sim_tail != rb_tail) {
+    sim_consumed = sim_ring_index[sim_tail] + 1;
+    sim_tail = (sim_tail + 1) & RB_MASK;
+    took = 1;
+  }
+  return took;
+}
+
+// Runs the wire, bus and timer up to t
+static void sim_events(uint32_t t) {
+  if (sim_twi_due == NEVER && (TWCR & (1 << TWINT)))
+    sim_twi_due = sim_now + twi_cost(TWCR);
+
+  for (;;) {
+    uint32_t rx = sim_rx_due();
+    uint32_t due = rx;
+    if (sim_next_tick < due)
+      due = sim_next_tick;
+    if (sim_twi_due < due)
+      due = sim_twi_due;
+    if (due > t)
+      return;
+
+    if (due == sim_twi_due) {
+      mock_twi_step();
+      bus_len = 0;
+      sim_twi_due = (TWCR & (1 << TWINT)) ? due + twi_cost(TWCR) : NEVER;
+    } else if (due == rx) {
+      uint32_t i = sim_next_rx++;
+      uint8_t head = rb_head;
+      sim_wire_free = rx;
+      sim_times[i].rx_us = rx;
+      receive(sim_bytes[i]);
+      if (rb_head != head)
+        sim_ring_index[head] = i;
+      else
+        sim_times[i].out_us = HOST_DROPPED;
+    } else {
+      sim_next_tick += 1000;
+      TIMER2_COMP_vect();
+    }
+  }
+}
+
+static void sim_pass(void) {
+  if (phase == PHASE_BOOT) {
+    phase = PHASE_SIM;
+  } else {
+    sim_now += sim_consume() ? sim_timing->loop_us : sim_timing->idle_us;
+    if (!latch_requested)
+      sim_finish(sim_now);
+  }
+  uart_ee_step();
+
+  // Nothing to do until the next byte or tick: skip the idle passes
+  if (firmware_idle() && sim_twi_due == NEVER && sim_done == sim_consumed) {
+    uint32_t next = sim_rx_due();
+    if (sim_next_tick < next)
+      next = sim_next_tick;
+    if (next != NEVER && next > sim_now)
+      sim_now = next;
+  }
+  sim_events(sim_now);
+
+  if (sim_next_rx == sim_count) {
+    if (firmware_idle() && sim_twi_due == NEVER && sim_done == sim_consumed)
+      longjmp(host_exit, 1);
+    if (sim_now - sim_wire_free > SIM_DRAIN_US)
+      longjmp(host_exit, 2);
+  }
+}
+
+int host_sim(uint8_t mode,
+             const uint8_t* bytes,
+             const uint32_t* sent_us,
+             uint32_t count,
+             const host_timing_t* timing,
+             host_byte_time_t* times) {
+  boot(mode);
+  sim_timing = timing;
+  sim_bytes = bytes;
+  sim_sent = sent_us;
+  sim_count = count;
+  sim_times = times;
+  sim_now = sim_wire_free = 0;
+  sim_next_rx = 0;
+  sim_next_tick = 1000;
+  sim_twi_due = NEVER;
+  sim_tail = 0;
+  sim_consumed = sim_done = 0;
+  memset(times, 0, sizeof(*times) * count);
+
+  int result = setjmp(host_exit);
+  if (result == 0)
+    firmware_main();
+  return result == 1 ? 0 : -1;
+}
+
+static void host_pass(void) {
+  if (sim_timing)
+    sim_pass();
+  else
+    run_pass();
+}
+
+void host_stats(uint16_t stats[TRAM8_STAT_COUNT]) {
+  stats[TRAM8_STAT_RX_BYTES] = stat_rx_bytes;
+  stats[TRAM8_STAT_FRAMES] = stat_frames;
+  stats[TRAM8_STAT_PARSE_ERRORS] = stat_parse_errors;
+  stats[TRAM8_STAT_OVERFLOWS] = stat_overflows;
+  stats[TRAM8_STAT_RB_PEAK] = stat_rb_peak;
+  stats[TRAM8_STAT_LOOP_MAX] = stat_loop_max;
+  stats[TRAM8_STAT_DAC_SKIPPED] = max5825_skipped_writes();
+  stats[TRAM8_STAT_DAC_COALESCED] = max5825_coalesced_writes();
+  stats[TRAM8_STAT_SCHED_LATE] = sched_late_count();
+}
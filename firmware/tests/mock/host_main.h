@@ -0,0 +1,72 @@
+#ifndef HOST_MAIN_H
+#define HOST_MAIN_H
+
+// Whole-firmware host build. main.c runs against the register mocks and hands
+// control back once per main loop pass. Runs boot the firmware in one mode
+// from a blank EEPROM, then drive it in one of two ways:
+//
+// host_run() feeds messages through the RX interrupt one at a time and
+// records what each cost until the firmware went idle again. The mocked
+// peripherals are instant: the TWI queue drains and UART bytes leave within
+// the pass they were started in. Counts are therefore the firmware's own
+// work, and they repeat exactly from run to run.
+//
+// host_sim() puts the firmware on a simulated clock instead. Bytes reach the
+// receive ring when their last bit is off the wire, TWI bytes take bus time,
+// the 1 ms timer ticks, and every pass costs CPU time. It reports when each
+// byte was received and when the outputs it asked for were loaded.
+
+#include "../../../protocol/tram8_sysex.h"
+#include <stdint.h>
+
+#define HOST_PASS_LIMIT 10000 // passes a message may take before the run is abandoned
+#define HOST_TX_SIZE 256
+
+typedef struct {
+  uint32_t passes; // main loop passes until idle, including the timer tick after the message
+  uint32_t i2c_bytes; // bytes clocked onto the TWI bus, SLA+W included
+  uint32_t port_accesses; // PORTB/C/D reads and writes
+  uint32_t tx_bytes; // bytes sent on the UART
+} host_cost_t;
+
+typedef struct {
+  const uint8_t* bytes;
+  uint8_t len; // at most the 63 bytes the receive ring holds
+} host_msg_t;
+
+typedef struct {
+  uint32_t byte_us; // UART time per byte, TRAM8_BYTE_US at MIDI rate
+  uint32_t loop_us; // a pass that took a byte from the ring
+  uint32_t idle_us; // a pass that found the ring empty
+  uint32_t dac_write_us; // TWI time per DAC channel written (three bus bytes)
+} host_timing_t;
+
+#define HOST_DROPPED 0xFFFFFFFFu
+
+typedef struct {
+  uint32_t rx_us; // last bit off the wire; the byte entered the ring or was dropped
+  uint32_t out_us; // outputs covering this byte loaded; HOST_DROPPED if the ring was full
+} host_byte_time_t;
+
+// UART output of the last run
+extern uint8_t host_tx[HOST_TX_SIZE];
+extern uint32_t host_tx_len;
+
+// mode is one of MODE_*. costs receives one entry per message. Returns 0, or
+// -1 if a message never went idle.
+int host_run(uint8_t mode, const host_msg_t* msgs, uint32_t count, host_cost_t* costs);
+
+// sent_us[i] is when the host handed bytes[i] to the wire, non-decreasing.
+// times receives one entry per byte. Returns 0, or -1 if the firmware was
+// still busy a second after the last byte arrived.
+int host_sim(uint8_t mode,
+             const uint8_t* bytes,
+             const uint32_t* sent_us,
+             uint32_t count,
+             const host_timing_t* timing,
+             host_byte_time_t* times);
+
+// Device counters as a stats reply would carry them, without resetting peaks
+void host_stats(uint16_t stats[TRAM8_STAT_COUNT]);
+
+#endif
@@ -0,0 +1,29 @@
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <string.h>
+
+volatile uint8_t mock_portb, mock_portc, mock_portd;
+uint32_t mock_port_accesses;
+volatile uint8_t DDRB, DDRC, DDRD;
+volatile uint8_t PINB, PINC;
+volatile uint8_t TWBR, TWSR, TWDR, TWCR;
+volatile uint16_t EEAR;
+volatile uint8_t EEDR, EECR;
+volatile uint8_t UBRRH, UBRRL, UCSRA, UCSRB, UCSRC;
+volatile uint16_t UDR;
+volatile uint8_t TCCR2, OCR2, TCNT2, TIMSK;
+
+uint8_t mock_eeprom[MOCK_EEPROM_SIZE];
+
+volatile uint8_t* mock_port(volatile uint8_t* reg) {
+  mock_port_accesses++;
+  return reg;
+}
+
+uint8_t eeprom_read_byte(const uint8_t* addr) {
+  return mock_eeprom[(uintptr_t)addr];
+}
+
+void eeprom_read_block(void* dst, const void* src, size_t n) {
+  memcpy(dst, &mock_eeprom[(uintptr_t)src], n);
+}
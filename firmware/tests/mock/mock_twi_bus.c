@@ -0,0 +1,57 @@
+#include "mock_twi_bus.h"
+
+#include <assert.h>
+#include <avr/io.h>
+#include <util/twi.h>
+
+void TWI_vect(void);
+
+int bus[BUS_LOG_SIZE];
+int bus_len;
+uint8_t nack_addr;
+static uint8_t bus_idle = 1;
+static uint8_t expect_sla;
+
+void mock_twi_reset(void) {
+  bus_len = 0;
+  nack_addr = 0;
+}
+
+int mock_twi_step(void) {
+  uint8_t cr = TWCR;
+  if (!(cr & (1 << TWINT)))
+    return 0;
+
+  if (cr & (1 << TWSTO)) {
+    bus[bus_len++] = BUS_STOP;
+    bus_idle = 1;
+  }
+
+  if (cr & (1 << TWSTA)) {
+    bus[bus_len++] = BUS_START;
+    TWSR = bus_idle ? TW_START : TW_REP_START;
+    bus_idle = 0;
+    expect_sla = 1;
+  } else if (cr & (1 << TWSTO)) {
+    TWCR = cr & (uint8_t)~((1 << TWINT) | (1 << TWSTO)); // released, no interrupt
+    return 1;
+  } else {
+    bus[bus_len++] = TWDR;
+    if (expect_sla) {
+      TWSR = (TWDR == nack_addr) ? TW_MT_SLA_NACK : TW_MT_SLA_ACK;
+      expect_sla = 0;
+    } else {
+      TWSR = TW_MT_DATA_ACK;
+    }
+  }
+
+  TWCR = cr & (uint8_t)~(1 << TWSTO);
+  assert(cr & (1 << TWIE));
+  TWI_vect();
+  return 1;
+}
+
+void mock_twi_run(void) {
+  while (mock_twi_step())
+    ;
+}
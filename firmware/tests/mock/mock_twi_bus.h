@@ -0,0 +1,21 @@
+#ifndef MOCK_TWI_BUS_H
+#define MOCK_TWI_BUS_H
+
+// Mocked TWI peripheral: each step performs the command last written to TWCR,
+// logs what went on the bus and raises the interrupt like the hardware would.
+
+#include <stdint.h>
+
+#define BUS_START -1
+#define BUS_STOP -2
+#define BUS_LOG_SIZE 512
+
+extern int bus[BUS_LOG_SIZE];
+extern int bus_len;
+extern uint8_t nack_addr; // SLA+W that is not acknowledged
+
+void mock_twi_reset(void);
+int mock_twi_step(void);
+void mock_twi_run(void);
+
+#endif
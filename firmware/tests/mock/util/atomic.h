@@ -0,0 +1,7 @@
+#ifndef MOCK_UTIL_ATOMIC_H
+#define MOCK_UTIL_ATOMIC_H
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_BLOCK(type) for (uint8_t mock_atomic_once = 1; mock_atomic_once; mock_atomic_once = 0)
+
+#endif
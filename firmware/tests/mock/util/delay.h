@@ -0,0 +1,12 @@
+#ifndef MOCK_UTIL_DELAY_H
+#define MOCK_UTIL_DELAY_H
+
+static inline void _delay_ms(double ms) {
+  (void)ms;
+}
+
+static inline void _delay_us(double us) {
+  (void)us;
+}
+
+#endif
@@ -0,0 +1,412 @@
+#include "../../protocol/tram8_sysex.h"
+#include "../src/hardware_config.h"
+#include "mock/host_main.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Link-timing simulator for the 31,250-baud DIN path. Plays a timestamped
+// byte stream into the host build of the firmware (see mock/host_main.h):
+// each byte takes TRAM8_BYTE_US on the wire, lands in the firmware's 64-byte
+// receive ring, and DAC writes take bus time. Reports per-event latency from
+// the host sending an event to the outputs being loaded, its jitter, and
+// every byte the ring had to drop.
+//
+//   sim_link FILE            replay a capture
+//   sim_link --gen KIND      generate a stream (full, delta, notes, bend, chord)
+//
+// Streams are text, one burst per line: a time in microseconds followed by
+// the hex bytes handed to the wire at that time. '#' starts a comment.
+//
+//   1000 F0 7D 11 01 00 01 00 40 00 F7
+//   1500 90 00 7F
+
+#define MAX_BYTES (1u << 20)
+#define LINE_SIZE 4096
+
+typedef struct {
+  uint32_t first; // stream index of the first byte
+  uint32_t last;
+  uint8_t counted; // 0 for real-time bytes and stray data, left out of the figures
+} event_t;
+
+typedef struct {
+  const char* file;
+  const char* gen;
+  const char* csv;
+  int dump;
+  uint8_t mode;
+  double rate;
+  uint32_t count;
+  host_timing_t timing;
+} options_t;
+
+static uint8_t bytes[MAX_BYTES];
+static uint32_t sent_us[MAX_BYTES];
+static host_byte_time_t times[MAX_BYTES];
+static event_t events[MAX_BYTES];
+static uint32_t byte_count;
+
+static uint32_t rng = 0x9E3779B9u;
+
+static uint32_t rng_next(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static int push(uint32_t t, const uint8_t* buf, uint32_t len) {
+  if (byte_count + len > MAX_BYTES)
+    return -1;
+  if (byte_count && t < sent_us[byte_count - 1])
+    t = sent_us[byte_count - 1]; // the wire is in order
+  for (uint32_t i = 0; i < len; i++) {
+    bytes[byte_count] = buf[i];
+    sent_us[byte_count++] = t;
+  }
+  return 0;
+}
+
+static int load(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  char line[LINE_SIZE];
+  int lineno = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineno++;
+    char* hash = strchr(line, '#');
+    if (hash)
+      *hash = '\0';
+    char* p = line;
+    char* end;
+    unsigned long t = strtoul(p, &end, 10);
+    if (end == p)
+      continue; // blank
+    p = end;
+
+    uint8_t buf[LINE_SIZE / 2];
+    uint32_t len = 0;
+    for (;;) {
+      unsigned long b = strtoul(p, &end, 16);
+      if (end == p)
+        break;
+      if (b > 0xFF) {
+        fprintf(stderr, "%s:%d: byte out of range\n", path, lineno);
+        fclose(f);
+        return -1;
+      }
+      buf[len++] = (uint8_t)b;
+      p = end;
+    }
+    if (push((uint32_t)t, buf, len) != 0) {
+      fprintf(stderr, "%s: stream longer than %u bytes\n", path, MAX_BYTES);
+      fclose(f);
+      return -1;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+static int generate(const options_t* o) {
+  uint32_t period = (uint32_t)(1e6 / o->rate);
+  uint16_t dac[TRAM8_NUM_GATES] = {0};
+  for (uint32_t n = 0; n < o->count; n++) {
+    uint32_t t = 1000 + n * period;
+    uint8_t buf[TRAM8_NUM_GATES * TRAM8_LEN_MAX];
+    uint32_t len = 0;
+    for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+      dac[ch] = (uint16_t)(rng_next() & TRAM8_DAC_MAX);
+
+    if (!strcmp(o->gen, "full")) {
+      len = tram8_pack(buf, (uint8_t)rng_next(), dac, TRAM8_FORM_FULL);
+    } else if (!strcmp(o->gen, "delta")) {
+      len = tram8_pack_delta(buf, (uint8_t)rng_next(), dac, (uint8_t)(3 << (n % 7)));
+    } else if (!strcmp(o->gen, "notes")) {
+      buf[len++] = (n & 1) ? TRAM8_CV_NOTE_OFF : TRAM8_CV_NOTE_ON;
+      buf[len++] = (uint8_t)((n / 2) % TRAM8_NUM_GATES);
+      buf[len++] = (n & 1) ? 0 : TRAM8_CV_GATE_ON_VELOCITY;
+    } else if (!strcmp(o->gen, "bend")) {
+      buf[len++] = (uint8_t)(TRAM8_CV_BEND | (n % TRAM8_NUM_GATES));
+      tram8_dac_to_bend(dac[0], &buf[1], &buf[2]);
+      len += 2;
+    } else if (!strcmp(o->gen, "chord")) {
+      // every voice moves at once, one delta frame each, written back to back
+      for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+        len += tram8_pack_delta(&buf[len], (uint8_t)(n & 1 ? 0 : 0xFF), dac, (uint8_t)(1 << ch));
+    } else {
+      fprintf(stderr, "unknown generator: %s\n", o->gen);
+      return -1;
+    }
+    if (push(t, buf, len) != 0) {
+      fprintf(stderr, "generated stream longer than %u bytes\n", MAX_BYTES);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static uint8_t data_len(uint8_t status) {
+  uint8_t hi = status & 0xF0;
+  if (hi == 0xC0 || hi == 0xD0 || status == 0xF1 || status == 0xF3)
+    return 1;
+  if (status == 0xF6)
+    return 0;
+  return 2;
+}
+
+// Splits the stream into MIDI messages; running status starts a new one
+// every time a message's data bytes are complete
+static uint32_t segment(void) {
+  uint32_t n = 0;
+  uint8_t status = 0;
+  uint8_t need = 0;
+  uint8_t have = 0;
+  uint8_t in_sysex = 0;
+
+  for (uint32_t i = 0; i < byte_count; i++) {
+    uint8_t b = bytes[i];
+    if (b >= 0xF8) {
+      events[n++] = (event_t){i, i, 0};
+      continue;
+    }
+    if (b == TRAM8_SYSEX_END && in_sysex) {
+      events[n - 1].last = i;
+      in_sysex = 0;
+      status = 0;
+      continue;
+    }
+    if (b & 0x80) {
+      in_sysex = b == TRAM8_SYSEX_START;
+      status = (b < 0xF0 || in_sysex) ? b : 0; // system common cancels running status
+      need = in_sysex ? 0 : data_len(b);
+      have = 0;
+      events[n++] = (event_t){i, i, 1};
+      continue;
+    }
+    if (in_sysex) {
+      events[n - 1].last = i;
+    } else if (status && have < need) {
+      events[n - 1].last = i;
+      have++;
+    } else if (status) {
+      events[n++] = (event_t){i, i, 1}; // running status
+      have = 1;
+    } else {
+      events[n++] = (event_t){i, i, 0};
+    }
+  }
+  return n;
+}
+
+static int cmp_u32(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of a sorted array
+static uint32_t percentile(const uint32_t* v, uint32_t n, uint32_t pct) {
+  uint32_t rank = (pct * n + 99) / 100;
+  return v[rank ? rank - 1 : 0];
+}
+
+static void print_row(const char* name, uint32_t* v, uint32_t n) {
+  qsort(v, n, sizeof(*v), cmp_u32);
+  printf("  %-10s p50 %7.2f  p90 %7.2f  p99 %7.2f  max %7.2f ms\n",
+         name,
+         percentile(v, n, 50) / 1000.0,
+         percentile(v, n, 90) / 1000.0,
+         percentile(v, n, 99) / 1000.0,
+         v[n - 1] / 1000.0);
+}
+
+static int report(uint32_t nevents, const options_t* o) {
+  uint32_t* latency = malloc(sizeof(uint32_t) * nevents);
+  uint32_t* wire = malloc(sizeof(uint32_t) * nevents);
+  uint32_t* device = malloc(sizeof(uint32_t) * nevents);
+  FILE* csv = NULL;
+  if (o->csv) {
+    csv = fopen(o->csv, "w");
+    if (!csv) {
+      perror(o->csv);
+      return -1;
+    }
+    fprintf(csv, "event,bytes,sent_us,rx_us,out_us,latency_us,dropped\n");
+  }
+
+  uint32_t n = 0, dropped_events = 0, dropped_bytes = 0;
+  double sum = 0, sum_sq = 0;
+  for (uint32_t e = 0; e < nevents; e++) {
+    const event_t* ev = &events[e];
+    uint8_t dropped = 0;
+    for (uint32_t i = ev->first; i <= ev->last; i++)
+      dropped |= times[i].out_us == HOST_DROPPED;
+    if (!ev->counted)
+      continue;
+    uint32_t sent = sent_us[ev->first];
+    uint32_t rx = times[ev->last].rx_us;
+    uint32_t out = times[ev->last].out_us;
+    if (csv) {
+      fprintf(csv,
+              "%u,%u,%u,%u,%u,%u,%u\n",
+              e,
+              ev->last - ev->first + 1,
+              sent,
+              rx,
+              dropped ? 0 : out,
+              dropped ? 0 : out - sent,
+              dropped);
+    }
+    if (dropped) {
+      dropped_events++;
+      continue;
+    }
+    latency[n] = out - sent;
+    wire[n] = rx - sent;
+    device[n] = out - rx;
+    sum += latency[n];
+    sum_sq += (double)latency[n] * latency[n];
+    n++;
+  }
+  for (uint32_t i = 0; i < byte_count; i++)
+    dropped_bytes += times[i].out_us == HOST_DROPPED;
+  if (csv)
+    fclose(csv);
+
+  uint16_t stats[TRAM8_STAT_COUNT];
+  host_stats(stats);
+
+  printf("tram8+ link simulation: %u bytes, %u events over %.1f ms\n",
+         byte_count,
+         n + dropped_events,
+         byte_count ? sent_us[byte_count - 1] / 1000.0 : 0.0);
+  printf("  %u us/byte, pass %u us (%u idle), %u us per DAC write\n",
+         o->timing.byte_us,
+         o->timing.loop_us,
+         o->timing.idle_us,
+         o->timing.dac_write_us);
+  printf("  overflow   %u bytes dropped, %u events lost, ring peak %u bytes\n",
+         dropped_bytes,
+         dropped_events,
+         stats[TRAM8_STAT_RB_PEAK]);
+  printf("  firmware   %u frames, %u parse errors, %u DAC writes skipped, %u coalesced\n",
+         stats[TRAM8_STAT_FRAMES],
+         stats[TRAM8_STAT_PARSE_ERRORS],
+         stats[TRAM8_STAT_DAC_SKIPPED],
+         stats[TRAM8_STAT_DAC_COALESCED]);
+  if (n) {
+    double mean = sum / n;
+    double sd = sqrt(sum_sq / n - mean * mean > 0 ? sum_sq / n - mean * mean : 0);
+    print_row("latency", latency, n);
+    printf("  jitter     sd %.2f ms, p99-p50 %.2f ms\n",
+           sd / 1000.0,
+           (percentile(latency, n, 99) - percentile(latency, n, 50)) / 1000.0);
+    print_row("wire", wire, n);
+    print_row("device", device, n);
+  }
+
+  free(latency);
+  free(wire);
+  free(device);
+  return 0;
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s (FILE | --gen KIND) [options]\n"
+          "  --gen KIND        full, delta, notes, bend or chord\n"
+          "  --rate HZ         generated events per second (default 500)\n"
+          "  --count N         generated events (default 1000)\n"
+          "  --dump            print the stream instead of simulating it\n"
+          "  --mode MODE       sysex, velocity, cc or pitch (default sysex)\n"
+          "  --loop-us US      pass that takes a byte from the ring (default 20)\n"
+          "  --idle-us US      pass that finds the ring empty (default 4)\n"
+          "  --dac-write-us US TWI time per DAC channel written (default 68)\n"
+          "  --byte-us US      wire time per byte (default %d)\n"
+          "  --csv FILE        per-event results\n",
+          prog,
+          TRAM8_BYTE_US);
+}
+
+static int parse_args(int argc, char** argv, options_t* o) {
+  *o = (options_t){NULL, NULL, NULL, 0, MODE_SYSEX, 500.0, 1000, {TRAM8_BYTE_US, 20, 4, 68}};
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    if (a[0] != '-') {
+      o->file = a;
+      continue;
+    }
+    if (!strcmp(a, "--dump")) {
+      o->dump = 1;
+      continue;
+    }
+    if (i + 1 >= argc)
+      return -1;
+    const char* v = argv[++i];
+    if (!strcmp(a, "--gen"))
+      o->gen = v;
+    else if (!strcmp(a, "--rate"))
+      o->rate = atof(v);
+    else if (!strcmp(a, "--count"))
+      o->count = (uint32_t)atol(v);
+    else if (!strcmp(a, "--csv"))
+      o->csv = v;
+    else if (!strcmp(a, "--loop-us"))
+      o->timing.loop_us = (uint32_t)atol(v);
+    else if (!strcmp(a, "--idle-us"))
+      o->timing.idle_us = (uint32_t)atol(v);
+    else if (!strcmp(a, "--dac-write-us"))
+      o->timing.dac_write_us = (uint32_t)atol(v);
+    else if (!strcmp(a, "--byte-us"))
+      o->timing.byte_us = (uint32_t)atol(v);
+    else if (!strcmp(a, "--mode")) {
+      if (!strcmp(v, "sysex"))
+        o->mode = MODE_SYSEX;
+      else if (!strcmp(v, "velocity"))
+        o->mode = MODE_VELOCITY;
+      else if (!strcmp(v, "cc"))
+        o->mode = MODE_CC;
+      else if (!strcmp(v, "pitch"))
+        o->mode = MODE_PITCH;
+      else
+        return -1;
+    } else {
+      return -1;
+    }
+  }
+  if (!o->file == !o->gen || o->rate <= 0 || o->timing.loop_us == 0 || o->timing.idle_us == 0)
+    return -1;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  options_t o;
+  if (parse_args(argc, argv, &o) != 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  if ((o.file ? load(o.file) : generate(&o)) != 0)
+    return 1;
+
+  if (o.dump) {
+    for (uint32_t i = 0; i < byte_count; i++) {
+      if (i == 0 || sent_us[i] != sent_us[i - 1])
+        printf("%s%u", i ? "\n" : "", sent_us[i]);
+      printf(" %02X", bytes[i]);
+    }
+    if (byte_count)
+      printf("\n");
+    return 0;
+  }
+
+  if (host_sim(o.mode, bytes, sent_us, byte_count, &o.timing, times) != 0) {
+    fprintf(stderr, "firmware still busy a second after the last byte\n");
+    return 1;
+  }
+  return report(segment(), &o) == 0 ? 0 : 1;
+}
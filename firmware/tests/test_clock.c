@@ -0,0 +1,234 @@
+#include "../../protocol/tram8_sysex.h"
+#include "../src/clock.h"
+#include "../src/eeprom_queue.h"
+#include "../src/trigger.h"
+#include <assert.h>
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <stdio.h>
+#include <string.h>
+
+// Gate outputs are captured instead of driving ports, with gpio.c's claim rules
+static uint8_t gates;
+static uint8_t claimed;
+static int rises[NUM_GATES];
+
+static void write_gates(uint8_t mask) {
+  for (int g = 0; g < NUM_GATES; g++) {
+    if ((mask & ~gates) & (1 << g))
+      rises[g]++;
+  }
+  gates = mask;
+}
+
+void gate_set_mask(uint8_t mask) {
+  write_gates((uint8_t)((gates & claimed) | (mask & ~claimed)));
+}
+
+void gate_claim(uint8_t mask) {
+  claimed = mask;
+}
+
+void gate_set_claimed(uint8_t bits, uint8_t mask) {
+  bits &= claimed;
+  write_gates((uint8_t)((gates & ~bits) | (mask & bits)));
+}
+
+uint8_t gate_get_mask(void) {
+  return gates;
+}
+
+static void reset(void) {
+  memset(mock_eeprom, 0xFF, sizeof(mock_eeprom));
+  EECR = 0;
+  eeprom_queue_init();
+  gates = 0;
+  claimed = 0;
+  memset(rises, 0, sizeof(rises));
+  trigger_init();
+  clock_init();
+  clock_reset();
+}
+
+static void run_ms(int n) {
+  for (int i = 0; i < n; i++) {
+    clock_tick();
+    trigger_tick();
+  }
+}
+
+// n MIDI clocks, period_ms apart
+static void clocks(int n, int period_ms) {
+  for (int i = 0; i < n; i++) {
+    clock_realtime(0xF8);
+    run_ms(period_ms);
+  }
+}
+
+static void test_unassigned_gates_untouched(void) {
+  reset();
+  assert(claimed == 0);
+  clock_realtime(0xFA);
+  clocks(48, 20);
+  assert(gates == 0);
+  for (int g = 0; g < NUM_GATES; g++)
+    assert(rises[g] == 0);
+
+  printf("unassigned_gates_untouched passed\n");
+}
+
+static void test_dividers(void) {
+  reset();
+  clock_config(0, 1, 0);
+  clock_config(1, 6, 0);
+  clock_config(2, 24, 0);
+  clock_config(3, 96, 0);
+  assert(claimed == 0x0F);
+
+  // nothing before start
+  clocks(24, 20);
+  assert(rises[0] == 0);
+
+  clock_realtime(0xFA);
+  clocks(96, 20);
+  assert(rises[0] == 96);
+  assert(rises[1] == 16);
+  assert(rises[2] == 4);
+  assert(rises[3] == 1);
+
+  printf("dividers passed\n");
+}
+
+static void test_pulse_width_from_timer(void) {
+  reset();
+  clock_config(5, 24, 0);
+  clock_realtime(0xFA);
+
+  clock_realtime(0xF8);
+  assert(gates == 0x20);
+  run_ms(CLOCK_PULSE_MS - 1);
+  assert(gates == 0x20);
+  run_ms(1);
+  assert(gates == 0x00);
+
+  // a trigger width overrides the default
+  trigger_config(5, 12, 0);
+  clocks(23, 1);
+  clock_realtime(0xF8);
+  run_ms(11);
+  assert(gates == 0x20);
+  run_ms(1);
+  assert(gates == 0x00);
+
+  printf("pulse_width_from_timer passed\n");
+}
+
+static void test_start_stop_continue(void) {
+  reset();
+  clock_config(0, 4, 0);
+  clock_config(6, TRAM8_CLOCK_RUN, 0);
+  clock_config(7, TRAM8_CLOCK_RESET, 0);
+
+  clock_realtime(0xFA);
+  assert(clock_running());
+  assert(gates & 0x40);
+  assert(rises[7] == 1);
+  clocks(6, 20);
+  assert(rises[0] == 2);
+
+  // stop holds the count; continue picks up where it left off
+  clock_realtime(0xFC);
+  assert(!clock_running());
+  assert(!(gates & 0x40));
+  clocks(10, 20);
+  assert(rises[0] == 2);
+  clock_realtime(0xFB);
+  assert(gates & 0x40);
+  clocks(2, 20);
+  assert(rises[0] == 2);
+  clocks(1, 20);
+  assert(rises[0] == 3);
+  assert(rises[7] == 1);
+
+  // start realigns: the next clock fires the divider
+  clocks(1, 20);
+  clock_realtime(0xFA);
+  assert(rises[7] == 2);
+  clocks(1, 20);
+  assert(rises[0] == 4);
+
+  printf("start_stop_continue passed\n");
+}
+
+static void test_swing_delays_offbeats(void) {
+  reset();
+  clock_config(0, 6, 75);
+
+  // settle the tempo estimate at 20 ms per clock
+  clocks(24, 20);
+  clock_realtime(0xFA);
+
+  // on-beat fires at once
+  clock_realtime(0xF8);
+  assert(rises[0] == 1);
+  run_ms(20);
+  clocks(5, 20);
+
+  // off-beat step is 120 ms; 75% swing pushes it back by half a step
+  clock_realtime(0xF8);
+  assert(rises[0] == 1);
+  run_ms(59);
+  assert(rises[0] == 1);
+  run_ms(1);
+  assert(rises[0] == 2);
+  run_ms(20);
+
+  // straight swing fires on the clock
+  clock_config(0, 6, 50);
+  clock_realtime(0xFA);
+  clocks(12, 20);
+  assert(rises[0] == 4);
+
+  printf("swing_delays_offbeats passed\n");
+}
+
+static void test_reset_drops_late_pulse(void) {
+  reset();
+  clock_config(0, 6, 75);
+  clocks(24, 20);
+  clock_realtime(0xFA);
+  clocks(6, 20);
+  clock_realtime(0xF8); // swung pulse waiting
+  clock_reset();
+  run_ms(200);
+  assert(rises[0] == 1);
+
+  printf("reset_drops_late_pulse passed\n");
+}
+
+static void test_config_persists(void) {
+  reset();
+  clock_config(4, 12, 60);
+  assert(eeprom_queue_read(EEPROM_CLOCK_DIV_ADDR + 4) == 12);
+  assert(eeprom_queue_read(EEPROM_CLOCK_SWING_ADDR + 4) == 60);
+
+  clock_config(4, TRAM8_CLOCK_OFF, 0);
+  assert(claimed == 0);
+
+  printf("config_persists passed\n");
+}
+
+int main(void) {
+  printf("Running clock tests...\n");
+
+  test_unassigned_gates_untouched();
+  test_dividers();
+  test_pulse_width_from_timer();
+  test_start_stop_continue();
+  test_swing_delays_offbeats();
+  test_reset_drops_late_pulse();
+  test_config_persists();
+
+  printf("All clock tests passed!\n");
+  return 0;
+}
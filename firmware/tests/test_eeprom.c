@@ -0,0 +1,187 @@
+#include "../../protocol/tram8_sysex.h"
+#include "../src/eeprom_queue.h"
+#include "../src/pitch_cal.h"
+#include <assert.h>
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mocked EEPROM controller: a step finishes the write in progress (if any)
+// and raises EE_RDY while the interrupt is enabled, like the hardware would.
+
+void EE_RDY_vect(void);
+
+static int writes;
+
+static int ee_hw_step(void) {
+  if (EECR & (1 << EEWE)) {
+    assert(EECR & (1 << EEMWE));
+    assert(EEAR < MOCK_EEPROM_SIZE);
+    mock_eeprom[EEAR] = EEDR;
+    writes++;
+    EECR &= (uint8_t)~((1 << EEWE) | (1 << EEMWE));
+  }
+  if (!(EECR & (1 << EERIE)))
+    return 0;
+  EE_RDY_vect();
+  return 1;
+}
+
+static void run_eeprom(void) {
+  while (ee_hw_step())
+    ;
+}
+
+static void reset(void) {
+  memset(mock_eeprom, 0xFF, sizeof(mock_eeprom));
+  EECR = 0;
+  writes = 0;
+  eeprom_queue_init();
+}
+
+static void test_init_loads_image(void) {
+  reset();
+  mock_eeprom[EEPROM_CHANNEL_ADDR] = 3;
+  mock_eeprom[EEPROM_MODE_ADDR] = 2;
+  eeprom_queue_init();
+
+  assert(eeprom_queue_read(EEPROM_CHANNEL_ADDR) == 3);
+  assert(eeprom_queue_read(EEPROM_MODE_ADDR) == 2);
+  assert(!eeprom_queue_busy());
+
+  printf("init_loads_image passed\n");
+}
+
+static void test_write_returns_before_programming(void) {
+  reset();
+  uint8_t notes[NUM_GATES] = {36, 37, 38, 39, 40, 41, 42, 43};
+  eeprom_queue_write(EEPROM_CHANNEL_ADDR, 9);
+  eeprom_queue_write_block(notes, EEPROM_NOTEMAP_ADDR, NUM_GATES);
+
+  // nothing programmed yet, but reads see the new values
+  assert(writes == 0);
+  assert(eeprom_queue_busy());
+  assert(eeprom_queue_read(EEPROM_CHANNEL_ADDR) == 9);
+  assert(eeprom_queue_read(EEPROM_NOTEMAP_ADDR + 7) == 43);
+
+  run_eeprom();
+  assert(writes == 1 + NUM_GATES);
+  assert(!eeprom_queue_busy());
+  assert(mock_eeprom[EEPROM_CHANNEL_ADDR] == 9);
+  for (uint8_t i = 0; i < NUM_GATES; i++)
+    assert(mock_eeprom[EEPROM_NOTEMAP_ADDR + i] == notes[i]);
+
+  printf("write_returns_before_programming passed\n");
+}
+
+static void test_unchanged_bytes_not_written(void) {
+  reset();
+  eeprom_queue_write(EEPROM_MODE_ADDR, 0xFF);
+  assert(!eeprom_queue_busy());
+
+  eeprom_queue_write(EEPROM_MODE_ADDR, 1);
+  eeprom_queue_write(EEPROM_MODE_ADDR, 0xFF); // back before it was programmed
+  run_eeprom();
+  assert(writes == 0);
+
+  printf("unchanged_bytes_not_written passed\n");
+}
+
+static void test_latest_value_wins(void) {
+  reset();
+  eeprom_queue_write(EEPROM_CHANNEL_ADDR, 1);
+  eeprom_queue_write(EEPROM_MODE_ADDR, 1);
+  ee_hw_step(); // channel byte goes out first
+
+  // rewritten while the first write is in progress
+  eeprom_queue_write(EEPROM_CHANNEL_ADDR, 2);
+  eeprom_queue_write(EEPROM_MODE_ADDR, 2);
+  run_eeprom();
+
+  assert(mock_eeprom[EEPROM_CHANNEL_ADDR] == 2);
+  assert(mock_eeprom[EEPROM_MODE_ADDR] == 2);
+  assert(writes == 3);
+
+  printf("latest_value_wins passed\n");
+}
+
+static void test_runs_map_to_addresses(void) {
+  reset();
+  mock_eeprom[EEPROM_NOTEMAP_ADDR + 7] = 11;
+  mock_eeprom[EEPROM_CAL_ADDR] = 22;
+  mock_eeprom[EEPROM_MAP_HIGH_ADDR + 7] = 33;
+  eeprom_queue_init();
+  assert(eeprom_queue_read(EEPROM_NOTEMAP_ADDR + 7) == 11);
+  assert(eeprom_queue_read(EEPROM_CAL_ADDR) == 22);
+  assert(eeprom_queue_read(EEPROM_MAP_HIGH_ADDR + 7) == 33);
+
+  eeprom_queue_write(EEPROM_NOTEMAP_ADDR + 7, 1);
+  eeprom_queue_write(EEPROM_MODE_ADDR, 2);
+  eeprom_queue_write(EEPROM_CAL_ADDR, 3);
+  eeprom_queue_write(EEPROM_MAP_HIGH_ADDR + 7, 4);
+  run_eeprom();
+  assert(mock_eeprom[EEPROM_NOTEMAP_ADDR + 7] == 1);
+  assert(mock_eeprom[EEPROM_MODE_ADDR] == 2);
+  assert(mock_eeprom[EEPROM_CAL_ADDR] == 3);
+  assert(mock_eeprom[EEPROM_MAP_HIGH_ADDR + 7] == 4);
+  assert(writes == 4);
+
+  printf("runs_map_to_addresses passed\n");
+}
+
+static void test_outside_image_ignored(void) {
+  reset();
+  eeprom_queue_write(EEPROM_IMAGE_END, 0);
+  eeprom_queue_write(EEPROM_IMAGE_BASE - 1, 0);
+  // the unused gaps between the runs are not mirrored either
+  eeprom_queue_write(EEPROM_NOTEMAP_ADDR + NUM_GATES, 0);
+  eeprom_queue_write(EEPROM_MODE_ADDR + 1, 0);
+  eeprom_queue_write(EEPROM_CAL_ADDR - 1, 0);
+  assert(!eeprom_queue_busy());
+  assert(eeprom_queue_read(EEPROM_MODE_ADDR + 1) == 0xFF);
+
+  printf("outside_image_ignored passed\n");
+}
+
+static void test_pitch_cal_defaults_when_erased(void) {
+  reset();
+  for (uint8_t ch = 0; ch < NUM_GATES; ch++) {
+    assert(pitch_cal_code(ch, 0) == 0);
+    assert(pitch_cal_code(ch, 60) == TRAM8_DAC_MAX);
+  }
+
+  printf("pitch_cal_defaults_when_erased passed\n");
+}
+
+static void test_pitch_cal_persists(void) {
+  reset();
+  pitch_cal_set(3, -20, 256);
+  assert(pitch_cal_code(3, 100) == 80);
+  assert(pitch_cal_code(2, 60) == TRAM8_DAC_MAX); // neighbours untouched
+  run_eeprom();
+
+  // survives a power cycle
+  eeprom_queue_init();
+  assert(pitch_cal_code(3, 100) == 80);
+  assert(mock_eeprom[EEPROM_CAL_ADDR + 3 * 4 + 2] == 0x00);
+  assert(mock_eeprom[EEPROM_CAL_ADDR + 3 * 4 + 3] == 0x01);
+
+  printf("pitch_cal_persists passed\n");
+}
+
+int main(void) {
+  printf("Running EEPROM queue tests...\n");
+
+  test_init_loads_image();
+  test_write_returns_before_programming();
+  test_unchanged_bytes_not_written();
+  test_latest_value_wins();
+  test_runs_map_to_addresses();
+  test_outside_image_ignored();
+  test_pitch_cal_defaults_when_erased();
+  test_pitch_cal_persists();
+
+  printf("All EEPROM queue tests passed!\n");
+  return 0;
+}
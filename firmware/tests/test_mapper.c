@@ -0,0 +1,138 @@
+#include "../src/eeprom_queue.h"
+#include "../src/midi_mapper.h"
+#include <assert.h>
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <stdio.h>
+#include <string.h>
+
+void EE_RDY_vect(void);
+
+// Programs the queued bytes into the mocked EEPROM, as the interrupt would
+static void flush_eeprom(void) {
+  while (EECR & (1 << EERIE)) {
+    if (EECR & (1 << EEWE)) {
+      mock_eeprom[EEAR] = EEDR;
+      EECR &= (uint8_t)~((1 << EEWE) | (1 << EEMWE));
+    }
+    EE_RDY_vect();
+  }
+}
+
+static void boot(void) {
+  EECR = 0;
+  eeprom_queue_init();
+  midi_mapper_init();
+}
+
+static void reset(void) {
+  memset(mock_eeprom, 0xFF, sizeof(mock_eeprom));
+  boot();
+}
+
+static void test_erased_eeprom_defaults(void) {
+  reset();
+  for (uint8_t gate = 0; gate < NUM_GATES; gate++) {
+    assert(midi_mapper_get_gates(9, 60 + gate) == (1 << gate));
+    assert(midi_mapper_get_note_for_gate(gate) == 60 + gate);
+  }
+  assert(midi_mapper_get_gates(0, 60) == 0);
+  assert(midi_mapper_get_gates(9, 59) == 0);
+
+  printf("erased_eeprom_defaults passed\n");
+}
+
+// A stock image has one channel and eight notes, nothing past them
+static void test_stock_image(void) {
+  memset(mock_eeprom, 0xFF, sizeof(mock_eeprom));
+  mock_eeprom[EEPROM_CHANNEL_ADDR] = 3;
+  for (uint8_t gate = 0; gate < NUM_GATES; gate++)
+    mock_eeprom[EEPROM_NOTEMAP_ADDR + gate] = (uint8_t)(36 + gate);
+  mock_eeprom[EEPROM_NOTEMAP_ADDR + 7] = 36; // two gates on one note
+  boot();
+
+  assert(midi_mapper_get_gates(3, 36) == 0x81);
+  assert(midi_mapper_get_gates(3, 42) == 0x40);
+  assert(midi_mapper_get_gates(9, 36) == 0);
+  assert(midi_mapper_get_map(7)->high == 36);
+
+  printf("stock_image passed\n");
+}
+
+static void test_channels_and_split(void) {
+  reset();
+  midi_mapper_clear();
+  assert(midi_mapper_get_gates(9, 60) == 0);
+  assert(midi_mapper_get_note_for_gate(0) == 0xFF);
+
+  midi_mapper_set_gate(0, 9, 36); // drum channel
+  midi_mapper_set_gate(1, 9, 38);
+  midi_mapper_set_range(2, 1, 0, 59); // keyboard split on channel 2
+  midi_mapper_set_range(3, 1, 60, 127);
+  midi_mapper_set_range(4, 1, 48, 71); // overlaps both halves
+
+  assert(midi_mapper_get_gates(9, 36) == 0x01);
+  assert(midi_mapper_get_gates(9, 38) == 0x02);
+  assert(midi_mapper_get_gates(1, 36) == 0x04);
+  assert(midi_mapper_get_gates(1, 0) == 0x04);
+  assert(midi_mapper_get_gates(1, 59) == 0x14);
+  assert(midi_mapper_get_gates(1, 60) == 0x18);
+  assert(midi_mapper_get_gates(1, 127) == 0x08);
+  assert(midi_mapper_get_gates(0, 60) == 0);
+
+  const GateMap* m = midi_mapper_get_map(3);
+  assert(m->channel == 1 && m->low == 60 && m->high == 127);
+  assert(midi_mapper_get_note_for_gate(2) == 0);
+
+  // remapping moves the gate out of its old range
+  midi_mapper_set_range(3, 2, 60, 60);
+  assert(midi_mapper_get_gates(1, 61) == 0x10);
+  assert(midi_mapper_get_gates(2, 60) == 0x08);
+
+  midi_mapper_set_range(3, MAPPER_NONE, 0, 0);
+  assert(midi_mapper_get_gates(2, 60) == 0);
+  assert(midi_mapper_get_note_for_gate(3) == 0xFF);
+
+  printf("channels_and_split passed\n");
+}
+
+static void test_save_and_reload(void) {
+  reset();
+  midi_mapper_clear();
+  midi_mapper_set_range(0, 4, 24, 47);
+  midi_mapper_set_gate(5, 9, 42);
+  midi_mapper_save();
+  assert(eeprom_queue_read(EEPROM_CHANNEL_ADDR) == 4);
+  assert(eeprom_queue_read(EEPROM_NOTEMAP_ADDR) == 24);
+
+  // reboot from the saved image; gate 0 is mapped so defaults stay off
+  flush_eeprom();
+  boot();
+  assert(midi_mapper_get_gates(4, 30) == 0x01);
+  assert(midi_mapper_get_gates(9, 42) == 0x20);
+  assert(midi_mapper_get_gates(9, 60) == 0);
+  assert(midi_mapper_get_note_for_gate(1) == 0xFF);
+
+  // an unmapped gate 0 must not read back as an erased map
+  midi_mapper_set_range(0, MAPPER_NONE, 0, 0);
+  midi_mapper_save();
+  flush_eeprom();
+  boot();
+  assert(midi_mapper_get_note_for_gate(0) == 0xFF);
+  assert(midi_mapper_get_gates(9, 60) == 0);
+  assert(midi_mapper_get_gates(9, 42) == 0x20);
+
+  printf("save_and_reload passed\n");
+}
+
+int main(void) {
+  printf("Running mapper tests...\n");
+
+  test_erased_eeprom_defaults();
+  test_stock_image();
+  test_channels_and_split();
+  test_save_and_reload();
+
+  printf("All mapper tests passed!\n");
+  return 0;
+}
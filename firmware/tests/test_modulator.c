@@ -0,0 +1,185 @@
+#include "../src/modulator.h"
+#include <assert.h>
+#include <stdio.h>
+
+static uint16_t dac[NUM_GATES];
+
+static uint8_t tick(uint8_t gates) {
+  mod_tick(gates);
+  return mod_take(dac);
+}
+
+static void setup(uint8_t slot, uint8_t dest, tram8_mod_type_t type) {
+  mod_reset();
+  mod_set(slot, TRAM8_MOD_DEST, dest);
+  mod_set(slot, TRAM8_MOD_TYPE, type);
+}
+
+static void test_off_by_default(void) {
+  mod_reset();
+  assert(tick(0xFF) == 0);
+  assert(mod_channels() == 0);
+
+  printf("off_by_default passed\n");
+}
+
+static void test_triangle_lfo(void) {
+  setup(0, 3, TRAM8_MOD_TRI);
+  mod_set(0, TRAM8_MOD_RATE, 1000); // 10 Hz: 100 ticks per cycle
+  mod_set(0, TRAM8_MOD_DEPTH, 2000);
+  mod_set(0, TRAM8_MOD_OFFSET, 2048);
+  assert(mod_channels() == 0x08);
+
+  uint16_t lo = 0xFFFF, hi = 0;
+  for (int t = 0; t < 100; t++) {
+    uint8_t mask = tick(0);
+    assert(mask == 0 || mask == 0x08);
+    if (dac[3] < lo)
+      lo = dac[3];
+    if (dac[3] > hi)
+      hi = dac[3];
+  }
+  assert(lo >= 1040 && lo <= 1060);
+  assert(hi >= 3030 && hi <= 3050);
+
+  printf("triangle_lfo passed\n");
+}
+
+static void test_square_and_saw(void) {
+  setup(1, 0, TRAM8_MOD_SQUARE);
+  mod_set(1, TRAM8_MOD_RATE, 1000);
+  mod_set(1, TRAM8_MOD_DEPTH, 4000);
+  mod_set(1, TRAM8_MOD_OFFSET, 2048);
+  tick(0);
+  assert(dac[0] >= 4040);
+  for (int t = 0; t < 50; t++)
+    tick(0);
+  assert(dac[0] <= 50);
+
+  setup(1, 0, TRAM8_MOD_SAW);
+  mod_set(1, TRAM8_MOD_RATE, 1000);
+  mod_set(1, TRAM8_MOD_DEPTH, 4000);
+  mod_set(1, TRAM8_MOD_OFFSET, 2048);
+  uint16_t prev = 0;
+  tick(0);
+  for (int t = 0; t < 98; t++) {
+    prev = dac[0];
+    tick(0);
+    assert(dac[0] >= prev); // ramps up within a cycle
+  }
+
+  printf("square_and_saw passed\n");
+}
+
+static void test_sample_hold_changes_per_cycle(void) {
+  setup(2, 5, TRAM8_MOD_SAMPLE_HOLD);
+  mod_set(2, TRAM8_MOD_RATE, 10000); // 100 Hz: 10 ticks per cycle
+  mod_set(2, TRAM8_MOD_DEPTH, TRAM8_DAC_MAX);
+  mod_set(2, TRAM8_MOD_OFFSET, 2048);
+
+  int changes = 0;
+  uint16_t prev = 0xFFFF;
+  for (int t = 0; t < 100; t++) {
+    tick(0);
+    if (dac[5] != prev)
+      changes++;
+    prev = dac[5];
+  }
+  assert(changes >= 9 && changes <= 11);
+
+  printf("sample_hold_changes_per_cycle passed\n");
+}
+
+static void test_gate_restarts_lfo(void) {
+  setup(0, 1, TRAM8_MOD_SAW);
+  mod_set(0, TRAM8_MOD_RATE, 100);
+  mod_set(0, TRAM8_MOD_DEPTH, 4000);
+  mod_set(0, TRAM8_MOD_OFFSET, 2048);
+  mod_set(0, TRAM8_MOD_TRIGGER, 6);
+
+  for (int t = 0; t < 300; t++)
+    tick(0);
+  uint16_t mid = dac[1];
+  assert(mid > 1000);
+
+  tick(0x40); // gate 6 rises: back to the bottom of the saw
+  assert(dac[1] < 100);
+
+  printf("gate_restarts_lfo passed\n");
+}
+
+static void test_ad_envelope(void) {
+  setup(3, 2, TRAM8_MOD_AD);
+  mod_set(3, TRAM8_MOD_ATTACK, 10);
+  mod_set(3, TRAM8_MOD_DECAY, 100);
+  mod_set(3, TRAM8_MOD_DEPTH, 4000);
+  mod_set(3, TRAM8_MOD_TRIGGER, 0);
+
+  // idle until triggered
+  tick(0);
+  assert(dac[2] == 0);
+
+  uint16_t prev = 0;
+  tick(0x01);
+  for (int t = 0; t < 9; t++) {
+    assert(dac[2] >= prev);
+    prev = dac[2];
+    tick(0x01);
+  }
+  tick(0x00); // AD ignores the gate falling
+  assert(dac[2] >= 3990);
+
+  for (int t = 0; t < 100; t++) {
+    prev = dac[2];
+    tick(0);
+    assert(dac[2] <= prev);
+  }
+  assert(dac[2] == 0);
+
+  printf("ad_envelope passed\n");
+}
+
+static void test_adsr_envelope(void) {
+  setup(0, 4, TRAM8_MOD_ADSR);
+  mod_set(0, TRAM8_MOD_ATTACK, 5);
+  mod_set(0, TRAM8_MOD_DECAY, 20);
+  mod_set(0, TRAM8_MOD_SUSTAIN, 2048);
+  mod_set(0, TRAM8_MOD_RELEASE, 50);
+  mod_set(0, TRAM8_MOD_DEPTH, 4000);
+  mod_set(0, TRAM8_MOD_OFFSET, 50);
+  mod_set(0, TRAM8_MOD_TRIGGER, 7);
+
+  for (int t = 0; t < 200; t++)
+    tick(0x80);
+  assert(dac[4] >= 2040 && dac[4] <= 2060); // offset + half depth
+
+  // release from sustain on the falling edge
+  tick(0x00);
+  for (int t = 0; t < 60; t++)
+    tick(0x00);
+  assert(dac[4] == 50);
+
+  // release partway through the attack starts from where it got to
+  tick(0x80);
+  tick(0x80);
+  uint16_t at = dac[4];
+  tick(0x00);
+  assert(dac[4] <= at && dac[4] > 50);
+
+  printf("adsr_envelope passed\n");
+}
+
+int main(void) {
+  printf("Running modulator tests...\n");
+
+  test_off_by_default();
+  test_triangle_lfo();
+  test_square_and_saw();
+  test_sample_hold_changes_per_cycle();
+  test_gate_restarts_lfo();
+  test_ad_envelope();
+  test_adsr_envelope();
+
+  printf("All modulator tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include "../src/ramp.h"
+#include <assert.h>
+#include <stdio.h>
+
+static uint16_t dac[NUM_GATES];
+
+// One tick, then the main loop collects what changed
+static uint8_t tick(void) {
+  ramp_tick();
+  return ramp_take(dac);
+}
+
+static void test_linear_reaches_target_on_time(void) {
+  ramp_stop(0xFF);
+  ramp_start(0, 0, 1000, 10, TRAM8_CURVE_LINEAR);
+
+  for (int t = 1; t < 10; t++) {
+    assert(tick() == 0x01);
+    assert(dac[0] >= 100 * t - 1 && dac[0] <= 100 * t + 1);
+  }
+  assert(tick() == 0x01);
+  assert(dac[0] == 1000);
+
+  // finished: no more updates
+  assert(tick() == 0);
+
+  printf("linear_reaches_target_on_time passed\n");
+}
+
+static void test_curves_monotonic(void) {
+  for (int curve = TRAM8_CURVE_LINEAR; curve <= TRAM8_CURVE_S; curve++) {
+    ramp_stop(0xFF);
+    ramp_start(1, 4000, 100, 500, (tram8_curve_t)curve);
+    ramp_start(2, 100, 4000, 500, (tram8_curve_t)curve);
+
+    uint16_t down = 4000, up = 100;
+    for (int t = 0; t < 500; t++) {
+      assert(tick() == 0x06);
+      assert(dac[1] <= down);
+      assert(dac[2] >= up);
+      down = dac[1];
+      up = dac[2];
+    }
+    assert(dac[1] == 100);
+    assert(dac[2] == 4000);
+    assert(tick() == 0);
+  }
+
+  printf("curves_monotonic passed\n");
+}
+
+static void test_curve_shapes(void) {
+  // halfway through: ease-in lags, ease-out leads, S-curve crosses the middle
+  const uint16_t expect_lo[] = {1990, 900, 2900, 1990};
+  const uint16_t expect_hi[] = {2010, 1100, 3100, 2010};
+  for (int curve = TRAM8_CURVE_LINEAR; curve <= TRAM8_CURVE_S; curve++) {
+    ramp_stop(0xFF);
+    ramp_start(3, 0, 4000, 100, (tram8_curve_t)curve);
+    for (int t = 0; t < 50; t++)
+      tick();
+    assert(dac[3] >= expect_lo[curve] && dac[3] <= expect_hi[curve]);
+  }
+
+  printf("curve_shapes passed\n");
+}
+
+static void test_zero_duration_jumps(void) {
+  ramp_stop(0xFF);
+  ramp_start(4, 0, 0xABC, 0, TRAM8_CURVE_S);
+  assert(tick() == 0x10);
+  assert(dac[4] == 0xABC);
+  assert(tick() == 0);
+
+  printf("zero_duration_jumps passed\n");
+}
+
+static void test_stop_and_retarget(void) {
+  ramp_stop(0xFF);
+  ramp_start(5, 0, 1000, 100, TRAM8_CURVE_LINEAR);
+  ramp_start(6, 0, 1000, 100, TRAM8_CURVE_LINEAR);
+  for (int t = 0; t < 50; t++)
+    tick();
+  assert(dac[5] >= 490 && dac[5] <= 510);
+
+  // a direct write takes the channel over
+  ramp_stop(0x20);
+  assert(tick() == 0x40);
+
+  // retargeting continues from the current position, whatever from says
+  uint16_t at = dac[6];
+  ramp_start(6, 0, 0, 10, TRAM8_CURVE_LINEAR);
+  assert(tick() == 0x40);
+  assert(dac[6] < at && dac[6] > at / 2);
+
+  printf("stop_and_retarget passed\n");
+}
+
+int main(void) {
+  printf("Running ramp tests...\n");
+
+  test_linear_reaches_target_on_time();
+  test_curves_monotonic();
+  test_curve_shapes();
+  test_zero_duration_jumps();
+  test_stop_and_retarget();
+
+  printf("All ramp tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,313 @@
+#include "../src/max5825_control.h"
+#include "../src/scheduler.h"
+#include "mock/mock_twi_bus.h"
+#include <assert.h>
+#include <stdio.h>
+
+// Gate outputs are captured instead of driving ports
+static uint8_t gates;
+static int ldac_pulses;
+
+void gate_set_mask(uint8_t mask) {
+  gates = mask;
+  // LDAC is pulsed and released before the gates are written
+  assert(PORTC & (1 << LDAC_PIN));
+  ldac_pulses++;
+}
+
+uint8_t gate_get_mask(void) {
+  return gates;
+}
+
+// Trigger gates are claimed, so the scheduler fires them instead
+static uint8_t triggered;
+
+void trigger_fire(uint8_t bits) {
+  triggered |= bits;
+}
+
+static void reset(void) {
+  sched_clear();
+  sched_take_fired();
+  max5825_init(); // shadow back to a known zero
+  mock_twi_run();
+  mock_twi_reset();
+  gates = 0;
+  ldac_pulses = 0;
+  triggered = 0;
+  sched_set_gates(0);
+  PORTC = (uint8_t)(1 << LDAC_PIN);
+}
+
+// One millisecond with the main loop running freely
+static void run_ms(int n) {
+  for (int i = 0; i < n; i++) {
+    sched_service();
+    mock_twi_run();
+    sched_service();
+    sched_tick();
+  }
+}
+
+static void test_fires_on_exact_tick(void) {
+  reset();
+  uint16_t dac[NUM_GATES] = {0};
+  dac[2] = 0x123;
+  assert(sched_push(5, 0x04, dac, 0x04));
+
+  run_ms(4);
+  assert(gates == 0);
+  // codes were preloaded well before the tick
+  assert(bus_len > 0);
+  assert(bus[2] == (MAX5825_REG_CODEn | 2));
+
+  // CV loads on the tick, the gate goes up on the next one
+  run_ms(1);
+  assert(gates == 0);
+  assert(sched_take_fired() == 1);
+  assert(sched_take_fired() == 0);
+  assert(sched_gates() == 0x04);
+  run_ms(1);
+  assert(gates == 0x04);
+
+  printf("fires_on_exact_tick passed\n");
+}
+
+static void test_chained_offsets(void) {
+  reset();
+  uint16_t dac[NUM_GATES] = {0};
+
+  // a burst sent at once keeps its spacing
+  assert(sched_push(2, 0x01, dac, 0));
+  assert(sched_push(3, 0x02, dac, 0));
+  assert(sched_push(0, 0x03, dac, 0));
+  assert(sched_push(4, 0x00, dac, 0));
+
+  run_ms(1);
+  assert(gates == 0x00);
+  run_ms(1);
+  assert(gates == 0x01);
+  run_ms(2);
+  assert(gates == 0x01);
+  run_ms(1);
+  assert(gates == 0x03); // both events due on the same tick
+  run_ms(3);
+  assert(gates == 0x03);
+  run_ms(1);
+  assert(gates == 0x00);
+  assert(sched_take_fired() == 4);
+
+  // run dry: the next event counts from its arrival
+  run_ms(10);
+  assert(sched_push(1, 0x80, dac, 0));
+  run_ms(1);
+  assert(gates == 0x80);
+
+  printf("chained_offsets passed\n");
+}
+
+static void test_late_codes_fire_from_main_loop(void) {
+  reset();
+  uint16_t before = sched_late_count();
+  uint16_t dac[NUM_GATES] = {0};
+  dac[0] = 0x555;
+  assert(sched_push(1, 0x01, dac, 0x01));
+
+  // bus stalled past the due tick
+  sched_service();
+  sched_tick();
+  sched_tick();
+  assert(gates == 0);
+
+  mock_twi_run();
+  sched_service();
+  assert(sched_take_fired() == 1);
+  assert(sched_late_count() == before + 1);
+  sched_tick();
+  assert(gates == 0x01);
+
+  printf("late_codes_fire_from_main_loop passed\n");
+}
+
+// The DAC as the bus and LDAC leave it: CODE registers and outputs
+static uint16_t chip_code[NUM_GATES];
+static uint16_t chip_out[NUM_GATES];
+static int bus_seen;
+
+// Each transaction is START, SLA+W, then command/data triplets until STOP
+static void chip_sync(void) {
+  static int in_txn; // bytes seen since START
+  static int cmd;
+  static int hi;
+  for (; bus_seen < bus_len; bus_seen++) {
+    int b = bus[bus_seen];
+    if (b < 0) {
+      in_txn = 0;
+      continue;
+    }
+    int pos = in_txn++;
+    if (pos == 0)
+      continue; // SLA+W
+    if ((pos - 1) % 3 == 0)
+      cmd = b;
+    else if ((pos - 1) % 3 == 1)
+      hi = b;
+    else if ((cmd & 0xF0) == MAX5825_REG_CODEn)
+      chip_code[cmd & 7] = (uint16_t)(hi << 4 | b >> 4);
+  }
+}
+
+static void chip_load(void) {
+  chip_sync();
+  for (int ch = 0; ch < NUM_GATES; ch++)
+    chip_out[ch] = chip_code[ch];
+}
+
+// A ramp on channel 0 keeps loading every tick, the way the main loop does,
+// while an event for channel 2 waits: its CV must not reach the output early
+static void test_ramp_runs_while_event_pending(void) {
+  reset();
+  for (int ch = 0; ch < NUM_GATES; ch++)
+    chip_code[ch] = chip_out[ch] = 0;
+  bus_seen = 0;
+  uint16_t dac[NUM_GATES] = {0};
+  dac[2] = 0x123;
+  assert(sched_push(20, 0x04, dac, 0x04));
+
+  uint16_t ramp[NUM_GATES] = {0};
+  int ramp_loads = 0;
+  for (int ms = 1; ms <= 20; ms++) {
+    ramp[0] = (uint16_t)(ms * 100);
+    max5825_stage_codes(ramp, 0x01);
+    sched_service();
+    if (!sched_holds_dac()) {
+      max5825_service();
+      mock_twi_run();
+      chip_load(); // the main loop's latch
+      ramp_loads++;
+    }
+    mock_twi_run();
+    sched_service();
+    chip_sync();
+    int pulses = ldac_pulses;
+    sched_tick();
+    if (ldac_pulses != pulses)
+      chip_load();
+
+    if (ms < 20) {
+      assert(gates == 0);
+      assert(chip_out[2] == 0);
+    }
+  }
+  assert(chip_out[2] == 0x123);
+  sched_tick();
+  assert(gates == 0x04);
+  // held back only for the preload window
+  assert(ramp_loads >= 20 - SCHED_PRELOAD_TICKS);
+  assert(chip_out[0] >= 100 * (20 - SCHED_PRELOAD_TICKS));
+  assert(!sched_holds_dac());
+
+  printf("ramp_runs_while_event_pending passed\n");
+}
+
+// Trigger gates pulse on bits an event raises, after its CV has settled
+static void test_rising_bits_fire_triggers(void) {
+  reset();
+  uint16_t dac[NUM_GATES] = {0};
+  dac[1] = 0x400;
+  assert(sched_push(2, 0x03, dac, 0x02));
+
+  run_ms(2);
+  assert(sched_take_fired() == 1);
+  assert(triggered == 0); // CV just loaded
+  run_ms(1);
+  assert(triggered == 0x03);
+
+  // held bits do not retrigger; gate-only events fire on their own tick
+  triggered = 0;
+  assert(sched_push(1, 0x07, dac, 0));
+  run_ms(1);
+  assert(triggered == 0x04);
+
+  // a bit already raised outside the schedule is held too
+  triggered = 0;
+  sched_set_gates(0x01);
+  assert(sched_push(1, 0x11, dac, 0));
+  run_ms(1);
+  assert(triggered == 0x10);
+
+  printf("rising_bits_fire_triggers passed\n");
+}
+
+// Gates the immediate path sets while an event's CV settles belong to it:
+// the event must not raise them ahead of their own DAC writes
+static void test_settling_raises_own_gates(void) {
+  reset();
+  uint16_t dac[NUM_GATES] = {0};
+  dac[0] = 0x321;
+  assert(sched_push(1, 0x05, dac, 0x01));
+
+  run_ms(1);
+  assert(sched_take_fired() == 1);
+  assert(gates == 0);
+
+  // a frame raises gate 1 (its CODE write not latched yet) and drops gate 2
+  sched_set_gates(0x03);
+  sched_tick();
+  assert(gates == 0x01);
+
+  printf("settling_raises_own_gates passed\n");
+}
+
+// A generator taking a channel over drops it from events already queued
+static void test_drop_dac(void) {
+  reset();
+  uint16_t dac[NUM_GATES] = {0};
+  dac[2] = 0x222;
+  dac[3] = 0x333;
+  assert(sched_push(5, 0x00, dac, 0x0C));
+  assert(sched_push(5, 0x00, dac, 0x04));
+  sched_drop_dac(0x04);
+
+  run_ms(5);
+  assert(sched_take_fired() == 1);
+  assert(bus_len == 2 + 3 + 1);
+  assert(bus[2] == (MAX5825_REG_CODEn | 3));
+  // nothing left to preload: fires on its own tick
+  run_ms(5);
+  assert(sched_take_fired() == 1);
+  assert(bus_len == 2 + 3 + 1);
+
+  printf("drop_dac passed\n");
+}
+
+static void test_queue_full(void) {
+  reset();
+  uint16_t dac[NUM_GATES] = {0};
+  for (int i = 0; i < SCHED_QUEUE_SIZE; i++)
+    assert(sched_push(1, (uint8_t)i, dac, 0));
+  assert(!sched_push(1, 0xFF, dac, 0));
+
+  sched_clear();
+  assert(sched_push(1, 0xFF, dac, 0));
+  run_ms(1);
+  assert(gates == 0xFF);
+
+  printf("queue_full passed\n");
+}
+
+int main(void) {
+  printf("Running scheduler tests...\n");
+
+  test_fires_on_exact_tick();
+  test_chained_offsets();
+  test_late_codes_fire_from_main_loop();
+  test_ramp_runs_while_event_pending();
+  test_rising_bits_fire_triggers();
+  test_settling_raises_own_gates();
+  test_drop_dac();
+  test_queue_full();
+
+  printf("All scheduler tests passed!\n");
+  return 0;
+}
@@ -1,6 +1,7 @@
 #include "../../protocol/tram8_sysex.h"
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static void test_gates_only(void) {
@@ -16,8 +17,9 @@ static void test_gates_only(void) {
 
   uint8_t gate_out;
   uint16_t dac_out[8] = {0};
+  uint8_t dac_mask;
   tram8_form_t form;
-  assert(tram8_parse(buf, len, &gate_out, dac_out, &form) == 0);
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
   assert(gate_out == 0xA5);
   assert(form == TRAM8_FORM_GATES);
 
@@ -35,8 +37,9 @@ static void test_coarse_roundtrip(void) {
 
   uint8_t gate_out;
   uint16_t dac_out[8];
+  uint8_t dac_mask;
   tram8_form_t form;
-  assert(tram8_parse(buf, len, &gate_out, dac_out, &form) == 0);
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
   assert(gate_out == 0xFF);
   assert(form == TRAM8_FORM_COARSE);
 
@@ -57,8 +60,9 @@ static void test_full_roundtrip(void) {
 
   uint8_t gate_out;
   uint16_t dac_out[8];
+  uint8_t dac_mask;
   tram8_form_t form;
-  assert(tram8_parse(buf, len, &gate_out, dac_out, &form) == 0);
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
   assert(gate_out == 0xA5);
   assert(form == TRAM8_FORM_FULL);
 
@@ -78,8 +82,9 @@ static void test_gate8_bit7(void) {
 
   uint8_t gate_out;
   uint16_t dac_out[8];
+  uint8_t dac_mask;
   tram8_form_t form;
-  assert(tram8_parse(buf, TRAM8_LEN_GATES, &gate_out, dac_out, &form) == 0);
+  assert(tram8_parse(buf, TRAM8_LEN_GATES, &gate_out, dac_out, &dac_mask, &form) == 0);
   assert(gate_out == 0x80);
 
   printf("gate8_bit7 passed\n");
@@ -108,8 +113,9 @@ static void test_velocity_precision(void) {
 
   uint8_t gate_out;
   uint16_t dac_out[8];
+  uint8_t dac_mask;
   tram8_form_t form;
-  assert(tram8_parse(buf, len, &gate_out, dac_out, &form) == 0);
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
   assert(dac_out[0] == 127 << 5);
 
   printf("velocity_precision passed\n");
@@ -123,8 +129,9 @@ static void test_roundtrip_zeros(void) {
 
   uint8_t gate_out;
   uint16_t dac_out[8];
+  uint8_t dac_mask;
   tram8_form_t form;
-  assert(tram8_parse(buf, len, &gate_out, dac_out, &form) == 0);
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
   assert(gate_out == 0x00);
   for (int i = 0; i < 8; i++)
     assert(dac_out[i] == 0);
@@ -142,8 +149,9 @@ static void test_roundtrip_all_ones(void) {
 
   uint8_t gate_out;
   uint16_t dac_out[8];
+  uint8_t dac_mask;
   tram8_form_t form;
-  assert(tram8_parse(buf, len, &gate_out, dac_out, &form) == 0);
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
   assert(gate_out == 0xFF);
   for (int i = 0; i < 8; i++)
     assert(dac_out[i] == TRAM8_DAC_MAX);
@@ -161,8 +169,9 @@ static void test_roundtrip_each_gate(void) {
 
     uint8_t gate_out;
     uint16_t dac_out[8];
+    uint8_t dac_mask;
     tram8_form_t form;
-    assert(tram8_parse(buf, TRAM8_LEN_GATES, &gate_out, dac_out, &form) == 0);
+    assert(tram8_parse(buf, TRAM8_LEN_GATES, &gate_out, dac_out, &dac_mask, &form) == 0);
     assert(gate_out == gate_mask);
   }
 
@@ -179,8 +188,9 @@ static void test_roundtrip_each_dac(void) {
 
     uint8_t gate_out;
     uint16_t dac_out[8];
+    uint8_t dac_mask;
     tram8_form_t form;
-    assert(tram8_parse(buf, len, &gate_out, dac_out, &form) == 0);
+    assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
     for (int i = 0; i < 8; i++)
       assert(dac_out[i] == dac_in[i]);
   }
@@ -195,8 +205,9 @@ static void test_parse_rejects_short(void) {
 
   uint8_t gate_out;
   uint16_t dac_out[8];
+  uint8_t dac_mask;
   tram8_form_t form;
-  assert(tram8_parse(buf, TRAM8_LEN_GATES - 1, &gate_out, dac_out, &form) == -1);
+  assert(tram8_parse(buf, TRAM8_LEN_GATES - 1, &gate_out, dac_out, &dac_mask, &form) == -1);
 
   printf("parse_rejects_short passed\n");
 }
@@ -208,10 +219,11 @@ static void test_parse_rejects_bad_header(void) {
 
   uint8_t gate_out;
   uint16_t dac_out[8];
+  uint8_t dac_mask;
   tram8_form_t form;
 
   buf[1] = 0x00;
-  assert(tram8_parse(buf, TRAM8_LEN_GATES, &gate_out, dac_out, &form) == -1);
+  assert(tram8_parse(buf, TRAM8_LEN_GATES, &gate_out, dac_out, &dac_mask, &form) == -1);
 
   printf("parse_rejects_bad_header passed\n");
 }
@@ -230,6 +242,424 @@ static void test_message_framing(void) {
   printf("message_framing passed\n");
 }
 
+static void test_delta_single_channel(void) {
+  uint8_t buf[TRAM8_LEN_MAX];
+  uint16_t dac_in[8] = {0, 0, 0x5A5, 0, 0, 0, 0, 0};
+
+  uint8_t len = tram8_pack_delta(buf, 0x04, dac_in, 0x04);
+  assert(len == 10);
+  assert(len == tram8_delta_len(0x04));
+  assert(buf[2] == TRAM8_CMD_DELTA);
+  assert(buf[len - 1] == TRAM8_SYSEX_END);
+
+  uint8_t gate_out;
+  uint16_t dac_out[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  uint8_t dac_mask;
+  tram8_form_t form;
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
+  assert(form == TRAM8_FORM_DELTA);
+  assert(gate_out == 0x04);
+  assert(dac_mask == 0x04);
+  assert(dac_out[2] == 0x5A5);
+
+  // channels outside the mask are left untouched
+  assert(dac_out[0] == 1);
+  assert(dac_out[7] == 8);
+
+  printf("delta_single_channel passed\n");
+}
+
+static void test_delta_roundtrip_all_masks(void) {
+  uint16_t dac_in[8] = {0x000, 0xFFF, 0x123, 0x456, 0x789, 0xABC, 0x001, 0x800};
+
+  for (int mask = 0; mask < 256; mask++) {
+    uint8_t buf[TRAM8_LEN_MAX];
+    uint8_t len = tram8_pack_delta(buf, (uint8_t)~mask, dac_in, (uint8_t)mask);
+    assert(len == tram8_delta_len((uint8_t)mask));
+    assert(len <= TRAM8_LEN_MAX);
+
+    for (int i = 1; i < len - 1; i++)
+      assert(buf[i] <= 0x7F);
+
+    uint8_t gate_out;
+    uint16_t dac_out[8] = {0};
+    uint8_t dac_mask;
+    tram8_form_t form;
+    assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
+    assert(gate_out == (uint8_t)~mask);
+    assert(dac_mask == mask);
+    for (int i = 0; i < 8; i++)
+      assert(dac_out[i] == (((mask >> i) & 1) ? dac_in[i] : 0));
+  }
+
+  printf("delta_roundtrip_all_masks passed\n");
+}
+
+static void test_delta_shorter_than_full(void) {
+  // one pitch + one velocity channel beats Form 3
+  assert(tram8_delta_len(0x03) < TRAM8_LEN_FULL);
+  assert(tram8_delta_len(0x3F) == TRAM8_LEN_FULL);
+  assert(tram8_delta_len(0xFF) == 24);
+  assert(tram8_delta_len(0xFF) < TRAM8_LEN_MAX);
+
+  printf("delta_shorter_than_full passed\n");
+}
+
+static void test_delta_rejects_bad_length(void) {
+  uint8_t buf[TRAM8_LEN_MAX];
+  uint16_t dac_in[8] = {0};
+  uint8_t len = tram8_pack_delta(buf, 0, dac_in, 0x11);
+
+  uint8_t gate_out;
+  uint16_t dac_out[8];
+  uint8_t dac_mask;
+  tram8_form_t form;
+  assert(tram8_parse(buf, len - 2, &gate_out, dac_out, &dac_mask, &form) == -1);
+  assert(tram8_parse(buf, TRAM8_LEN_DELTA_BASE - 1, &gate_out, dac_out, &dac_mask, &form) == -1);
+
+  printf("delta_rejects_bad_length passed\n");
+}
+
+static void test_dac_mask_per_form(void) {
+  uint8_t buf[TRAM8_LEN_MAX];
+  uint16_t dac_in[8] = {0};
+  uint8_t gate_out;
+  uint16_t dac_out[8];
+  uint8_t dac_mask;
+  tram8_form_t form;
+
+  uint8_t len = tram8_pack(buf, 0, dac_in, TRAM8_FORM_GATES);
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
+  assert(dac_mask == 0x00);
+
+  len = tram8_pack(buf, 0, dac_in, TRAM8_FORM_COARSE);
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
+  assert(dac_mask == 0xFF);
+
+  len = tram8_pack(buf, 0, dac_in, TRAM8_FORM_FULL);
+  assert(tram8_parse(buf, len, &gate_out, dac_out, &dac_mask, &form) == 0);
+  assert(dac_mask == 0xFF);
+
+  printf("dac_mask_per_form passed\n");
+}
+
+static void test_bend_roundtrip(void) {
+  for (uint16_t dac = 0; dac <= TRAM8_DAC_MAX; dac++) {
+    uint8_t lsb, msb;
+    tram8_dac_to_bend(dac, &lsb, &msb);
+    assert(lsb <= 0x7F);
+    assert(msb <= 0x7F);
+    assert(tram8_bend_to_dac(lsb, msb) == dac);
+  }
+
+  // bend msb carries the same 7 bits as a coarse DAC byte
+  uint8_t lsb, msb;
+  tram8_dac_to_bend(127 << 5, &lsb, &msb);
+  assert(msb == 127);
+  assert(lsb == 0);
+
+  printf("bend_roundtrip passed\n");
+}
+
+static void test_cal_roundtrip(void) {
+  const int16_t offsets[] = {0, 1, -1, 127, -300, 32767, -32768};
+  const uint16_t gains[] = {0, 1, TRAM8_CAL_GAIN_DEFAULT, 0x8000, 0xFFFF};
+  for (uint8_t ch = 0; ch < TRAM8_NUM_GATES; ch++) {
+    for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+      for (size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); g++) {
+        uint8_t buf[TRAM8_LEN_CAL];
+        assert(tram8_pack_cal(buf, ch, offsets[o], gains[g]) == TRAM8_LEN_CAL);
+        for (int i = 1; i < TRAM8_LEN_CAL - 1; i++)
+          assert(buf[i] < 0x80);
+
+        uint8_t out_ch;
+        int16_t offset;
+        uint16_t gain;
+        assert(tram8_parse_cal(buf, TRAM8_LEN_CAL, &out_ch, &offset, &gain) == 0);
+        assert(out_ch == ch);
+        assert(offset == offsets[o]);
+        assert(gain == gains[g]);
+      }
+    }
+  }
+
+  uint8_t buf[TRAM8_LEN_CAL];
+  uint8_t ch;
+  int16_t offset;
+  uint16_t gain;
+  tram8_pack_cal(buf, 0, 0, TRAM8_CAL_GAIN_DEFAULT);
+  assert(tram8_parse_cal(buf, TRAM8_LEN_CAL - 1, &ch, &offset, &gain) == -1);
+  buf[3] = TRAM8_NUM_GATES;
+  assert(tram8_parse_cal(buf, TRAM8_LEN_CAL, &ch, &offset, &gain) == -1);
+
+  // state parser does not take calibration frames
+  uint16_t dac[8];
+  uint8_t gates, mask;
+  tram8_form_t form;
+  tram8_pack_cal(buf, 0, 0, TRAM8_CAL_GAIN_DEFAULT);
+  assert(tram8_parse(buf, TRAM8_LEN_CAL, &gates, dac, &mask, &form) == -1);
+
+  printf("cal_roundtrip passed\n");
+}
+
+static void test_pitch_to_dac(void) {
+  // default calibration spans 60 semitones over the full DAC range
+  assert(tram8_pitch_to_dac(0, TRAM8_CAL_OFFSET_DEFAULT, TRAM8_CAL_GAIN_DEFAULT) == 0);
+  assert(tram8_pitch_to_dac(60, TRAM8_CAL_OFFSET_DEFAULT, TRAM8_CAL_GAIN_DEFAULT) == TRAM8_DAC_MAX);
+  assert(tram8_pitch_to_dac(12, TRAM8_CAL_OFFSET_DEFAULT, TRAM8_CAL_GAIN_DEFAULT) == 819);
+  assert(tram8_pitch_to_dac(127, TRAM8_CAL_OFFSET_DEFAULT, TRAM8_CAL_GAIN_DEFAULT) == TRAM8_DAC_MAX);
+
+  // octaves stay evenly spaced
+  for (uint8_t n = 0; n + 12 <= 60; n++) {
+    int step = tram8_pitch_to_dac(n + 12, 0, TRAM8_CAL_GAIN_DEFAULT) - tram8_pitch_to_dac(n, 0, TRAM8_CAL_GAIN_DEFAULT);
+    assert(step >= 818 && step <= 820);
+  }
+
+  assert(tram8_pitch_to_dac(0, -50, TRAM8_CAL_GAIN_DEFAULT) == 0);
+  assert(tram8_pitch_to_dac(1, -50, TRAM8_CAL_GAIN_DEFAULT) == 18);
+  assert(tram8_pitch_to_dac(0, 40, TRAM8_CAL_GAIN_DEFAULT) == 40);
+  assert(tram8_pitch_to_dac(10, 0, 256) == 10);
+
+  printf("pitch_to_dac passed\n");
+}
+
+static void test_scheduled_roundtrip(void) {
+  uint16_t dac[8];
+  for (int i = 0; i < 8; i++)
+    dac[i] = (uint16_t)(i * 511);
+  const uint16_t ticks[] = {0, 1, 127, 128, 16383};
+
+  for (size_t t = 0; t < sizeof(ticks) / sizeof(ticks[0]); t++) {
+    for (int mask = 0; mask < 256; mask += 37) {
+      uint8_t buf[TRAM8_LEN_MAX];
+      uint8_t len = tram8_pack_scheduled(buf, ticks[t], (uint8_t)~mask, dac, (uint8_t)mask);
+      assert(len == tram8_sched_len((uint8_t)mask));
+      assert(len <= TRAM8_LEN_MAX);
+      for (int i = 1; i < len - 1; i++)
+        assert(buf[i] < 0x80);
+
+      uint16_t out_ticks;
+      uint8_t gates, out_mask;
+      uint16_t out[8] = {0};
+      assert(tram8_parse_scheduled(buf, len, &out_ticks, &gates, out, &out_mask) == 0);
+      assert(out_ticks == ticks[t]);
+      assert(gates == (uint8_t)~mask);
+      assert(out_mask == mask);
+      for (int i = 0; i < 8; i++) {
+        if ((mask >> i) & 1)
+          assert(out[i] == dac[i]);
+      }
+
+      // length must match the mask
+      assert(tram8_parse_scheduled(buf, (uint8_t)(len - 1), &out_ticks, &gates, out, &out_mask) == -1);
+    }
+  }
+
+  // the immediate parser leaves scheduled frames alone
+  uint8_t buf[TRAM8_LEN_MAX];
+  uint8_t len = tram8_pack_scheduled(buf, 10, 0x01, dac, 0x01);
+  uint8_t gates, mask;
+  tram8_form_t form;
+  assert(tram8_parse(buf, len, &gates, dac, &mask, &form) == -1);
+
+  printf("scheduled_roundtrip passed\n");
+}
+
+static void test_ramp_roundtrip(void) {
+  const uint16_t targets[] = {0, 1, 0x800, TRAM8_DAC_MAX};
+  const uint16_t durations[] = {0, 1, 300, 16383};
+  for (uint8_t ch = 0; ch < TRAM8_NUM_GATES; ch++) {
+    for (int curve = TRAM8_CURVE_LINEAR; curve <= TRAM8_CURVE_S; curve++) {
+      for (int t = 0; t < 4; t++) {
+        uint8_t buf[TRAM8_LEN_RAMP];
+        assert(tram8_pack_ramp(buf, ch, targets[t], durations[t], (tram8_curve_t)curve) == TRAM8_LEN_RAMP);
+        for (int i = 1; i < TRAM8_LEN_RAMP - 1; i++)
+          assert(buf[i] < 0x80);
+
+        uint8_t out_ch;
+        uint16_t target, duration;
+        tram8_curve_t out_curve;
+        assert(tram8_parse_ramp(buf, TRAM8_LEN_RAMP, &out_ch, &target, &duration, &out_curve) == 0);
+        assert(out_ch == ch);
+        assert(target == targets[t]);
+        assert(duration == durations[t]);
+        assert(out_curve == (tram8_curve_t)curve);
+      }
+    }
+  }
+
+  uint8_t buf[TRAM8_LEN_RAMP];
+  uint8_t ch;
+  uint16_t target, duration;
+  tram8_curve_t curve;
+  tram8_pack_ramp(buf, 0, 0, 0, TRAM8_CURVE_LINEAR);
+  assert(tram8_parse_ramp(buf, TRAM8_LEN_RAMP - 1, &ch, &target, &duration, &curve) == -1);
+  buf[3] = 0x20; // reserved bits
+  assert(tram8_parse_ramp(buf, TRAM8_LEN_RAMP, &ch, &target, &duration, &curve) == -1);
+
+  printf("ramp_roundtrip passed\n");
+}
+
+static void test_mod_roundtrip(void) {
+  const uint16_t values[] = {0, 1, 127, 128, TRAM8_DAC_MAX, 16383};
+  for (uint8_t slot = 0; slot < TRAM8_MOD_SLOTS; slot++) {
+    for (int param = 0; param < TRAM8_MOD_PARAM_COUNT; param++) {
+      for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+        uint8_t buf[TRAM8_LEN_MOD];
+        assert(tram8_pack_mod(buf, slot, (tram8_mod_param_t)param, values[v]) == TRAM8_LEN_MOD);
+        for (int i = 1; i < TRAM8_LEN_MOD - 1; i++)
+          assert(buf[i] < 0x80);
+
+        uint8_t out_slot;
+        tram8_mod_param_t out_param;
+        uint16_t value;
+        assert(tram8_parse_mod(buf, TRAM8_LEN_MOD, &out_slot, &out_param, &value) == 0);
+        assert(out_slot == slot);
+        assert(out_param == (tram8_mod_param_t)param);
+        assert(value == values[v]);
+      }
+    }
+  }
+
+  uint8_t buf[TRAM8_LEN_MOD];
+  uint8_t slot;
+  tram8_mod_param_t param;
+  uint16_t value;
+  tram8_pack_mod(buf, 0, TRAM8_MOD_RATE, 100);
+  buf[3] = TRAM8_MOD_PARAM_COUNT;
+  assert(tram8_parse_mod(buf, TRAM8_LEN_MOD, &slot, &param, &value) == -1);
+
+  printf("mod_roundtrip passed\n");
+}
+
+static void test_trigger_roundtrip(void) {
+  for (uint8_t gate = 0; gate < TRAM8_NUM_GATES; gate++) {
+    uint8_t buf[TRAM8_LEN_TRIGGER];
+    assert(tram8_pack_trigger(buf, gate, 10, 127) == TRAM8_LEN_TRIGGER);
+    uint8_t out_gate, pulse, gap;
+    assert(tram8_parse_trigger(buf, TRAM8_LEN_TRIGGER, &out_gate, &pulse, &gap) == 0);
+    assert(out_gate == gate);
+    assert(pulse == 10);
+    assert(gap == 127);
+  }
+
+  uint8_t buf[TRAM8_LEN_TRIGGER];
+  uint8_t gate, pulse, gap;
+  tram8_pack_trigger(buf, 3, 5, 2);
+  assert(tram8_parse_trigger(buf, TRAM8_LEN_TRIGGER - 1, &gate, &pulse, &gap) == -1);
+  buf[4] = 0x80;
+  assert(tram8_parse_trigger(buf, TRAM8_LEN_TRIGGER, &gate, &pulse, &gap) == -1);
+
+  printf("trigger_roundtrip passed\n");
+}
+
+static void test_clock_roundtrip(void) {
+  const uint8_t dividers[] = {TRAM8_CLOCK_OFF, 1, 24, TRAM8_CLOCK_DIV_MAX, TRAM8_CLOCK_RUN, TRAM8_CLOCK_RESET};
+  for (size_t i = 0; i < sizeof(dividers); i++) {
+    uint8_t buf[TRAM8_LEN_CLOCK];
+    assert(tram8_pack_clock(buf, 5, dividers[i], 66) == TRAM8_LEN_CLOCK);
+    uint8_t gate, divider, swing;
+    assert(tram8_parse_clock(buf, TRAM8_LEN_CLOCK, &gate, &divider, &swing) == 0);
+    assert(gate == 5);
+    assert(divider == dividers[i]);
+    assert(swing == 66);
+  }
+
+  uint8_t buf[TRAM8_LEN_CLOCK];
+  uint8_t gate, divider, swing;
+  tram8_pack_clock(buf, 0, TRAM8_CLOCK_DIV_MAX + 1, 0);
+  assert(tram8_parse_clock(buf, TRAM8_LEN_CLOCK, &gate, &divider, &swing) == -1);
+
+  printf("clock_roundtrip passed\n");
+}
+
+static void test_map_roundtrip(void) {
+  uint8_t buf[TRAM8_LEN_MAP];
+  uint8_t gate, channel, low, high;
+  assert(tram8_pack_map(buf, 6, 15, 36, 59) == TRAM8_LEN_MAP);
+  assert(tram8_parse_map(buf, TRAM8_LEN_MAP, &gate, &channel, &low, &high) == 0);
+  assert(gate == 6);
+  assert(channel == 15);
+  assert(low == 36);
+  assert(high == 59);
+
+  tram8_pack_map(buf, 0, TRAM8_MAP_OFF, 0, 0);
+  assert(tram8_parse_map(buf, TRAM8_LEN_MAP, &gate, &channel, &low, &high) == 0);
+  assert(channel == TRAM8_MAP_OFF);
+
+  tram8_pack_map(buf, 0, 16, 0, 0);
+  assert(tram8_parse_map(buf, TRAM8_LEN_MAP, &gate, &channel, &low, &high) == -1);
+  tram8_pack_map(buf, 0, 9, 61, 60);
+  assert(tram8_parse_map(buf, TRAM8_LEN_MAP, &gate, &channel, &low, &high) == -1);
+
+  printf("map_roundtrip passed\n");
+}
+
+static void test_stats_roundtrip(void) {
+  uint8_t query[TRAM8_LEN_STATS_QUERY];
+  assert(tram8_pack_stats_query(query) == TRAM8_LEN_STATS_QUERY);
+  assert(tram8_parse_stats_query(query, TRAM8_LEN_STATS_QUERY) == 0);
+  query[2] = TRAM8_CMD_STATS;
+  assert(tram8_parse_stats_query(query, TRAM8_LEN_STATS_QUERY) == -1);
+
+  uint16_t stats[TRAM8_STAT_COUNT];
+  for (int i = 0; i < TRAM8_STAT_COUNT; i++)
+    stats[i] = (uint16_t)(i * 7919 + (i == 0 ? 0xFFFF : 0));
+
+  uint8_t buf[TRAM8_LEN_STATS];
+  assert(tram8_pack_stats(buf, stats) == TRAM8_LEN_STATS);
+  for (int i = 1; i < TRAM8_LEN_STATS - 1; i++)
+    assert(buf[i] < 0x80);
+  assert(buf[TRAM8_LEN_STATS - 1] == TRAM8_SYSEX_END);
+
+  uint16_t out[TRAM8_STAT_COUNT];
+  assert(tram8_parse_stats(buf, TRAM8_LEN_STATS, out) == 0);
+  for (int i = 0; i < TRAM8_STAT_COUNT; i++)
+    assert(out[i] == stats[i]);
+
+  assert(tram8_parse_stats(buf, TRAM8_LEN_STATS - 1, out) == -1);
+  buf[5] = 0x04; // top byte carries only 2 bits
+  assert(tram8_parse_stats(buf, TRAM8_LEN_STATS, out) == -1);
+
+  printf("stats_roundtrip passed\n");
+}
+
+static void test_ping_roundtrip(void) {
+  const uint16_t seqs[] = {0, 1, 127, 128, TRAM8_PING_SEQ_MAX};
+  for (unsigned i = 0; i < sizeof(seqs) / sizeof(seqs[0]); i++) {
+    uint8_t ping[TRAM8_LEN_PING];
+    assert(tram8_pack_ping(ping, seqs[i]) == TRAM8_LEN_PING);
+    uint16_t seq;
+    assert(tram8_parse_ping(ping, TRAM8_LEN_PING, &seq) == 0);
+    assert(seq == seqs[i]);
+
+    uint8_t pong[TRAM8_LEN_PONG];
+    assert(tram8_pack_pong(pong, seqs[i], (uint16_t)(0xFFFF - i), (uint8_t)(i * 60)) == TRAM8_LEN_PONG);
+    for (int j = 1; j < TRAM8_LEN_PONG - 1; j++)
+      assert(pong[j] < 0x80);
+    uint16_t ticks;
+    uint8_t dwell;
+    assert(tram8_parse_pong(pong, TRAM8_LEN_PONG, &seq, &ticks, &dwell) == 0);
+    assert(seq == seqs[i]);
+    assert(ticks == 0xFFFF - i);
+    assert(dwell == (i * 60 > TRAM8_PONG_DWELL_MAX ? TRAM8_PONG_DWELL_MAX : i * 60));
+  }
+
+  uint8_t buf[TRAM8_LEN_PONG];
+  uint16_t seq, ticks;
+  uint8_t dwell;
+  tram8_pack_ping(buf, 5);
+  assert(tram8_parse_ping(buf, TRAM8_LEN_PING - 1, &seq) == -1);
+  buf[2] = TRAM8_CMD_PONG;
+  assert(tram8_parse_ping(buf, TRAM8_LEN_PING, &seq) == -1);
+  tram8_pack_pong(buf, 5, 1000, 2);
+  assert(tram8_parse_pong(buf, TRAM8_LEN_PING, &seq, &ticks, &dwell) == -1);
+  buf[7] = 0x04; // top tick byte carries only 2 bits
+  assert(tram8_parse_pong(buf, TRAM8_LEN_PONG, &seq, &ticks, &dwell) == -1);
+
+  printf("ping_roundtrip passed\n");
+}
+
 int main(void) {
   printf("Running SysEx protocol tests...\n");
 
@@ -246,6 +676,22 @@ int main(void) {
   test_parse_rejects_short();
   test_parse_rejects_bad_header();
   test_message_framing();
+  test_delta_single_channel();
+  test_delta_roundtrip_all_masks();
+  test_delta_shorter_than_full();
+  test_delta_rejects_bad_length();
+  test_dac_mask_per_form();
+  test_bend_roundtrip();
+  test_cal_roundtrip();
+  test_pitch_to_dac();
+  test_scheduled_roundtrip();
+  test_ramp_roundtrip();
+  test_mod_roundtrip();
+  test_trigger_roundtrip();
+  test_clock_roundtrip();
+  test_map_roundtrip();
+  test_stats_roundtrip();
+  test_ping_roundtrip();
 
   printf("\nAll SysEx protocol tests passed!\n");
   return 0;
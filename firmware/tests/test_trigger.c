@@ -0,0 +1,194 @@
+#include "../src/eeprom_queue.h"
+#include "../src/trigger.h"
+#include <assert.h>
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <stdio.h>
+#include <string.h>
+
+// Gate outputs are captured instead of driving ports. Same claim rules as
+// gpio.c: the normal gate path leaves claimed gates alone.
+static uint8_t gates;
+static uint8_t claimed;
+
+void gate_set_mask(uint8_t mask) {
+  gates = (uint8_t)((gates & claimed) | (mask & ~claimed));
+}
+
+void gate_claim(uint8_t mask) {
+  claimed = mask;
+}
+
+void gate_set_claimed(uint8_t bits, uint8_t mask) {
+  bits &= claimed;
+  gates = (uint8_t)((gates & ~bits) | (mask & bits));
+}
+
+uint8_t gate_get_mask(void) {
+  return gates;
+}
+
+static void reset(void) {
+  memset(mock_eeprom, 0xFF, sizeof(mock_eeprom));
+  EECR = 0;
+  eeprom_queue_init();
+  gates = 0;
+  claimed = 0;
+  trigger_init();
+}
+
+static void run_ms(int n) {
+  for (int i = 0; i < n; i++)
+    trigger_tick();
+}
+
+static void fire(uint8_t bits) {
+  trigger_queue(bits);
+  trigger_fire_pending();
+}
+
+static void test_erased_eeprom_is_gate_mode(void) {
+  reset();
+  assert(trigger_gates() == 0);
+  assert(claimed == 0);
+
+  fire(0xFF);
+  assert(gates == 0);
+  gate_set_mask(0x81);
+  assert(gates == 0x81);
+
+  printf("erased_eeprom_is_gate_mode passed\n");
+}
+
+static void test_pulse_ends_on_timer(void) {
+  reset();
+  trigger_config(2, 5, 0);
+  assert(trigger_gates() == 0x04);
+  assert(claimed == 0x04);
+
+  fire(0x04);
+  assert(gates == 0x04);
+  run_ms(4);
+  assert(gates == 0x04);
+  run_ms(1);
+  assert(gates == 0x00);
+  run_ms(10);
+  assert(gates == 0x00);
+
+  printf("pulse_ends_on_timer passed\n");
+}
+
+static void test_claimed_gate_ignores_gate_path(void) {
+  reset();
+  trigger_config(0, 3, 0);
+
+  // note-off or a frame dropping the bit does not cut the pulse short
+  fire(0x01);
+  gate_set_mask(0x02);
+  assert(gates == 0x03);
+  run_ms(3);
+  assert(gates == 0x02);
+
+  // nor does a frame raising it start one
+  gate_set_mask(0x03);
+  assert(gates == 0x02);
+
+  printf("claimed_gate_ignores_gate_path passed\n");
+}
+
+static void test_fire_now_skips_gate_mode(void) {
+  reset();
+  trigger_config(1, 4, 0);
+
+  // the ISR path for scheduled frames: trigger gates only, nothing queued
+  trigger_fire(0x03);
+  assert(gates == 0x02);
+  run_ms(4);
+  assert(gates == 0x00);
+  trigger_fire_pending();
+  assert(gates == 0x00);
+
+  printf("fire_now_skips_gate_mode passed\n");
+}
+
+static void test_legato_retrigger_gap(void) {
+  reset();
+  trigger_config(1, 10, 2);
+
+  fire(0x02);
+  run_ms(4);
+  assert(gates == 0x02);
+
+  // retriggered while high: low for the gap, then a full pulse
+  fire(0x02);
+  assert(gates == 0x00);
+  run_ms(1);
+  assert(gates == 0x00);
+  run_ms(1);
+  assert(gates == 0x02);
+  run_ms(9);
+  assert(gates == 0x02);
+  run_ms(1);
+  assert(gates == 0x00);
+
+  // without a gap the pulse just restarts
+  trigger_config(1, 10, 0);
+  fire(0x02);
+  run_ms(6);
+  fire(0x02);
+  assert(gates == 0x02);
+  run_ms(9);
+  assert(gates == 0x02);
+  run_ms(1);
+  assert(gates == 0x00);
+
+  printf("legato_retrigger_gap passed\n");
+}
+
+static void test_config_persists(void) {
+  reset();
+  trigger_config(7, 20, 3);
+  assert(eeprom_queue_read(EEPROM_TRIG_PULSE_ADDR + 7) == 20);
+  assert(eeprom_queue_read(EEPROM_TRIG_GAP_ADDR + 7) == 3);
+
+  // zero width hands the gate back
+  trigger_config(7, 0, 0);
+  assert(trigger_gates() == 0);
+  assert(claimed == 0);
+
+  printf("config_persists passed\n");
+}
+
+static void test_reset_drops_pulses(void) {
+  reset();
+  trigger_config(3, 50, 0);
+  trigger_config(4, 50, 0);
+
+  fire(0x18);
+  trigger_queue(0x08);
+  trigger_reset();
+  assert(gates == 0x00);
+  run_ms(60);
+  assert(gates == 0x00);
+
+  // nothing queued survives the reset
+  trigger_fire_pending();
+  assert(gates == 0x00);
+
+  printf("reset_drops_pulses passed\n");
+}
+
+int main(void) {
+  printf("Running trigger tests...\n");
+
+  test_erased_eeprom_is_gate_mode();
+  test_pulse_ends_on_timer();
+  test_claimed_gate_ignores_gate_path();
+  test_fire_now_skips_gate_mode();
+  test_legato_retrigger_gap();
+  test_config_persists();
+  test_reset_drops_pulses();
+
+  printf("All trigger tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,250 @@
+#include "../src/max5825_control.h"
+#include "../src/twi_control.h"
+#include "mock/mock_twi_bus.h"
+#include <assert.h>
+#include <stdio.h>
+
+static void bus_reset(void) {
+  max5825_init(); // shadow back to a known zero
+  mock_twi_run();
+  mock_twi_reset();
+}
+
+// Clears the log but keeps the driver's shadow
+static void bus_reset_log(void) {
+  bus_len = 0;
+}
+
+static void run_bus(void) {
+  mock_twi_run();
+}
+
+// One channel's CODEn write, queued as its own transaction
+static void write_one(uint8_t channel, uint16_t value) {
+  uint16_t values[8] = {0};
+  values[channel] = value;
+  max5825_write_codes_async(values, (uint8_t)(1 << channel));
+}
+
+static int count(int token) {
+  int n = 0;
+  for (int i = 0; i < bus_len; i++)
+    n += bus[i] == token;
+  return n;
+}
+
+static void test_single_write(void) {
+  bus_reset();
+  write_one(3, 0xABC);
+
+  // queued and started, but nothing has been clocked out yet
+  assert(twi_async_busy());
+  assert(bus_len == 0);
+
+  run_bus();
+  const int expected[] = {BUS_START, MAX5825_ADDR, MAX5825_REG_CODEn | 3, 0xAB, 0xC0, BUS_STOP};
+  assert(bus_len == 6);
+  for (int i = 0; i < 6; i++)
+    assert(bus[i] == expected[i]);
+  assert(!twi_async_busy());
+
+  printf("single_write passed\n");
+}
+
+static void test_queue_chains_repeated_start(void) {
+  bus_reset();
+  for (uint8_t ch = 0; ch < 8; ch++)
+    write_one(ch, (uint16_t)(ch * 100 + 1));
+  assert(bus_len == 0);
+
+  run_bus();
+  assert(count(BUS_START) == 8);
+  assert(count(BUS_STOP) == 1);
+  assert(bus_len == 8 * 5 + 1);
+  for (uint8_t ch = 0; ch < 8; ch++) {
+    const int* t = &bus[ch * 5];
+    assert(t[0] == BUS_START);
+    assert(t[1] == MAX5825_ADDR);
+    assert(t[2] == (MAX5825_REG_CODEn | ch));
+    uint16_t value = (uint16_t)((t[3] << 4) | (t[4] >> 4));
+    assert(value == ch * 100 + 1);
+  }
+  assert(!twi_async_busy());
+
+  printf("queue_chains_repeated_start passed\n");
+}
+
+static void test_enqueue_while_transferring(void) {
+  bus_reset();
+  write_one(0, 1);
+  write_one(1, 2);
+
+  // main loop keeps queuing while the ISR is mid-transaction
+  for (int i = 0; i < 3; i++)
+    mock_twi_step();
+  assert(twi_async_busy());
+  write_one(2, 3);
+
+  run_bus();
+  assert(count(BUS_START) == 3);
+  assert(count(BUS_STOP) == 1);
+  assert(bus[12] == (MAX5825_REG_CODEn | 2));
+  assert(!twi_async_busy());
+
+  printf("enqueue_while_transferring passed\n");
+}
+
+static void test_nack_drops_transaction(void) {
+  bus_reset();
+  nack_addr = 0x40;
+  const uint8_t data[2] = {0x11, 0x22};
+  twi_async_write(0x40, data, 2);
+  write_one(5, 0x123);
+
+  run_bus();
+  const int expected[] = {
+      BUS_START, 0x40, BUS_STOP, BUS_START, MAX5825_ADDR, MAX5825_REG_CODEn | 5, 0x12, 0x30, BUS_STOP};
+  assert(bus_len == 9);
+  for (int i = 0; i < 9; i++)
+    assert(bus[i] == expected[i]);
+  assert(!twi_async_busy());
+
+  printf("nack_drops_transaction passed\n");
+}
+
+static void test_queue_capacity(void) {
+  // 5 bytes per single-channel write
+  const int fits = (TWI_QUEUE_SIZE - 1) / 5;
+  bus_reset();
+  for (int i = 0; i < fits; i++)
+    write_one((uint8_t)(i & 7), (uint16_t)(i + 1));
+  assert(bus_len == 0);
+
+  run_bus();
+  assert(count(BUS_START) == fits);
+  assert(!twi_async_busy());
+
+  printf("queue_capacity passed\n");
+}
+
+static void test_codes_single_transaction(void) {
+  bus_reset();
+  uint16_t values[8];
+  for (uint8_t ch = 0; ch < 8; ch++)
+    values[ch] = (uint16_t)(0x111 * ch + 1);
+
+  max5825_write_codes_async(values, 0xFF);
+  run_bus();
+
+  assert(count(BUS_START) == 1);
+  assert(count(BUS_STOP) == 1);
+  assert(bus_len == 2 + 1 + 8 * 3);
+  assert(bus[1] == MAX5825_ADDR);
+  for (uint8_t ch = 0; ch < 8; ch++) {
+    const int* t = &bus[2 + ch * 3];
+    assert(t[0] == (MAX5825_REG_CODEn | ch));
+    assert((uint16_t)((t[1] << 4) | (t[2] >> 4)) == values[ch]);
+  }
+
+  bus_reset();
+  max5825_write_codes_async(values, 0x24);
+  run_bus();
+  assert(bus_len == 2 + 1 + 2 * 3);
+  assert(bus[2] == (MAX5825_REG_CODEn | 2));
+  assert(bus[5] == (MAX5825_REG_CODEn | 5));
+
+  printf("codes_single_transaction passed\n");
+}
+
+static void test_shadow_skips_unchanged(void) {
+  bus_reset();
+  uint16_t values[8];
+  for (uint8_t ch = 0; ch < 8; ch++)
+    values[ch] = (uint16_t)(0x100 + ch);
+  assert(max5825_write_codes_async(values, 0xFF) == 0xFF);
+  run_bus();
+
+  // only the changed channel goes out
+  uint16_t before = max5825_skipped_writes();
+  bus_reset_log();
+  values[6] = 0x7FF;
+  assert(max5825_dirty_mask(values, 0xFF) == 0x40);
+  assert(max5825_write_codes_async(values, 0xFF) == 0x40);
+  run_bus();
+  assert(bus_len == 2 + 3 + 1);
+  assert(bus[2] == (MAX5825_REG_CODEn | 6));
+  assert(max5825_skipped_writes() == before + 7);
+
+  // nothing changed: no transaction at all
+  bus_reset_log();
+  assert(max5825_write_codes_async(values, 0xFF) == 0);
+  assert(!twi_async_busy());
+  assert(bus_len == 0);
+  assert(max5825_skipped_writes() == before + 7 + 8);
+
+  // staged and blocking writes share the shadow
+  max5825_stage(2, 0x555);
+  assert(max5825_service() == 0x04);
+  run_bus();
+  assert(bus_len == 2 + 3 + 1);
+  assert(max5825_dirty_mask(values, 0xFF) == 0x04);
+  max5825_write(3, 0x103);
+  assert(max5825_dirty_mask(values, 0xFF) == 0x04);
+
+  printf("shadow_skips_unchanged passed\n");
+}
+
+static void test_staged_writes_coalesce(void) {
+  bus_reset();
+  uint16_t before = max5825_coalesced_writes();
+
+  // staged values wait for the service call
+  max5825_stage(1, 0x100);
+  max5825_stage(2, 0x200);
+  assert(max5825_busy());
+  assert(!twi_async_busy());
+  assert(max5825_service() == 0x06);
+  assert(twi_async_busy());
+
+  // while the bus is busy, newer values replace older ones
+  for (uint16_t v = 1; v <= 10; v++)
+    max5825_stage(1, (uint16_t)(0x100 + v));
+  max5825_stage(3, 0x300);
+  assert(max5825_service() == 0);
+  assert(max5825_coalesced_writes() == before + 9);
+
+  run_bus();
+  assert(max5825_service() == 0x0A);
+  run_bus();
+  assert(!max5825_busy());
+
+  // two transactions: the first batch and only the newest value of channel 1
+  assert(count(BUS_START) == 2);
+  assert(bus_len == 2 * (2 + 2 * 3 + 1));
+  const int* t = &bus[(2 + 2 * 3 + 1) + 2];
+  assert(t[0] == (MAX5825_REG_CODEn | 1));
+  assert((uint16_t)((t[1] << 4) | (t[2] >> 4)) == 0x10A);
+
+  // a blocking write supersedes a staged value
+  max5825_stage(4, 0x444);
+  max5825_write(4, 0);
+  assert(!max5825_busy());
+
+  printf("staged_writes_coalesce passed\n");
+}
+
+int main(void) {
+  printf("Running TWI queue tests...\n");
+
+  test_single_write();
+  test_queue_chains_repeated_start();
+  test_enqueue_while_transferring();
+  test_nack_drops_transaction();
+  test_queue_capacity();
+  test_codes_single_transaction();
+  test_shadow_skips_unchanged();
+  test_staged_writes_coalesce();
+
+  printf("All TWI queue tests passed!\n");
+  return 0;
+}
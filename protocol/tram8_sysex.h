@@ -10,9 +10,24 @@ extern "C" {
 /*
  * tram8+ SysEx protocol
  *
- * Header: F0 7D 10
+ * Header: F0 7D <cmd>
  *   7D = non-commercial/educational manufacturer ID
- *   10 = state update command
+ *   10 = state update command (Forms 1-3)
+ *   11 = delta state update command
+ *   12 = pitch calibration upload
+ *   13 = scheduled delta state update
+ *   14 = DAC ramp
+ *   15 = modulator parameter
+ *   16 = trigger mode
+ *   17 = clock output
+ *   18 = statistics query
+ *   19 = statistics reply (device to host)
+ *   1A = latency ping
+ *   1B = latency pong (device to host)
+ *   1C = gate note mapping
+ *
+ * 13-17 are firmware build options, off by default (see hardware_config.h);
+ * a unit built without one ignores its frames.
  *
  * All data bytes are 7-bit (0x00-0x7F) per MIDI spec.
  * DAC values are 12-bit (0-4095) on the wire.
@@ -42,12 +57,132 @@ extern "C" {
  *   F0 7D 10 GL GH D0..D7 L0 L1 L2 L3 L4 L5 F7
  *   Low 5 bits packed LSB-first: 8x5 = 40 bits -> ceil(40/7) = 6 bytes
  *   dac[i] = (dac_hi[i] << 5) | low5[i]
+ *
+ * Delta form: gates + full 12-bit DAC for changed channels only
+ *   F0 7D 11 GL GH ML MH [Dh Dl]... F7
+ *   ML/MH = changed-channel mask, split like the gate mask
+ *   One Dh Dl pair per set mask bit, in ascending channel order
+ *   dac[i] = (Dh << 5) | (Dl & 0x1F)
+ *   Length is 8 + 2 * popcount(mask): 10 bytes for one channel, 24 for all 8.
+ *   Channels not in the mask keep their previous value.
+ *
+ * Scheduled form: a delta frame applied on a later 1 ms timer tick
+ *   F0 7D 13 TL TH GL GH ML MH [Dh Dl]... F7
+ *   ticks = TL | TH << 7 (0-16383 ms) after the previous scheduled frame's
+ *   due time, or after arrival if the schedule has run dry. Spacing between
+ *   queued frames is therefore exact however late their bytes arrive, as
+ *   long as the host sends them ahead of time. Up to 4 frames wait at once;
+ *   one that arrives with the queue full is dropped as a parse error.
+ *   Gates are absolute (like every state form); DACs follow the delta mask.
+ *   The DACs load on the due tick; gates the frame raises follow one tick
+ *   later, once the CV has settled. Falling gates drop with the load.
+ *   Length is 10 + 2 * popcount(mask).
+ *
+ * Ramp: the firmware slides one DAC to a target, updating it every 1 ms
+ *   F0 7D 14 CC Dh Dl TL TH F7   (9 bytes)
+ *   CC = channel | curve << 3; Dh Dl = 12-bit target as in the delta form
+ *   duration = TL | TH << 7 (0-16383 ms); 0 jumps straight to the target
+ *   Curves: 0 linear, 1 ease-in, 2 ease-out, 3 S-curve
+ *   Any other write to the channel cancels its ramp.
+ *
+ * Modulator parameter: sets one parameter of one of the firmware's LFO /
+ * envelope generators, which run from the 1 kHz tick
+ *   F0 7D 15 SP VL VH F7   (7 bytes)
+ *   SP = param | slot << 4 (4 slots); value = VL | VH << 7 (14-bit)
+ *   Params:
+ *     0 DEST     DAC channel driven (0-7)
+ *     1 TYPE     0 off, 1 triangle, 2 saw, 3 square, 4 sample & hold, 5 AD, 6 ADSR
+ *     2 RATE     LFO rate in 0.01 Hz
+ *     3 DEPTH    LFO peak-to-peak / envelope peak, in DAC codes
+ *     4 OFFSET   LFO centre / envelope floor, in DAC codes
+ *     5 ATTACK   ms
+ *     6 DECAY    ms
+ *     7 SUSTAIN  fraction of DEPTH, 0-4095
+ *     8 RELEASE  ms
+ *     9 TRIGGER  gate whose rising edge restarts the LFO / fires the envelope
+ *                (0-7); the envelope releases on its falling edge. 127 = none.
+ *   A generator that is not off owns its DAC: state frames, bends, ramps and
+ *   scheduled frames, queued ones included, leave that channel alone.
+ *
+ * Trigger mode: per-gate pulse width, stored in EEPROM
+ *   F0 7D 16 GT PW GP F7   (7 bytes)
+ *   GT = gate 0-7; PW = pulse width in ms (0 = normal gate mode);
+ *   GP = low gap in ms inserted when the gate is retriggered while high
+ *   A trigger gate fires on note-on (or a rising bit in a state frame) and
+ *   the firmware ends the pulse itself; note-offs and clear bits are ignored.
+ *
+ * Clock output: per-gate role driven by MIDI real-time bytes, stored in EEPROM
+ *   F0 7D 17 GT DV SW F7   (7 bytes)
+ *   GT = gate 0-7
+ *   DV = 0 off, 1-96 pulse every DV clocks of 24 PPQN (24 = quarter note),
+ *        126 run (high between start/continue and stop), 127 reset (pulse on start)
+ *   SW = swing in percent, 50-75 (0 or 50 = straight): every second pulse
+ *        is delayed so it lands at SW% of the pair
+ *   Start (FA) restarts the count so the next clock fires every divider.
+ *   Pulses last the gate's trigger width, or 5 ms if it has none.
+ *
+ * Statistics: device counters for profiling units under load
+ *   query: F0 7D 18 F7                    (4 bytes, any mode)
+ *   reply: F0 7D 19 [S0 S1 S2]... F7      (4 + 3 * TRAM8_STAT_COUNT bytes)
+ *   One 16-bit value per tram8_stat_t, 7 bits per byte LSB-first. Counters
+ *   wrap, so take differences between replies; the peaks (ring occupancy,
+ *   loop time) restart from zero after each reply.
+ *   The ATmega8A's TX pin is gate 1 (PD1): while the reply is sent the UART
+ *   drives that jack, and the gate comes back once the last byte is out.
+ *
+ * Latency probe: round trip from the host through the frame path
+ *   ping: F0 7D 1A S0 S1 F7                  (6 bytes, any mode)
+ *   pong: F0 7D 1B S0 S1 T0 T1 T2 DW F7      (10 bytes, device to host)
+ *   seq = S0 | S1 << 7 (14-bit), echoed unchanged
+ *   T  = the firmware's free-running 1 ms tick when the ping was handled,
+ *        16-bit packed like the stats values
+ *   DW = ms from then until the pong started (0-127, clamped)
+ *   The pong waits until every DAC write and gate change received ahead of
+ *   the ping has been loaded, so the round trip covers the outputs moving.
+ *   It leaves on gate 1 like the stats reply, one reply at a time.
+ *
+ * Gate mapping: channel and note range a gate follows in velocity and CC
+ * modes, stored in EEPROM
+ *   F0 7D 1C GT CH LO HI F7   (8 bytes, any mode)
+ *   GT = gate 0-7; CH = MIDI channel 0-15, or 127 to unmap the gate
+ *   LO-HI = notes that drive the gate, LO <= HI (LO = HI for one note)
+ *   Gates may overlap or use different channels, so a unit can follow
+ *   a drum and a bass channel at once or split a keyboard. In CC mode
+ *   CC 69+n on gate n's channel sets CV n.
+ *
+ * Channel voice messages (SysEx mode accepts these interleaved with frames):
+ *
+ *   Gate:  90 <gate> <vel>   vel > 0 raises gate 0-7, vel 0 (or 80 <gate> xx) drops it
+ *   DAC:   En <lsb> <msb>    pitch bend on channel n sets DAC n
+ *          dac = bend >> 2   (bend = lsb | msb << 7, 14-bit)
+ *
+ * The firmware accepts running status (SysEx frames cancel it), but hosts
+ * sending through CoreMIDI must give every message its status byte.
+ *
+ * Calibration: per-channel 1 V/oct trim for the firmware's pitch mode
+ *   F0 7D 12 CH O0 O1 O2 G0 G1 G2 F7   (11 bytes)
+ *   offset: signed 16-bit DAC codes at note 0, 7 bits per byte LSB-first
+ *   gain:   DAC codes per semitone in 1/256ths, packed the same way
+ *   dac = clamp(offset + note * gain / 256, 0, 4095)
+ *   The default gain puts note 60 at full scale (1 V/oct over 0-5 V).
  */
 
 #define TRAM8_SYSEX_START 0xF0
 #define TRAM8_SYSEX_END 0xF7
 #define TRAM8_MANUFACTURER_ID 0x7D
 #define TRAM8_CMD_STATE 0x10
+#define TRAM8_CMD_DELTA 0x11
+#define TRAM8_CMD_CAL 0x12
+#define TRAM8_CMD_SCHEDULED 0x13
+#define TRAM8_CMD_RAMP 0x14
+#define TRAM8_CMD_MOD 0x15
+#define TRAM8_CMD_TRIGGER 0x16
+#define TRAM8_CMD_CLOCK 0x17
+#define TRAM8_CMD_STATS_QUERY 0x18
+#define TRAM8_CMD_STATS 0x19
+#define TRAM8_CMD_PING 0x1A
+#define TRAM8_CMD_PONG 0x1B
+#define TRAM8_CMD_MAP 0x1C
 
 #define TRAM8_NUM_GATES 8
 #define TRAM8_DAC_BITS 12
@@ -56,9 +191,100 @@ extern "C" {
 #define TRAM8_LEN_GATES 6
 #define TRAM8_LEN_COARSE 14
 #define TRAM8_LEN_FULL 20
+#define TRAM8_LEN_DELTA_BASE 8
+#define TRAM8_LEN_SCHED_BASE 10
+#define TRAM8_LEN_MAX (TRAM8_LEN_SCHED_BASE + 2 * TRAM8_NUM_GATES)
 #define TRAM8_HEADER_LEN 3
+#define TRAM8_LEN_CAL 11
+#define TRAM8_LEN_RAMP 9
+#define TRAM8_LEN_MOD 7
+#define TRAM8_LEN_TRIGGER 7
+#define TRAM8_LEN_CLOCK 7
+#define TRAM8_LEN_STATS_QUERY 4
+#define TRAM8_LEN_STATS (4 + 3 * TRAM8_STAT_COUNT)
+#define TRAM8_LEN_PING 6
+#define TRAM8_LEN_PONG 10
+#define TRAM8_LEN_MAP 8
+
+#define TRAM8_PING_SEQ_MAX 0x3FFF
+#define TRAM8_PONG_DWELL_MAX 127
+#define TRAM8_BAUD 31250
+#define TRAM8_BYTE_US 320 // 10 bits per byte at TRAM8_BAUD
+
+#define TRAM8_MOD_SLOTS 4
+#define TRAM8_MOD_TRIGGER_NONE 127
+
+#define TRAM8_CLOCK_OFF 0
+#define TRAM8_CLOCK_DIV_MAX 96
+#define TRAM8_CLOCK_RUN 126
+#define TRAM8_CLOCK_RESET 127
+#define TRAM8_CLOCK_SWING_MAX 75
+
+#define TRAM8_MAP_OFF 127
+
+#define TRAM8_CAL_OFFSET_DEFAULT 0
+#define TRAM8_CAL_GAIN_DEFAULT 17472 // 4095 * 256 / 60
+
+#define TRAM8_CV_NOTE_OFF 0x80
+#define TRAM8_CV_NOTE_ON 0x90
+#define TRAM8_CV_BEND 0xE0
+#define TRAM8_CV_GATE_CHANNEL 0
+#define TRAM8_CV_GATE_ON_VELOCITY 0x7F
+
+typedef enum { TRAM8_CURVE_LINEAR, TRAM8_CURVE_EASE_IN, TRAM8_CURVE_EASE_OUT, TRAM8_CURVE_S } tram8_curve_t;
+
+typedef enum {
+  TRAM8_MOD_DEST,
+  TRAM8_MOD_TYPE,
+  TRAM8_MOD_RATE,
+  TRAM8_MOD_DEPTH,
+  TRAM8_MOD_OFFSET,
+  TRAM8_MOD_ATTACK,
+  TRAM8_MOD_DECAY,
+  TRAM8_MOD_SUSTAIN,
+  TRAM8_MOD_RELEASE,
+  TRAM8_MOD_TRIGGER,
+  TRAM8_MOD_PARAM_COUNT
+} tram8_mod_param_t;
+
+typedef enum {
+  TRAM8_MOD_OFF,
+  TRAM8_MOD_TRI,
+  TRAM8_MOD_SAW,
+  TRAM8_MOD_SQUARE,
+  TRAM8_MOD_SAMPLE_HOLD,
+  TRAM8_MOD_AD,
+  TRAM8_MOD_ADSR,
+  TRAM8_MOD_TYPE_COUNT
+} tram8_mod_type_t;
 
-typedef enum { TRAM8_FORM_GATES, TRAM8_FORM_COARSE, TRAM8_FORM_FULL } tram8_form_t;
+typedef enum {
+  TRAM8_STAT_RX_BYTES, // bytes received on the UART
+  TRAM8_STAT_FRAMES, // state and control frames applied
+  TRAM8_STAT_PARSE_ERRORS, // frames aborted or rejected
+  TRAM8_STAT_OVERFLOWS, // bytes dropped on a full receive ring
+  TRAM8_STAT_RB_PEAK, // highest receive ring occupancy, bytes
+  TRAM8_STAT_LOOP_MAX, // longest main loop iteration, 1 ms timer ticks
+  TRAM8_STAT_DAC_SKIPPED, // DAC writes skipped as unchanged
+  TRAM8_STAT_DAC_COALESCED, // staged DAC values replaced before they went out
+  TRAM8_STAT_SCHED_LATE, // scheduled frames fired after their tick
+  TRAM8_STAT_COUNT
+} tram8_stat_t;
+
+typedef enum { TRAM8_FORM_GATES, TRAM8_FORM_COARSE, TRAM8_FORM_FULL, TRAM8_FORM_DELTA } tram8_form_t;
+
+static inline uint8_t tram8_popcount(uint8_t mask) {
+  uint8_t n = 0;
+  while (mask) {
+    mask &= (uint8_t)(mask - 1);
+    n++;
+  }
+  return n;
+}
+
+static inline uint8_t tram8_delta_len(uint8_t dac_mask) {
+  return (uint8_t)(TRAM8_LEN_DELTA_BASE + 2 * tram8_popcount(dac_mask));
+}
 
 static inline uint8_t tram8_pack(uint8_t* buf, uint8_t gate_mask, const uint16_t dac[8], tram8_form_t form) {
   buf[0] = TRAM8_SYSEX_START;
@@ -100,20 +326,432 @@ static inline uint8_t tram8_pack(uint8_t* buf, uint8_t gate_mask, const uint16_t
   return pos + 1;
 }
 
-static inline int
-tram8_parse(const uint8_t* buf, uint8_t len, uint8_t* gate_mask, uint16_t dac[8], tram8_form_t* form) {
+// Delta body shared by the delta and scheduled forms: GL GH ML MH [Dh Dl]...
+static inline uint8_t tram8_pack_delta_body(uint8_t* p, uint8_t gate_mask, const uint16_t dac[8], uint8_t dac_mask) {
+  p[0] = gate_mask & 0x7F;
+  p[1] = (gate_mask >> 7) & 0x01;
+  p[2] = dac_mask & 0x7F;
+  p[3] = (dac_mask >> 7) & 0x01;
+
+  uint8_t pos = 4;
+  for (int i = 0; i < 8; i++) {
+    if (!((dac_mask >> i) & 1))
+      continue;
+    p[pos++] = (uint8_t)((dac[i] >> 5) & 0x7F);
+    p[pos++] = (uint8_t)(dac[i] & 0x1F);
+  }
+  return pos;
+}
+
+// n is the body length (up to, not including, F7)
+static inline int tram8_unpack_delta_body(const uint8_t* p,
+                                          uint8_t n,
+                                          uint8_t* gate_mask,
+                                          uint16_t dac[8],
+                                          uint8_t* dac_mask) {
+  if (n < 4)
+    return -1;
+  uint8_t mask = (p[2] & 0x7F) | ((p[3] & 0x01) << 7);
+  if (n != 4 + 2 * tram8_popcount(mask))
+    return -1;
+
+  *gate_mask = (p[0] & 0x7F) | ((p[1] & 0x01) << 7);
+  uint8_t pos = 4;
+  for (int i = 0; i < 8; i++) {
+    if (!((mask >> i) & 1))
+      continue;
+    dac[i] = (uint16_t)((p[pos] & 0x7F) << 5) | (p[pos + 1] & 0x1F);
+    pos += 2;
+  }
+  *dac_mask = mask;
+  return 0;
+}
+
+static inline uint8_t tram8_pack_delta(uint8_t* buf, uint8_t gate_mask, const uint16_t dac[8], uint8_t dac_mask) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_DELTA;
+  uint8_t pos = 3 + tram8_pack_delta_body(&buf[3], gate_mask, dac, dac_mask);
+  buf[pos] = TRAM8_SYSEX_END;
+  return pos + 1;
+}
+
+static inline uint8_t tram8_sched_len(uint8_t dac_mask) {
+  return TRAM8_LEN_SCHED_BASE + 2 * tram8_popcount(dac_mask);
+}
+
+// ticks is the delay in ms after the previous scheduled frame (0-16383)
+static inline uint8_t tram8_pack_scheduled(uint8_t* buf,
+                                           uint16_t ticks,
+                                           uint8_t gate_mask,
+                                           const uint16_t dac[8],
+                                           uint8_t dac_mask) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_SCHEDULED;
+  buf[3] = ticks & 0x7F;
+  buf[4] = (ticks >> 7) & 0x7F;
+  uint8_t pos = 5 + tram8_pack_delta_body(&buf[5], gate_mask, dac, dac_mask);
+  buf[pos] = TRAM8_SYSEX_END;
+  return pos + 1;
+}
+
+static inline int tram8_parse_scheduled(const uint8_t* buf,
+                                        uint8_t len,
+                                        uint16_t* ticks,
+                                        uint8_t* gate_mask,
+                                        uint16_t dac[8],
+                                        uint8_t* dac_mask) {
+  if (len < TRAM8_LEN_SCHED_BASE || len > TRAM8_LEN_MAX)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_SCHEDULED)
+    return -1;
+  if (buf[len - 1] != TRAM8_SYSEX_END)
+    return -1;
+  if (tram8_unpack_delta_body(&buf[5], (uint8_t)(len - 6), gate_mask, dac, dac_mask) != 0)
+    return -1;
+  *ticks = (uint16_t)((buf[3] & 0x7F) | ((uint16_t)(buf[4] & 0x7F) << 7));
+  return 0;
+}
+
+static inline void tram8_dac_to_bend(uint16_t dac, uint8_t* lsb, uint8_t* msb) {
+  *lsb = (uint8_t)((dac << 2) & 0x7F);
+  *msb = (uint8_t)((dac >> 5) & 0x7F);
+}
+
+static inline uint16_t tram8_bend_to_dac(uint8_t lsb, uint8_t msb) {
+  return (uint16_t)((((uint16_t)(msb & 0x7F) << 7) | (lsb & 0x7F)) >> 2);
+}
+
+static inline uint16_t tram8_pitch_to_dac(uint8_t note, int16_t offset, uint16_t gain) {
+  int32_t code = offset + (int32_t)(((uint32_t)note * gain + 128) >> 8);
+  if (code < 0)
+    return 0;
+  if (code > TRAM8_DAC_MAX)
+    return TRAM8_DAC_MAX;
+  return (uint16_t)code;
+}
+
+static inline uint8_t tram8_pack_cal(uint8_t* buf, uint8_t channel, int16_t offset, uint16_t gain) {
+  uint16_t off = (uint16_t)offset;
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_CAL;
+  buf[3] = channel & 0x07;
+  buf[4] = off & 0x7F;
+  buf[5] = (off >> 7) & 0x7F;
+  buf[6] = (off >> 14) & 0x03;
+  buf[7] = gain & 0x7F;
+  buf[8] = (gain >> 7) & 0x7F;
+  buf[9] = (gain >> 14) & 0x03;
+  buf[10] = TRAM8_SYSEX_END;
+  return TRAM8_LEN_CAL;
+}
+
+static inline int tram8_parse_cal(const uint8_t* buf, uint8_t len, uint8_t* channel, int16_t* offset, uint16_t* gain) {
+  if (len != TRAM8_LEN_CAL)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_CAL)
+    return -1;
+  if (buf[10] != TRAM8_SYSEX_END || buf[3] >= TRAM8_NUM_GATES)
+    return -1;
+  for (int i = 3; i < 10; i++) {
+    if (buf[i] & 0x80)
+      return -1;
+  }
+
+  *channel = buf[3];
+  *offset = (int16_t)(buf[4] | ((uint16_t)buf[5] << 7) | ((uint16_t)buf[6] << 14));
+  *gain = (uint16_t)(buf[7] | ((uint16_t)buf[8] << 7) | ((uint16_t)buf[9] << 14));
+  return 0;
+}
+
+static inline uint8_t tram8_pack_ramp(uint8_t* buf, uint8_t channel, uint16_t target, uint16_t duration_ms, tram8_curve_t curve) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_RAMP;
+  buf[3] = (uint8_t)((channel & 0x07) | ((curve & 0x03) << 3));
+  buf[4] = (uint8_t)((target >> 5) & 0x7F);
+  buf[5] = (uint8_t)(target & 0x1F);
+  buf[6] = duration_ms & 0x7F;
+  buf[7] = (duration_ms >> 7) & 0x7F;
+  buf[8] = TRAM8_SYSEX_END;
+  return TRAM8_LEN_RAMP;
+}
+
+static inline int tram8_parse_ramp(const uint8_t* buf,
+                                   uint8_t len,
+                                   uint8_t* channel,
+                                   uint16_t* target,
+                                   uint16_t* duration_ms,
+                                   tram8_curve_t* curve) {
+  if (len != TRAM8_LEN_RAMP)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_RAMP)
+    return -1;
+  if (buf[8] != TRAM8_SYSEX_END || (buf[3] & 0x60))
+    return -1;
+  for (int i = 3; i < 8; i++) {
+    if (buf[i] & 0x80)
+      return -1;
+  }
+
+  *channel = buf[3] & 0x07;
+  *curve = (tram8_curve_t)((buf[3] >> 3) & 0x03);
+  *target = (uint16_t)((buf[4] & 0x7F) << 5) | (buf[5] & 0x1F);
+  *duration_ms = (uint16_t)(buf[6] | ((uint16_t)buf[7] << 7));
+  return 0;
+}
+
+static inline uint8_t tram8_pack_mod(uint8_t* buf, uint8_t slot, tram8_mod_param_t param, uint16_t value) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_MOD;
+  buf[3] = (uint8_t)((param & 0x0F) | ((slot & 0x03) << 4));
+  buf[4] = value & 0x7F;
+  buf[5] = (value >> 7) & 0x7F;
+  buf[6] = TRAM8_SYSEX_END;
+  return TRAM8_LEN_MOD;
+}
+
+static inline int tram8_parse_mod(const uint8_t* buf,
+                                  uint8_t len,
+                                  uint8_t* slot,
+                                  tram8_mod_param_t* param,
+                                  uint16_t* value) {
+  if (len != TRAM8_LEN_MOD)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_MOD)
+    return -1;
+  if (buf[6] != TRAM8_SYSEX_END || (buf[3] | buf[4] | buf[5]) & 0x80)
+    return -1;
+  if ((buf[3] & 0x0F) >= TRAM8_MOD_PARAM_COUNT || (buf[3] >> 4) >= TRAM8_MOD_SLOTS)
+    return -1;
+
+  *slot = buf[3] >> 4;
+  *param = (tram8_mod_param_t)(buf[3] & 0x0F);
+  *value = (uint16_t)(buf[4] | ((uint16_t)buf[5] << 7));
+  return 0;
+}
+
+static inline uint8_t tram8_pack_trigger(uint8_t* buf, uint8_t gate, uint8_t pulse_ms, uint8_t gap_ms) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_TRIGGER;
+  buf[3] = gate & 0x07;
+  buf[4] = pulse_ms & 0x7F;
+  buf[5] = gap_ms & 0x7F;
+  buf[6] = TRAM8_SYSEX_END;
+  return TRAM8_LEN_TRIGGER;
+}
+
+static inline int tram8_parse_trigger(const uint8_t* buf, uint8_t len, uint8_t* gate, uint8_t* pulse_ms, uint8_t* gap_ms) {
+  if (len != TRAM8_LEN_TRIGGER)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_TRIGGER)
+    return -1;
+  if (buf[6] != TRAM8_SYSEX_END || buf[3] >= TRAM8_NUM_GATES || (buf[4] | buf[5]) & 0x80)
+    return -1;
+
+  *gate = buf[3];
+  *pulse_ms = buf[4];
+  *gap_ms = buf[5];
+  return 0;
+}
+
+static inline uint8_t tram8_pack_clock(uint8_t* buf, uint8_t gate, uint8_t divider, uint8_t swing) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_CLOCK;
+  buf[3] = gate & 0x07;
+  buf[4] = divider & 0x7F;
+  buf[5] = swing & 0x7F;
+  buf[6] = TRAM8_SYSEX_END;
+  return TRAM8_LEN_CLOCK;
+}
+
+// Rejects dividers between TRAM8_CLOCK_DIV_MAX and the run/reset roles
+static inline int tram8_parse_clock(const uint8_t* buf, uint8_t len, uint8_t* gate, uint8_t* divider, uint8_t* swing) {
+  if (len != TRAM8_LEN_CLOCK)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_CLOCK)
+    return -1;
+  if (buf[6] != TRAM8_SYSEX_END || buf[3] >= TRAM8_NUM_GATES || (buf[4] | buf[5]) & 0x80)
+    return -1;
+  if (buf[4] > TRAM8_CLOCK_DIV_MAX && buf[4] != TRAM8_CLOCK_RUN && buf[4] != TRAM8_CLOCK_RESET)
+    return -1;
+
+  *gate = buf[3];
+  *divider = buf[4];
+  *swing = buf[5];
+  return 0;
+}
+
+static inline uint8_t tram8_pack_stats_query(uint8_t* buf) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_STATS_QUERY;
+  buf[3] = TRAM8_SYSEX_END;
+  return TRAM8_LEN_STATS_QUERY;
+}
+
+static inline int tram8_parse_stats_query(const uint8_t* buf, uint8_t len) {
+  if (len != TRAM8_LEN_STATS_QUERY)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_STATS_QUERY)
+    return -1;
+  return buf[3] == TRAM8_SYSEX_END ? 0 : -1;
+}
+
+static inline uint8_t tram8_pack_stats(uint8_t* buf, const uint16_t stats[TRAM8_STAT_COUNT]) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_STATS;
+  uint8_t* p = &buf[3];
+  for (int i = 0; i < TRAM8_STAT_COUNT; i++) {
+    *p++ = stats[i] & 0x7F;
+    *p++ = (stats[i] >> 7) & 0x7F;
+    *p++ = (stats[i] >> 14) & 0x03;
+  }
+  *p = TRAM8_SYSEX_END;
+  return TRAM8_LEN_STATS;
+}
+
+// Host-side decoder for the reply
+static inline int tram8_parse_stats(const uint8_t* buf, uint32_t len, uint16_t stats[TRAM8_STAT_COUNT]) {
+  if (len != TRAM8_LEN_STATS)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_STATS)
+    return -1;
+  if (buf[TRAM8_LEN_STATS - 1] != TRAM8_SYSEX_END)
+    return -1;
+  const uint8_t* p = &buf[3];
+  for (int i = 0; i < TRAM8_STAT_COUNT; i++, p += 3) {
+    if ((p[0] | p[1]) & 0x80 || p[2] > 0x03)
+      return -1;
+    stats[i] = (uint16_t)(p[0] | ((uint16_t)p[1] << 7) | ((uint16_t)p[2] << 14));
+  }
+  return 0;
+}
+
+static inline uint8_t tram8_pack_ping(uint8_t* buf, uint16_t seq) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_PING;
+  buf[3] = seq & 0x7F;
+  buf[4] = (seq >> 7) & 0x7F;
+  buf[5] = TRAM8_SYSEX_END;
+  return TRAM8_LEN_PING;
+}
+
+static inline int tram8_parse_ping(const uint8_t* buf, uint8_t len, uint16_t* seq) {
+  if (len != TRAM8_LEN_PING)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_PING)
+    return -1;
+  if (buf[5] != TRAM8_SYSEX_END || (buf[3] | buf[4]) & 0x80)
+    return -1;
+  *seq = (uint16_t)(buf[3] | ((uint16_t)buf[4] << 7));
+  return 0;
+}
+
+static inline uint8_t tram8_pack_pong(uint8_t* buf, uint16_t seq, uint16_t ticks, uint8_t dwell_ms) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_PONG;
+  buf[3] = seq & 0x7F;
+  buf[4] = (seq >> 7) & 0x7F;
+  buf[5] = ticks & 0x7F;
+  buf[6] = (ticks >> 7) & 0x7F;
+  buf[7] = (ticks >> 14) & 0x03;
+  buf[8] = dwell_ms > TRAM8_PONG_DWELL_MAX ? TRAM8_PONG_DWELL_MAX : dwell_ms;
+  buf[9] = TRAM8_SYSEX_END;
+  return TRAM8_LEN_PONG;
+}
+
+// Host-side decoder for the pong
+static inline int tram8_parse_pong(const uint8_t* buf,
+                                   uint32_t len,
+                                   uint16_t* seq,
+                                   uint16_t* ticks,
+                                   uint8_t* dwell_ms) {
+  if (len != TRAM8_LEN_PONG)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_PONG)
+    return -1;
+  if (buf[9] != TRAM8_SYSEX_END || (buf[3] | buf[4] | buf[5] | buf[6] | buf[8]) & 0x80 || buf[7] > 0x03)
+    return -1;
+  *seq = (uint16_t)(buf[3] | ((uint16_t)buf[4] << 7));
+  *ticks = (uint16_t)(buf[5] | ((uint16_t)buf[6] << 7) | ((uint16_t)buf[7] << 14));
+  *dwell_ms = buf[8];
+  return 0;
+}
+
+static inline uint8_t tram8_pack_map(uint8_t* buf, uint8_t gate, uint8_t channel, uint8_t low, uint8_t high) {
+  buf[0] = TRAM8_SYSEX_START;
+  buf[1] = TRAM8_MANUFACTURER_ID;
+  buf[2] = TRAM8_CMD_MAP;
+  buf[3] = gate & 0x07;
+  buf[4] = channel & 0x7F;
+  buf[5] = low & 0x7F;
+  buf[6] = high & 0x7F;
+  buf[7] = TRAM8_SYSEX_END;
+  return TRAM8_LEN_MAP;
+}
+
+// Rejects channels between 15 and TRAM8_MAP_OFF and inverted ranges
+static inline int tram8_parse_map(const uint8_t* buf,
+                                  uint8_t len,
+                                  uint8_t* gate,
+                                  uint8_t* channel,
+                                  uint8_t* low,
+                                  uint8_t* high) {
+  if (len != TRAM8_LEN_MAP)
+    return -1;
+  if (buf[0] != TRAM8_SYSEX_START || buf[1] != TRAM8_MANUFACTURER_ID || buf[2] != TRAM8_CMD_MAP)
+    return -1;
+  if (buf[7] != TRAM8_SYSEX_END || buf[3] >= TRAM8_NUM_GATES || (buf[4] | buf[5] | buf[6]) & 0x80)
+    return -1;
+  if ((buf[4] > 15 && buf[4] != TRAM8_MAP_OFF) || buf[5] > buf[6])
+    return -1;
+
+  *gate = buf[3];
+  *channel = buf[4];
+  *low = buf[5];
+  *high = buf[6];
+  return 0;
+}
+
+// dac_mask receives the channels whose dac[] entry was written: none for
+// Form 1, all for Forms 2/3, and the changed-channel mask for the delta form.
+static inline int tram8_parse(const uint8_t* buf,
+                              uint8_t len,
+                              uint8_t* gate_mask,
+                              uint16_t dac[8],
+                              uint8_t* dac_mask,
+                              tram8_form_t* form) {
   if (len < TRAM8_LEN_GATES)
     return -1;
   if (buf[0] != TRAM8_SYSEX_START)
     return -1;
   if (buf[1] != TRAM8_MANUFACTURER_ID)
     return -1;
-  if (buf[2] != TRAM8_CMD_STATE)
+  if (buf[2] != TRAM8_CMD_STATE && buf[2] != TRAM8_CMD_DELTA)
     return -1;
 
+  if (buf[2] == TRAM8_CMD_DELTA) {
+    if (len < TRAM8_LEN_DELTA_BASE || buf[len - 1] != TRAM8_SYSEX_END)
+      return -1;
+    if (tram8_unpack_delta_body(&buf[3], (uint8_t)(len - 4), gate_mask, dac, dac_mask) != 0)
+      return -1;
+    *form = TRAM8_FORM_DELTA;
+    return 0;
+  }
+
   *gate_mask = (buf[3] & 0x7F) | ((buf[4] & 0x01) << 7);
 
   if (len == TRAM8_LEN_GATES) {
+    *dac_mask = 0;
     *form = TRAM8_FORM_GATES;
     return 0;
   }
@@ -125,6 +763,7 @@ tram8_parse(const uint8_t* buf, uint8_t len, uint8_t* gate_mask, uint16_t dac[8]
     dac[i] = (uint16_t)(buf[5 + i] & 0x7F) << 5;
 
   if (len == TRAM8_LEN_COARSE) {
+    *dac_mask = 0xFF;
     *form = TRAM8_FORM_COARSE;
     return 0;
   }
@@ -146,6 +785,7 @@ tram8_parse(const uint8_t* buf, uint8_t len, uint8_t* gate_mask, uint16_t dac[8]
     bits -= 5;
   }
 
+  *dac_mask = 0xFF;
   *form = TRAM8_FORM_FULL;
   return 0;
 }
@@ -0,0 +1,479 @@
+// Round-trip latency probe for the tram8+ frame path.
+//
+// Sends pings (F0 7D 1A) at a fixed rate, each written together with a burst
+// of delta state frames as load, and times the pongs. Every byte costs
+// 320 us on the 31,250-baud wire, so results are reported against that floor:
+// the load and ping ahead of the reply plus the reply itself.
+//
+//   latency_probe --port /dev/snd/midiC1D0 [--rate 20] [--count 200] [--load 2]
+//   latency_probe --loopback [...]
+//
+// --port takes any device node that reads and writes raw MIDI bytes (an ALSA
+// rawmidi node, a serial adapter already set to MIDI rate). --loopback forks a
+// stand-in for the module that paces both directions at wire speed, so the
+// tool and the protocol can be exercised without hardware.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../protocol/tram8_sysex.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NS_PER_US 1000LL
+#define NS_PER_MS 1000000LL
+#define NS_PER_S 1000000000LL
+#define BYTE_NS (TRAM8_BYTE_US * NS_PER_US)
+#define MAX_LOAD 64
+#define MAX_PINGS (TRAM8_PING_SEQ_MAX + 1)
+
+typedef struct {
+  const char* port;
+  int loopback;
+  double rate;
+  int count;
+  int load;
+  int channels;
+  int timeout_ms;
+} options_t;
+
+typedef struct {
+  int64_t sent_ns;
+  int64_t rtt_ns; // < 0 until the pong arrives
+  int64_t floor_ns;
+  int64_t inbound_ms; // device tick minus host send time, unwrapped
+  uint8_t dwell_ms;
+} probe_t;
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * NS_PER_S + ts.tv_nsec;
+}
+
+// Waits for fd to become readable, at most until deadline_ns
+static int wait_readable(int fd, int64_t deadline_ns) {
+  int64_t wait = deadline_ns - now_ns();
+  if (wait < 0)
+    wait = 0;
+  struct timeval tv = {(time_t)(wait / NS_PER_S), (suseconds_t)((wait % NS_PER_S) / NS_PER_US)};
+  fd_set set;
+  FD_ZERO(&set);
+  FD_SET(fd, &set);
+  int n = select(fd + 1, &set, NULL, NULL, &tv);
+  return n > 0;
+}
+
+static int write_all(int fd, const uint8_t* buf, size_t len) {
+  while (len) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    buf += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+static uint32_t rng_state = 0x7A3F19C5u;
+
+static uint32_t rng_next(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+// Collects one SysEx frame at a time from an arbitrary byte stream
+typedef struct {
+  uint8_t buf[TRAM8_LEN_STATS];
+  uint32_t len;
+} frame_reader_t;
+
+// Returns the frame length once F7 completes a frame, else 0
+static uint32_t frame_feed(frame_reader_t* r, uint8_t byte) {
+  if (byte >= 0xF8)
+    return 0;
+  if (byte == TRAM8_SYSEX_START) {
+    r->buf[0] = byte;
+    r->len = 1;
+    return 0;
+  }
+  if (r->len == 0)
+    return 0;
+  if ((byte & 0x80 && byte != TRAM8_SYSEX_END) || r->len >= sizeof(r->buf)) {
+    r->len = 0;
+    return 0;
+  }
+  r->buf[r->len++] = byte;
+  if (byte != TRAM8_SYSEX_END)
+    return 0;
+  uint32_t len = r->len;
+  r->len = 0;
+  return len;
+}
+
+/*
+ * Loopback stand-in: receives bytes at wire pace, answers pings with the
+ * pong layout the firmware uses, and sends each pong at wire pace too.
+ * Outputs are taken as loaded as soon as a frame is in, so dwell is 0.
+ */
+
+#define STANDIN_QUEUE 4096
+#define STANDIN_REPLIES 64
+
+static void standin_run(int fd) {
+  static uint8_t in_bytes[STANDIN_QUEUE];
+  static int64_t in_due[STANDIN_QUEUE];
+  static uint8_t out_buf[STANDIN_REPLIES][TRAM8_LEN_PONG];
+  static int64_t out_due[STANDIN_REPLIES];
+  uint32_t in_head = 0, in_tail = 0, out_head = 0, out_tail = 0;
+  int64_t in_free = 0, out_free = 0;
+  int64_t start = now_ns();
+  frame_reader_t reader = {{0}, 0};
+  int open = 1;
+
+  while (open || in_head != in_tail || out_head != out_tail) {
+    int64_t deadline = now_ns() + 100 * NS_PER_MS;
+    if (in_head != in_tail && in_due[in_tail] < deadline)
+      deadline = in_due[in_tail];
+    if (out_head != out_tail && out_due[out_tail] < deadline)
+      deadline = out_due[out_tail];
+
+    if (open && wait_readable(fd, deadline)) {
+      uint8_t chunk[256];
+      ssize_t n = read(fd, chunk, sizeof(chunk));
+      if (n <= 0) {
+        open = 0;
+      } else {
+        int64_t t = now_ns();
+        for (ssize_t i = 0; i < n && ((in_head + 1) % STANDIN_QUEUE) != in_tail; i++) {
+          in_free = (in_free > t ? in_free : t) + BYTE_NS;
+          in_bytes[in_head] = chunk[i];
+          in_due[in_head] = in_free;
+          in_head = (in_head + 1) % STANDIN_QUEUE;
+        }
+      }
+    } else if (!open) {
+      int64_t wait = deadline - now_ns();
+      if (wait > 0) {
+        struct timespec ts = {(time_t)(wait / NS_PER_S), (long)(wait % NS_PER_S)};
+        nanosleep(&ts, NULL);
+      }
+    }
+
+    int64_t t = now_ns();
+    while (in_head != in_tail && in_due[in_tail] <= t) {
+      uint32_t len = frame_feed(&reader, in_bytes[in_tail]);
+      in_tail = (in_tail + 1) % STANDIN_QUEUE;
+      uint16_t seq;
+      if (!len || tram8_parse_ping(reader.buf, (uint8_t)len, &seq) != 0)
+        continue;
+      if ((out_head + 1) % STANDIN_REPLIES == out_tail)
+        continue; // dropped, like a ping arriving while one is held
+      uint16_t ticks = (uint16_t)((t - start) / NS_PER_MS);
+      tram8_pack_pong(out_buf[out_head], seq, ticks, 0);
+      out_free = (out_free > t ? out_free : t) + TRAM8_LEN_PONG * BYTE_NS;
+      out_due[out_head] = out_free;
+      out_head = (out_head + 1) % STANDIN_REPLIES;
+    }
+    while (out_head != out_tail && out_due[out_tail] <= t) {
+      if (open && write_all(fd, out_buf[out_tail], TRAM8_LEN_PONG) != 0)
+        open = 0;
+      out_tail = (out_tail + 1) % STANDIN_REPLIES;
+    }
+  }
+  close(fd);
+}
+
+static pid_t standin_start(int* host_fd) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    return -1;
+  pid_t pid = fork();
+  if (pid < 0)
+    return -1;
+  if (pid == 0) {
+    close(fds[0]);
+    standin_run(fds[1]);
+    _exit(0);
+  }
+  close(fds[1]);
+  *host_fd = fds[0];
+  return pid;
+}
+
+/*
+ * Host side
+ */
+
+typedef struct {
+  probe_t* probes;
+  int sent;
+  int received;
+  int have_tick;
+  uint16_t last_tick;
+  int64_t tick_base; // unwrapped device ms of last_tick
+  int64_t start_ns;
+  frame_reader_t reader;
+} session_t;
+
+static void on_pong(session_t* s, const uint8_t* buf, uint32_t len, int64_t t) {
+  uint16_t seq, ticks;
+  uint8_t dwell;
+  if (tram8_parse_pong(buf, len, &seq, &ticks, &dwell) != 0)
+    return;
+  if (seq >= s->sent || s->probes[seq].rtt_ns >= 0)
+    return; // stale or duplicate
+
+  if (s->have_tick)
+    s->tick_base += (uint16_t)(ticks - s->last_tick);
+  else
+    s->tick_base = ticks;
+  s->have_tick = 1;
+  s->last_tick = ticks;
+
+  probe_t* p = &s->probes[seq];
+  p->rtt_ns = t - p->sent_ns;
+  p->dwell_ms = dwell;
+  p->inbound_ms = s->tick_base - (p->sent_ns - s->start_ns) / NS_PER_MS;
+  s->received++;
+}
+
+// Reads whatever arrives before deadline_ns, or until every ping is answered
+// if drain is set
+static int service_rx(session_t* s, int fd, int64_t deadline_ns, int drain) {
+  while (wait_readable(fd, deadline_ns)) {
+    uint8_t chunk[256];
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    int64_t t = now_ns();
+    for (ssize_t i = 0; i < n; i++) {
+      uint32_t len = frame_feed(&s->reader, chunk[i]);
+      if (len)
+        on_pong(s, s->reader.buf, len, t);
+    }
+    if (drain && s->received == s->sent)
+      break;
+  }
+  return 0;
+}
+
+static uint32_t build_burst(uint8_t* buf, const options_t* o, uint16_t seq) {
+  uint32_t len = 0;
+  for (int i = 0; i < o->load; i++) {
+    uint16_t dac[TRAM8_NUM_GATES];
+    for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+      dac[ch] = (uint16_t)(rng_next() & TRAM8_DAC_MAX);
+    uint8_t mask = 0;
+    while (tram8_popcount(mask) < o->channels)
+      mask |= (uint8_t)(1 << (rng_next() % TRAM8_NUM_GATES));
+    len += tram8_pack_delta(&buf[len], (uint8_t)rng_next(), dac, mask);
+  }
+  len += tram8_pack_ping(&buf[len], seq);
+  return len;
+}
+
+static int cmp_i64(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of a sorted array
+static int64_t percentile(const int64_t* v, int n, int pct) {
+  int rank = (pct * n + 99) / 100;
+  if (rank < 1)
+    rank = 1;
+  return v[rank - 1];
+}
+
+static void print_row(const char* name, int64_t* v, int n, double scale, const char* unit) {
+  qsort(v, (size_t)n, sizeof(*v), cmp_i64);
+  printf("  %-14s p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f %s\n",
+         name,
+         (double)percentile(v, n, 50) / scale,
+         (double)percentile(v, n, 90) / scale,
+         (double)percentile(v, n, 99) / scale,
+         (double)v[n - 1] / scale,
+         unit);
+}
+
+static void report(const session_t* s, const options_t* o) {
+  int n = s->received;
+  printf("tram8+ latency probe: %d pings at %.1f Hz, %d load frame(s) of %d channel(s) each\n",
+         s->sent,
+         o->rate,
+         o->load,
+         o->channels);
+  printf("  received %d, lost %d\n", n, s->sent - n);
+  if (n == 0)
+    return;
+
+  int64_t* rtt = malloc(sizeof(int64_t) * (size_t)n);
+  int64_t* excess = malloc(sizeof(int64_t) * (size_t)n);
+  int64_t* inbound = malloc(sizeof(int64_t) * (size_t)n);
+  int64_t* dwell = malloc(sizeof(int64_t) * (size_t)n);
+  int64_t floor_ns = 0, inbound_min = 0;
+  int k = 0;
+  for (int i = 0; i < s->sent; i++) {
+    const probe_t* p = &s->probes[i];
+    if (p->rtt_ns < 0)
+      continue;
+    if (k == 0 || p->inbound_ms < inbound_min)
+      inbound_min = p->inbound_ms;
+    rtt[k] = p->rtt_ns;
+    excess[k] = p->rtt_ns - p->floor_ns;
+    inbound[k] = p->inbound_ms;
+    dwell[k] = p->dwell_ms;
+    floor_ns = p->floor_ns;
+    k++;
+  }
+  for (int i = 0; i < n; i++)
+    inbound[i] -= inbound_min;
+
+  printf("  wire floor     %.2f ms (%d us/byte, %lld bytes ahead of and in the pong)\n",
+         (double)floor_ns / NS_PER_MS,
+         TRAM8_BYTE_US,
+         (long long)(floor_ns / BYTE_NS));
+  print_row("round trip", rtt, n, NS_PER_MS, "ms");
+  print_row("over floor", excess, n, NS_PER_MS, "ms");
+  print_row("inbound jitter", inbound, n, 1, "ms (device tick vs send, 1 ms steps)");
+  print_row("device dwell", dwell, n, 1, "ms (ping handled to pong start)");
+
+  free(rtt);
+  free(excess);
+  free(inbound);
+  free(dwell);
+}
+
+static int run(int fd, const options_t* o) {
+  session_t s;
+  memset(&s, 0, sizeof(s));
+  s.probes = calloc((size_t)o->count, sizeof(probe_t));
+  if (!s.probes)
+    return -1;
+  for (int i = 0; i < o->count; i++)
+    s.probes[i].rtt_ns = -1;
+
+  static uint8_t burst[MAX_LOAD * TRAM8_LEN_MAX + TRAM8_LEN_PING];
+  int64_t period = (int64_t)(NS_PER_S / o->rate);
+  s.start_ns = now_ns();
+
+  int rc = 0;
+  for (int i = 0; i < o->count && rc == 0; i++) {
+    int64_t due = s.start_ns + i * period;
+    if (service_rx(&s, fd, due, 0) != 0)
+      rc = -1;
+    uint32_t len = build_burst(burst, o, (uint16_t)i);
+    probe_t* p = &s.probes[i];
+    p->floor_ns = (int64_t)(len + TRAM8_LEN_PONG) * BYTE_NS;
+    p->sent_ns = now_ns();
+    s.sent++;
+    if (write_all(fd, burst, len) != 0)
+      rc = -1;
+  }
+  if (rc == 0)
+    rc = service_rx(&s, fd, now_ns() + o->timeout_ms * NS_PER_MS, 1);
+
+  report(&s, o);
+  free(s.probes);
+  return rc;
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s (--port PATH | --loopback) [--rate HZ] [--count N] [--load N] [--channels N] "
+          "[--timeout MS]\n"
+          "  --rate      pings per second (default 10)\n"
+          "  --count     pings to send, up to %d (default 100)\n"
+          "  --load      delta state frames written ahead of each ping, up to %d (default 0)\n"
+          "  --channels  DAC channels changed per load frame, 0-8 (default 2)\n"
+          "  --timeout   ms to wait for the last pongs (default 1000)\n",
+          prog,
+          MAX_PINGS,
+          MAX_LOAD);
+}
+
+static int parse_args(int argc, char** argv, options_t* o) {
+  *o = (options_t){NULL, 0, 10.0, 100, 0, 2, 1000};
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+    if (!strcmp(a, "--loopback")) {
+      o->loopback = 1;
+      continue;
+    }
+    if (!v)
+      return -1;
+    i++;
+    if (!strcmp(a, "--port"))
+      o->port = v;
+    else if (!strcmp(a, "--rate"))
+      o->rate = atof(v);
+    else if (!strcmp(a, "--count"))
+      o->count = atoi(v);
+    else if (!strcmp(a, "--load"))
+      o->load = atoi(v);
+    else if (!strcmp(a, "--channels"))
+      o->channels = atoi(v);
+    else if (!strcmp(a, "--timeout"))
+      o->timeout_ms = atoi(v);
+    else
+      return -1;
+  }
+  if (!o->port == !o->loopback)
+    return -1;
+  if (o->rate <= 0 || o->count < 1 || o->count > MAX_PINGS || o->load < 0 || o->load > MAX_LOAD)
+    return -1;
+  if (o->channels < 0 || o->channels > TRAM8_NUM_GATES || o->timeout_ms < 0)
+    return -1;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  options_t o;
+  if (parse_args(argc, argv, &o) != 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  int fd;
+  pid_t standin = 0;
+  if (o.loopback) {
+    standin = standin_start(&fd);
+    if (standin < 0) {
+      perror("loopback");
+      return 1;
+    }
+  } else {
+    fd = open(o.port, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+      perror(o.port);
+      return 1;
+    }
+  }
+
+  int rc = run(fd, &o);
+  close(fd);
+  if (standin > 0)
+    waitpid(standin, NULL, 0);
+  if (rc != 0) {
+    fprintf(stderr, "port closed during the run\n");
+    return 1;
+  }
+  return 0;
+}
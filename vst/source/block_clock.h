@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+namespace tram8 {
+
+// Maps sample offsets within a process() block to host clock time, so each
+// state frame can be timestamped where its events fall instead of at the
+// block boundary. Times are nanoseconds on the host's monotonic clock.
+class BlockClock {
+ public:
+  // A reported block time further than this from the clock is not trusted
+  static constexpr uint64_t kMaxSkewNanos = 1000000000ull;
+
+  // hostNanos is ProcessContext::systemTime when the host sets it. Without
+  // it the block is taken to start now, which still keeps events in a block
+  // spaced apart.
+  void begin(bool hostTimeValid, int64_t hostNanos, uint64_t nowNanos, double sampleRate) {
+    start_ = nowNanos;
+    if (hostTimeValid && hostNanos > 0) {
+      uint64_t host = (uint64_t)hostNanos;
+      uint64_t skew = host > nowNanos ? host - nowNanos : nowNanos - host;
+      if (skew <= kMaxSkewNanos)
+        start_ = host;
+    }
+    nanosPerSample_ = sampleRate > 0 ? 1e9 / sampleRate : 0;
+  }
+
+  uint64_t at(int32_t sampleOffset) const {
+    if (sampleOffset <= 0)
+      return start_;
+    return start_ + (uint64_t)(sampleOffset * nanosPerSample_ + 0.5);
+  }
+
+  uint64_t start() const { return start_; }
+
+ private:
+  uint64_t start_ = 0;
+  double nanosPerSample_ = 0;
+};
+
+} // namespace tram8
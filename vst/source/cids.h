@@ -14,6 +14,7 @@ enum ParamIDs : Steinberg::Vst::ParamID {
   kDacChannelBase = 400, // 400-407
   kCcNumBase = 500, // 500-507
   kCcValueBase = 600, // 600-727 (one per CC 0-127)
+  kNotePriorityBase = 800, // 800-807
 };
 
 } // namespace tram8
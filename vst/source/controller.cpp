@@ -77,6 +77,12 @@ tresult PLUGIN_API Controller::initialize(FUnknown* context) {
     }
     ccParam->setNormalized(ccParam->toNormalized(1));
     parameters.addParameter(ccParam);
+
+    auto* priorityParam = new StringListParameter(STR16("Note Priority"), kNotePriorityBase + i);
+    priorityParam->appendString(STR16("Last"));
+    priorityParam->appendString(STR16("Lowest"));
+    priorityParam->appendString(STR16("Highest"));
+    parameters.addParameter(priorityParam);
   }
 
   for (int cc = 0; cc < 128; cc++) {
@@ -110,8 +116,11 @@ tresult PLUGIN_API Controller::notify(IMessage* message) {
       int64 val = 0;
       if (message->getAttributes()->getInt("input", val) == kResultOk && val)
         activeView->flashMidiInput();
-      if (message->getAttributes()->getInt("output", val) == kResultOk && val)
-        activeView->flashMidiOutput();
+      if (message->getAttributes()->getInt("output", val) == kResultOk && val) {
+        double backlogMs = 0;
+        message->getAttributes()->getFloat("backlogMs", backlogMs);
+        activeView->flashMidiOutput(backlogMs);
+      }
     }
     return kResultOk;
   }
@@ -182,6 +191,18 @@ tresult PLUGIN_API Controller::setComponentState(IBStream* state) {
       ccParam->setNormalized(ccParam->toNormalized(ccNumVal));
   }
 
+  // Older states stop after the gates and mean last-note priority
+  for (int i = 0; i < 8; i++) {
+    int32 priorityVal = kPriorityLast;
+    if (state->read(&priorityVal, sizeof(int32)) != kResultOk)
+      priorityVal = kPriorityLast;
+    if (priorityVal < 0 || priorityVal >= kPriorityCount)
+      priorityVal = kPriorityLast;
+    auto* priorityParam = parameters.getParameter(kNotePriorityBase + i);
+    if (priorityParam)
+      priorityParam->setNormalized(priorityParam->toNormalized(priorityVal));
+  }
+
   return kResultOk;
 }
 
@@ -0,0 +1,105 @@
+#include "encoder.h"
+
+#include <cstring>
+
+namespace tram8 {
+
+void Encoder::resync() {
+  synced_ = false;
+}
+
+uint32_t Encoder::packVoice(uint8_t* out,
+                            uint8_t gateMask,
+                            uint8_t gateDiff,
+                            const uint16_t dac[TRAM8_NUM_GATES],
+                            uint8_t dacDiff) const {
+  uint32_t len = 0;
+
+  // DACs first so the CV has settled before any gate edge
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++) {
+    if (!((dacDiff >> ch) & 1))
+      continue;
+    if (out) {
+      out[len] = (uint8_t)(TRAM8_CV_BEND | ch);
+      tram8_dac_to_bend(dac[ch], &out[len + 1], &out[len + 2]);
+    }
+    len += 3;
+  }
+
+  for (int g = 0; g < TRAM8_NUM_GATES; g++) {
+    if (!((gateDiff >> g) & 1))
+      continue;
+    if (out) {
+      out[len] = TRAM8_CV_NOTE_ON | TRAM8_CV_GATE_CHANNEL;
+      out[len + 1] = (uint8_t)g;
+      out[len + 2] = ((gateMask >> g) & 1) ? TRAM8_CV_GATE_ON_VELOCITY : 0;
+    }
+    len += 3;
+  }
+
+  return len;
+}
+
+uint32_t Encoder::encode(uint8_t gateMask,
+                         const uint16_t target[TRAM8_NUM_GATES],
+                         bool fullPrecision,
+                         uint8_t* out,
+                         uint8_t dacMask) {
+  uint16_t dac[TRAM8_NUM_GATES];
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    dac[ch] = (!synced_ || ((dacMask >> ch) & 1)) ? target[ch] : sentDac_[ch];
+
+  uint8_t gateDiff = synced_ ? (uint8_t)(gateMask ^ sentGate_) : 0xFF;
+  uint8_t dacDiff = 0;
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++) {
+    if (!synced_ || dac[ch] != sentDac_[ch])
+      dacDiff |= (1 << ch);
+  }
+
+  pendingGate_ = gateMask;
+  memcpy(pendingDac_, dac, sizeof(pendingDac_));
+
+  if (synced_ && !gateDiff && !dacDiff) {
+    encoding_ = kEncVoice;
+    return 0;
+  }
+
+  tram8_form_t form = TRAM8_FORM_GATES;
+  uint32_t best = TRAM8_LEN_GATES;
+  if (dacDiff) {
+    form = fullPrecision ? TRAM8_FORM_FULL : TRAM8_FORM_COARSE;
+    best = fullPrecision ? TRAM8_LEN_FULL : TRAM8_LEN_COARSE;
+  }
+  encoding_ = (Encoding)form;
+
+  // Anything relative needs a known hardware state to build on
+  if (synced_) {
+    if (dacDiff && tram8_delta_len(dacDiff) < best) {
+      encoding_ = kEncDelta;
+      best = tram8_delta_len(dacDiff);
+    }
+
+    if (packVoice(nullptr, gateMask, gateDiff, dac, dacDiff) < best)
+      encoding_ = kEncVoice;
+  }
+
+  if (encoding_ == kEncVoice)
+    return packVoice(out, gateMask, gateDiff, dac, dacDiff);
+
+  if (encoding_ == kEncDelta)
+    return tram8_pack_delta(out, gateMask, dac, dacDiff);
+
+  if (encoding_ == kEncCoarse) {
+    for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+      pendingDac_[ch] &= (uint16_t)~0x1F;
+  }
+  return tram8_pack(out, gateMask, dac, form);
+}
+
+void Encoder::commit() {
+  synced_ = true;
+  sentGate_ = pendingGate_;
+  memcpy(sentDac_, pendingDac_, sizeof(sentDac_));
+}
+
+} // namespace tram8
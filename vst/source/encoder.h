@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../../protocol/tram8_sysex.h"
+
+#include <cstdint>
+
+namespace tram8 {
+
+enum Encoding {
+  kEncGates = TRAM8_FORM_GATES,
+  kEncCoarse = TRAM8_FORM_COARSE,
+  kEncFull = TRAM8_FORM_FULL,
+  kEncDelta = TRAM8_FORM_DELTA,
+  kEncVoice,
+  kEncodingCount,
+};
+
+// Picks the cheapest byte encoding of a gate/DAC state change.
+//
+// Tracks what the hardware was last told (gates, 12-bit DACs) and prices every
+// candidate against it: the absolute SysEx forms, the delta form, and channel
+// voice messages. Every voice message carries its own status byte, since
+// CoreMIDI packets may not rely on running status. encode() only stages the
+// result; call commit() once the bytes have actually been sent.
+class Encoder {
+ public:
+  // Worst case is channel voice for everything: 8 bends + 8 notes
+  static constexpr int kMaxBytes = TRAM8_NUM_GATES * 3 * 2;
+
+  Encoder() { resync(); }
+
+  // Forget the hardware state; the next encode() sends an absolute frame.
+  void resync();
+
+  // Returns the number of bytes written to out (0 if nothing changed).
+  // fullPrecision = false allows Form 2, which drops the low 5 DAC bits.
+  // DAC channels outside dacMask keep what the hardware has, so their
+  // changes stay pending for a later frame; an unsynced encoder sends all.
+  uint32_t encode(uint8_t gateMask,
+                  const uint16_t target[TRAM8_NUM_GATES],
+                  bool fullPrecision,
+                  uint8_t* out,
+                  uint8_t dacMask = 0xFF);
+
+  void commit();
+
+  Encoding encoding() const { return encoding_; }
+
+  // Cost of the channel voice encoding; packs into out when non-null.
+  uint32_t packVoice(uint8_t* out,
+                     uint8_t gateMask,
+                     uint8_t gateDiff,
+                     const uint16_t dac[TRAM8_NUM_GATES],
+                     uint8_t dacDiff) const;
+
+ private:
+  bool synced_ = false;
+  uint8_t sentGate_ = 0;
+  uint16_t sentDac_[TRAM8_NUM_GATES] = {};
+
+  Encoding encoding_ = kEncGates;
+  uint8_t pendingGate_ = 0;
+  uint16_t pendingDac_[TRAM8_NUM_GATES] = {};
+};
+
+} // namespace tram8
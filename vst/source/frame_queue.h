@@ -0,0 +1,64 @@
+#pragma once
+
+#include "encoder.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+namespace tram8 {
+
+// One encoded state change and when it should reach the wire
+struct Frame {
+  uint64_t hostNanos = 0;
+  uint32_t length = 0;
+  uint8_t bytes[Encoder::kMaxBytes] = {};
+};
+
+// Wait-free single-producer/single-consumer ring of frames. process() pushes
+// and never blocks; the sender thread reads frames in place and pops them
+// once they are sent, so a slot is never rewritten while it is being read.
+class FrameQueue {
+ public:
+  static constexpr uint32_t kCapacity = 64; // power of two
+  static_assert((kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+
+  // Producer. Returns false when full; the caller keeps the change pending.
+  bool push(const uint8_t* data, uint32_t length, uint64_t hostNanos) {
+    if (length > Encoder::kMaxBytes)
+      return false;
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == kCapacity)
+      return false;
+    Frame& f = frames_[head & (kCapacity - 1)];
+    f.hostNanos = hostNanos;
+    f.length = length;
+    memcpy(f.bytes, data, length);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer. Frame i from the front, nullptr past the end.
+  const Frame* peek(uint32_t i) const {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) - tail <= i)
+      return nullptr;
+    return &frames_[(tail + i) & (kCapacity - 1)];
+  }
+
+  // Consumer. Releases the first n frames (at most size()) to the producer.
+  void pop(uint32_t n) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t avail = head_.load(std::memory_order_acquire) - tail;
+    tail_.store(tail + (n < avail ? n : avail), std::memory_order_release);
+  }
+
+  uint32_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+ private:
+  Frame frames_[kCapacity];
+  alignas(64) std::atomic<uint32_t> head_{0}; // next slot the producer fills
+  alignas(64) std::atomic<uint32_t> tail_{0}; // oldest slot not yet sent
+};
+
+} // namespace tram8
@@ -21,39 +21,157 @@ struct NoteEntry {
   uint8_t velocity = 0;
 };
 
-struct NoteStack {
-  static constexpr int kMaxNotes = 16;
-  NoteEntry entries[kMaxNotes];
-  int count = 0;
-
-  void push(int16_t channel, int16_t note, uint8_t velocity) {
-    remove(channel, note);
-    if (count < kMaxNotes) {
-      entries[count].channel = channel;
-      entries[count].note = note;
-      entries[count].velocity = velocity;
+enum NotePriority {
+  kPriorityLast = 0,
+  kPriorityLowest = 1,
+  kPriorityHighest = 2,
+  kPriorityCount = 3,
+};
+
+// Notes held on one gate or DAC, keyed by (channel, note), with every
+// operation in constant time. A 128-bit set of held pitches gives the lowest
+// and highest with one count-zeros instruction, and a per-pitch channel mask
+// says which channels hold each one. Held keys live in a pool of kMaxHeld
+// slots, found through a short chain per pitch (one slot per channel holding
+// it, so at most 16) and threaded in press order for last-note priority.
+// With the pool full, the oldest key gives way to a new one. About 1.2 KB.
+struct NoteSet {
+  static constexpr int kMaxHeld = 128;
+  static constexpr uint8_t kNone = 0xFF;
+
+  uint64_t held[2] = {}; // bit n: pitch n is down on some channel
+  uint16_t channels[128] = {}; // bit c: down on channel c
+  uint8_t firstSlot[128]; // a slot holding each pitch, kNone if none
+  // By slot
+  uint16_t keys[kMaxHeld]; // channel << 7 | note
+  uint8_t velocity[kMaxHeld];
+  uint8_t samePitch[kMaxHeld]; // next slot holding this pitch on another channel
+  uint8_t prev[kMaxHeld]; // press order, linking held slots only
+  uint8_t next[kMaxHeld]; // ... and chaining free ones
+  uint8_t used = 0; // slots ever handed out since clear()
+  uint8_t freeSlot = kNone;
+  uint8_t newest = kNone;
+  uint8_t oldest = kNone;
+  int count = 0; // held keys
+
+  NoteSet() { clear(); }
+
+  static uint16_t key(int16_t channel, int16_t note) { return (uint16_t)(channel << 7 | note); }
+
+  // channel 0-15, note 0-127; the caller filters anything else
+  void push(int16_t channel, int16_t note, uint8_t vel) {
+    uint16_t bit = (uint16_t)(1 << channel);
+    uint8_t s;
+    if (channels[note] & bit) {
+      s = find(key(channel, note));
+      unlink(s);
+    } else {
+      if (count == kMaxHeld)
+        remove((int16_t)(keys[oldest] >> 7), (int16_t)(keys[oldest] & 0x7F));
+      s = allocate();
+      keys[s] = key(channel, note);
+      samePitch[s] = firstSlot[note];
+      firstSlot[note] = s;
+      channels[note] |= bit;
+      held[note >> 6] |= 1ull << (note & 63);
       count++;
     }
+    velocity[s] = vel;
+    link(s);
   }
 
   void remove(int16_t channel, int16_t note) {
-    for (int i = 0; i < count; i++) {
-      if (entries[i].channel == channel && entries[i].note == note) {
-        for (int j = i; j < count - 1; j++)
-          entries[j] = entries[j + 1];
-        count--;
-        return;
-      }
+    uint16_t bit = (uint16_t)(1 << channel);
+    if (!(channels[note] & bit))
+      return;
+    uint16_t k = key(channel, note);
+    uint8_t s = firstSlot[note];
+    if (keys[s] == k) {
+      firstSlot[note] = samePitch[s];
+    } else {
+      uint8_t p = s;
+      while (keys[samePitch[p]] != k)
+        p = samePitch[p];
+      s = samePitch[p];
+      samePitch[p] = samePitch[s];
     }
+    unlink(s);
+    next[s] = freeSlot;
+    freeSlot = s;
+    channels[note] &= (uint16_t)~bit;
+    if (!channels[note])
+      held[note >> 6] &= ~(1ull << (note & 63));
+    count--;
+  }
+
+  void clear() {
+    held[0] = held[1] = 0;
+    memset(channels, 0, sizeof(channels));
+    memset(firstSlot, kNone, sizeof(firstSlot));
+    used = 0;
+    freeSlot = kNone;
+    newest = oldest = kNone;
+    count = 0;
   }
 
   bool empty() const { return count == 0; }
 
-  const NoteEntry& top() const {
-    static constexpr NoteEntry kEmpty{};
-    if (count <= 0)
-      return kEmpty;
-    return entries[count - 1];
+  int lowest() const { return held[0] ? __builtin_ctzll(held[0]) : 64 + __builtin_ctzll(held[1]); }
+  int highest() const { return held[1] ? 127 - __builtin_clzll(held[1]) : 63 - __builtin_clzll(held[0]); }
+
+  // The note priority picks; lowest and highest take the lowest channel
+  // holding that pitch. An empty set gives a zeroed entry.
+  NoteEntry top(uint8_t priority = kPriorityLast) const {
+    NoteEntry e;
+    if (count == 0)
+      return e;
+    uint8_t s = newest;
+    if (priority == kPriorityLowest || priority == kPriorityHighest) {
+      int n = priority == kPriorityLowest ? lowest() : highest();
+      s = find(key((int16_t)__builtin_ctz(channels[n]), (int16_t)n));
+    }
+    e.channel = (int16_t)(keys[s] >> 7);
+    e.note = (int16_t)(keys[s] & 0x7F);
+    e.velocity = velocity[s];
+    return e;
+  }
+
+ private:
+  // k must be held
+  uint8_t find(uint16_t k) const {
+    uint8_t s = firstSlot[k & 0x7F];
+    while (keys[s] != k)
+      s = samePitch[s];
+    return s;
+  }
+
+  uint8_t allocate() {
+    if (freeSlot == kNone)
+      return used++;
+    uint8_t s = freeSlot;
+    freeSlot = next[s];
+    return s;
+  }
+
+  void link(uint8_t s) {
+    prev[s] = newest;
+    next[s] = kNone;
+    if (newest != kNone)
+      next[newest] = s;
+    else
+      oldest = s;
+    newest = s;
+  }
+
+  void unlink(uint8_t s) {
+    if (prev[s] != kNone)
+      next[prev[s]] = next[s];
+    else
+      oldest = next[s];
+    if (next[s] != kNone)
+      prev[next[s]] = prev[s];
+    else
+      newest = prev[s];
   }
 };
 
@@ -87,7 +205,7 @@ class MidiEngine {
     if (dacMode_[gate] == mode)
       return;
     dacMode_[gate] = mode;
-    noteStacks_[gate].count = 0;
+    dacNotes_[gate].clear();
     if (mode == kDacCC)
       dacValues_[gate] = (uint16_t)ccValues_[ccNum_[gate]] << 7;
     else
@@ -100,7 +218,7 @@ class MidiEngine {
     if (dacChannel_[gate] == channel)
       return;
     dacChannel_[gate] = channel;
-    noteStacks_[gate].count = 0;
+    dacNotes_[gate].clear();
     dacValues_[gate] = 0;
   }
 
@@ -112,6 +230,20 @@ class MidiEngine {
       dacValues_[gate] = (uint16_t)ccValues_[cc] << 7;
   }
 
+  void setNotePriority(int gate, uint8_t priority) {
+    if (gate < 0 || gate >= kNumGates)
+      return;
+    if (priority >= kPriorityCount)
+      priority = kPriorityLast;
+    if (notePriority_[gate] == priority)
+      return;
+    notePriority_[gate] = priority;
+    if (!dacNotes_[gate].empty()) {
+      NoteEntry top = dacNotes_[gate].top(priority);
+      updateDac(gate, top.note, top.velocity);
+    }
+  }
+
   void setCcValue(uint8_t cc, uint8_t value) {
     ccValues_[cc] = value;
     for (int g = 0; g < kNumGates; g++) {
@@ -121,6 +253,8 @@ class MidiEngine {
   }
 
   void noteOn(int16_t channel, int16_t note, float velocity) {
+    if (channel < 0 || channel > 15 || note < 0 || note > 127)
+      return;
     if (velocity <= 0.f) {
       noteOff(channel, note);
       return;
@@ -132,33 +266,37 @@ class MidiEngine {
       bool gateChMatch = (gateChannel_[g] == -1) || (gateChannel_[g] == channel);
       bool gateNoteMatch = (gateNote_[g] == -1) || (gateNote_[g] == note);
       if (gateChMatch && gateNoteMatch) {
-        gateStacks_[g].push(channel, note, vel);
+        gateNotes_[g].push(channel, note, vel);
         gateMask_ |= (1 << g);
       }
 
       bool dacChMatch = (dacChannel_[g] == -1) || (dacChannel_[g] == channel);
       if (dacChMatch) {
-        noteStacks_[g].push(channel, note, vel);
-        updateDac(g, note, vel);
+        dacNotes_[g].push(channel, note, vel);
+        NoteEntry top = dacNotes_[g].top(notePriority_[g]);
+        updateDac(g, top.note, top.velocity);
       }
     }
   }
 
   void noteOff(int16_t channel, int16_t note) {
+    if (channel < 0 || channel > 15 || note < 0 || note > 127)
+      return;
     for (int g = 0; g < kNumGates; g++) {
       bool gateChMatch = (gateChannel_[g] == -1) || (gateChannel_[g] == channel);
       bool gateNoteMatch = (gateNote_[g] == -1) || (gateNote_[g] == note);
       if (gateChMatch && gateNoteMatch) {
-        gateStacks_[g].remove(channel, note);
-        if (gateStacks_[g].empty())
+        gateNotes_[g].remove(channel, note);
+        if (gateNotes_[g].empty())
           gateMask_ &= ~(1 << g);
       }
 
       bool dacChMatch = (dacChannel_[g] == -1) || (dacChannel_[g] == channel);
       if (dacChMatch) {
-        noteStacks_[g].remove(channel, note);
-        if (!noteStacks_[g].empty()) {
-          updateDac(g, noteStacks_[g].top().note, noteStacks_[g].top().velocity);
+        dacNotes_[g].remove(channel, note);
+        if (!dacNotes_[g].empty()) {
+          NoteEntry top = dacNotes_[g].top(notePriority_[g]);
+          updateDac(g, top.note, top.velocity);
         } else if (dacMode_[g] == kDacVelocity) {
           dacValues_[g] = 0;
         }
@@ -177,9 +315,25 @@ class MidiEngine {
 
   bool dacChanged() const { return memcmp(dacValues_, prevDacValues_, sizeof(dacValues_)) != 0; }
 
-  void markSent() {
+  uint8_t dacChangedMask() const {
+    uint8_t mask = 0;
+    for (int g = 0; g < kNumGates; g++) {
+      if (dacValues_[g] != prevDacValues_[g])
+        mask |= (1 << g);
+    }
+    return mask;
+  }
+
+  // Gates whose on/off state differs from what was last sent
+  uint8_t gateEdges() const { return gateMask_ ^ prevGateMask_; }
+
+  // DACs outside dacMask were held back and still count as changed
+  void markSent(uint8_t dacMask = 0xFF) {
     prevGateMask_ = gateMask_;
-    memcpy(prevDacValues_, dacValues_, sizeof(dacValues_));
+    for (int g = 0; g < kNumGates; g++) {
+      if ((dacMask >> g) & 1)
+        prevDacValues_[g] = dacValues_[g];
+    }
   }
 
   bool hasPitchMode() const {
@@ -193,7 +347,7 @@ class MidiEngine {
   void clearGateRuntime(int gate) {
     if (gate < 0 || gate >= kNumGates)
       return;
-    gateStacks_[gate].count = 0;
+    gateNotes_[gate].clear();
     gateMask_ &= ~(1 << gate);
   }
 
@@ -203,8 +357,8 @@ class MidiEngine {
     memset(dacValues_, 0, sizeof(dacValues_));
     memset(prevDacValues_, 0, sizeof(prevDacValues_));
     for (int i = 0; i < kNumGates; i++) {
-      gateStacks_[i].count = 0;
-      noteStacks_[i].count = 0;
+      gateNotes_[i].clear();
+      dacNotes_[i].clear();
     }
   }
 
@@ -216,11 +370,15 @@ class MidiEngine {
       dacMode_[i] = kDacVelocity;
       dacChannel_[i] = -1;
       ccNum_[i] = 1;
+      notePriority_[i] = kPriorityLast;
     }
     memset(ccValues_, 0, sizeof(ccValues_));
   }
 
   static constexpr int kStateWordsPerGate = 5;
+  // The per-gate words, then one note priority per gate. Priorities came
+  // later; appending them keeps older states readable.
+  static constexpr int kStateWords = kNumGates * (kStateWordsPerGate + 1);
 
   void serialize(int32_t* out) const {
     for (int i = 0; i < kNumGates; i++) {
@@ -230,6 +388,8 @@ class MidiEngine {
       *out++ = dacChannel_[i];
       *out++ = ccNum_[i];
     }
+    for (int i = 0; i < kNumGates; i++)
+      *out++ = notePriority_[i];
   }
 
   void deserialize(const int32_t* in) {
@@ -264,6 +424,43 @@ class MidiEngine {
       dacChannel_[i] = (int8_t)dCh;
       ccNum_[i] = (uint8_t)ccN;
     }
+    for (int i = 0; i < kNumGates; i++) {
+      int32_t priority = *in++;
+      notePriority_[i] = (priority < 0 || priority >= kPriorityCount) ? (uint8_t)kPriorityLast : (uint8_t)priority;
+    }
+  }
+
+  // Loads a state written by serialize() or by an older version that stopped
+  // short of it. readWord(int32_t&) returns false once the state runs out.
+  // Gates the state doesn't reach keep their settings, missing DAC channels
+  // and CC numbers mean -1 and 1, and missing priorities mean last-note.
+  template <typename ReadWord>
+  void readState(ReadWord&& readWord) {
+    int32_t buf[kStateWords];
+    serialize(buf);
+    for (int i = 0; i < kNumGates; i++) {
+      int32_t ch, note, mode;
+      int32_t dCh = -1, ccN = 1;
+      if (!readWord(ch) || !readWord(note) || !readWord(mode))
+        break;
+      if (!readWord(dCh))
+        dCh = -1;
+      else if (!readWord(ccN))
+        ccN = 1;
+      int32_t* gate = &buf[i * kStateWordsPerGate];
+      gate[0] = ch;
+      gate[1] = note;
+      gate[2] = mode;
+      gate[3] = dCh;
+      gate[4] = ccN;
+    }
+    for (int i = 0; i < kNumGates; i++) {
+      int32_t priority = kPriorityLast;
+      if (!readWord(priority))
+        priority = kPriorityLast;
+      buf[kNumGates * kStateWordsPerGate + i] = priority;
+    }
+    deserialize(buf);
   }
 
   static const uint16_t pitchLookup[61];
@@ -276,8 +473,10 @@ class MidiEngine {
   uint8_t ccNum_[kNumGates];
   uint8_t ccValues_[128];
 
-  NoteStack gateStacks_[kNumGates];
-  NoteStack noteStacks_[kNumGates];
+  uint8_t notePriority_[kNumGates];
+
+  NoteSet gateNotes_[kNumGates];
+  NoteSet dacNotes_[kNumGates];
   uint8_t gateMask_;
   uint16_t dacValues_[kNumGates];
   uint8_t prevGateMask_;
@@ -0,0 +1,65 @@
+#include "midi_sender.h"
+
+#include <chrono>
+#include <utility>
+
+namespace tram8 {
+
+MidiSender::MidiSender(FrameQueue& queue, Sink sink, Clock now)
+    : queue_(queue), sink_(std::move(sink)), now_(std::move(now)) {}
+
+MidiSender::~MidiSender() {
+  stop();
+}
+
+void MidiSender::start() {
+  if (running_.exchange(true))
+    return;
+  thread_ = std::thread([this] { run(); });
+}
+
+void MidiSender::stop() {
+  if (!running_.exchange(false))
+    return;
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void MidiSender::dropAll() {
+  uint32_t n = queue_.size();
+  queue_.pop(n);
+  dropped_.fetch_add(n, std::memory_order_relaxed);
+  resync_.store(true, std::memory_order_release);
+}
+
+uint32_t MidiSender::service() {
+  const Frame* first = queue_.peek(0);
+  if (!first)
+    return 0;
+  if (first->hostNanos + kStaleNanos < now_()) {
+    dropAll();
+    return 0;
+  }
+
+  const Frame* batch[kMaxBatch];
+  uint32_t count = 0;
+  while (count < kMaxBatch && (batch[count] = queue_.peek(count)))
+    count++;
+
+  if (!sink_(batch, count)) {
+    dropAll();
+    return 0;
+  }
+  queue_.pop(count);
+  sent_.fetch_add(count, std::memory_order_relaxed);
+  return count;
+}
+
+void MidiSender::run() {
+  while (running_.load(std::memory_order_acquire)) {
+    if (service() == 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(kPollMicros));
+  }
+}
+
+} // namespace tram8
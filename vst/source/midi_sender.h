@@ -0,0 +1,60 @@
+#pragma once
+
+#include "frame_queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace tram8 {
+
+// Drains a FrameQueue on its own thread so a stalled MIDI driver never
+// stalls process(). Frames go out in batches of up to kMaxBatch per sink
+// call, in queue order.
+//
+// Frames are diffs against the one before, so the sender never drops one on
+// its own: when a backlog has gone stale or the sink fails, everything
+// queued is dropped and a resync is requested, and the producer's next
+// frame is absolute.
+class MidiSender {
+ public:
+  static constexpr uint32_t kMaxBatch = 16;
+  static constexpr uint64_t kStaleNanos = 100000000ull; // frame due this long ago
+  static constexpr int kPollMicros = 500; // idle wait; no wakeup from the audio thread
+
+  // Sends count frames; false drops them
+  using Sink = std::function<bool(const Frame* const* frames, uint32_t count)>;
+  using Clock = std::function<uint64_t()>;
+
+  MidiSender(FrameQueue& queue, Sink sink, Clock now);
+  ~MidiSender();
+
+  void start();
+  void stop();
+
+  // One drain pass, as the thread runs it. Returns frames handed to the sink.
+  uint32_t service();
+
+  // Producer side: true once after frames were dropped
+  bool takeResync() { return resync_.exchange(false, std::memory_order_acq_rel); }
+  bool resyncPending() const { return resync_.load(std::memory_order_acquire); }
+
+  uint64_t sent() const { return sent_.load(std::memory_order_relaxed); }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  FrameQueue& queue_;
+  Sink sink_;
+  Clock now_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> resync_{false};
+  std::atomic<uint64_t> sent_{0};
+  std::atomic<uint64_t> dropped_{0};
+
+  void dropAll();
+  void run();
+};
+
+} // namespace tram8
@@ -51,7 +51,7 @@ class PlugView : public Steinberg::IPlugView {
 
   void resizeTo(int width, int height);
   void flashMidiInput();
-  void flashMidiOutput();
+  void flashMidiOutput(double backlogMs);
 
  private:
   std::atomic<Steinberg::uint32> refCount = 1;
@@ -75,6 +75,18 @@ class PlugView;
     return;
   }
 
+  if ([type isEqualToString:@"setNotePriority"]) {
+    int gate = [body[@"gate"] intValue];
+    int priority = [body[@"priority"] intValue];
+    double norm = priority / (double)(tram8::kPriorityCount - 1);
+    ParamID pid = tram8::kNotePriorityBase + gate;
+    _controller->beginEdit(pid);
+    _controller->performEdit(pid, norm);
+    _controller->setParamNormalized(pid, norm);
+    _controller->endEdit(pid);
+    return;
+  }
+
   if ([type isEqualToString:@"setDacChannel"]) {
     int gate = [body[@"gate"] intValue];
     int channel = [body[@"channel"] intValue];
@@ -111,6 +123,17 @@ class PlugView;
     return;
   }
 
+  if ([type isEqualToString:@"setLogLevel"]) {
+    int level = [body[@"level"] intValue];
+    if (auto* msg = _controller->allocateMessage()) {
+      msg->setMessageID("SetLogLevel");
+      msg->getAttributes()->setInt("level", (Steinberg::int64)level);
+      _controller->sendMessage(msg);
+      msg->release();
+    }
+    return;
+  }
+
   if ([type isEqualToString:@"resize"]) {
     int height = [body[@"height"] intValue];
     NSLog(@"tram8+: JS resize request height=%d", height);
@@ -161,8 +184,11 @@ class PlugView;
     double ccNorm = _controller->getParamNormalized(tram8::kCcNumBase + i);
     int ccN = (int)(ccNorm * 127 + 0.5);
 
-    NSString* js =
-        [NSString stringWithFormat:@"tram8.setGateState(%d, %d, %d, %d, %d, %d)", i, channel, note, mode, dacCh, ccN];
+    double priorityNorm = _controller->getParamNormalized(tram8::kNotePriorityBase + i);
+    int priority = (int)(priorityNorm * (tram8::kPriorityCount - 1) + 0.5);
+
+    NSString* js = [NSString
+        stringWithFormat:@"tram8.setGateState(%d, %d, %d, %d, %d, %d, %d)", i, channel, note, mode, dacCh, ccN, priority];
     [_webView evaluateJavaScript:js completionHandler:nil];
   }
 }
@@ -322,11 +348,12 @@ void PlugView::flashMidiInput() {
   }
 }
 
-void PlugView::flashMidiOutput() {
+void PlugView::flashMidiOutput(double backlogMs) {
   WKWebView* wv = webView;
   if (wv) {
+    NSString* js = [NSString stringWithFormat:@"tram8.flashOutput(%.1f)", backlogMs];
     dispatch_async(dispatch_get_main_queue(), ^{
-      [wv evaluateJavaScript:@"tram8.flashOutput()" completionHandler:nil];
+      [wv evaluateJavaScript:js completionHandler:nil];
     });
   }
 }
@@ -5,14 +5,24 @@
 #include "pluginterfaces/vst/ivstevents.h"
 #include "pluginterfaces/vst/ivstparameterchanges.h"
 
+#include <chrono>
 #include <cstring>
 
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
 using namespace Steinberg;
 using namespace Steinberg::Vst;
 
 namespace tram8 {
 
-Processor::Processor() {
+Processor::Processor()
+    : sender_(
+          queue_,
+          [this](const Frame* const* frames, uint32_t count) { return sendFrames(frames, count); },
+          [this] { return nowNanos(); }),
+      log_([this](const char* line) { os_log(logger, "%{public}s", line); }) {
   setControllerClass(kControllerUID);
 }
 
@@ -31,10 +41,14 @@ tresult PLUGIN_API Processor::initialize(FUnknown* context) {
 
   engine_.reset();
   openMidiOutput();
+  sender_.start();
+  log_.start();
   return kResultOk;
 }
 
 tresult PLUGIN_API Processor::terminate() {
+  sender_.stop();
+  log_.stop();
   closeMidiOutput();
   return AudioEffect::terminate();
 }
@@ -94,6 +108,10 @@ tresult PLUGIN_API Processor::process(ProcessData& data) {
         int gate = id - kCcNumBase;
         int step = (int)(value * 127 + 0.5);
         engine_.setCcNum(gate, (uint8_t)step);
+      } else if (id >= kNotePriorityBase && id < kNotePriorityBase + kNumGates) {
+        int gate = id - kNotePriorityBase;
+        int step = (int)(value * (kPriorityCount - 1) + 0.5);
+        engine_.setNotePriority(gate, (uint8_t)step);
       } else if (id >= kCcValueBase && id < kCcValueBase + 128) {
         int cc = id - kCcValueBase;
         engine_.setCcValue((uint8_t)cc, (uint8_t)(value * 127 + 0.5));
@@ -111,31 +129,57 @@ tresult PLUGIN_API Processor::process(ProcessData& data) {
   int32 eventCount = data.inputEvents ? data.inputEvents->getEventCount() : 0;
   hadInput = eventCount > 0;
 
+  const ProcessContext* context = data.processContext;
+  clock_.begin(context && (context->state & ProcessContext::kSystemTimeValid),
+               context ? context->systemTime : 0,
+               nowNanos(),
+               processSetup.sampleRate);
+
+  // Events arrive sorted by sampleOffset. The state reached at each offset
+  // goes out stamped with that offset's time, so CV moves where the notes
+  // are rather than on block boundaries.
+  bool hadOutput = false;
+  int32 segment = 0;
+  int32 lastSample = data.numSamples > 0 ? data.numSamples - 1 : 0;
   for (int32 i = 0; i < eventCount; i++) {
     Event e;
     if (data.inputEvents->getEvent(i, e) != kResultOk)
       continue;
 
+    int32 offset = e.sampleOffset > lastSample ? lastSample : e.sampleOffset;
+    if (offset < segment)
+      offset = segment;
+    if (offset != segment) {
+      if (outputPending()) {
+        sendState(clock_.at(segment));
+        hadOutput = true;
+      }
+      segment = offset;
+    }
+
     if (e.type == Event::kNoteOnEvent) {
-      os_log(logger, "note on: ch=%d note=%d vel=%.3f", e.noteOn.channel, e.noteOn.pitch, e.noteOn.velocity);
+      log_.noteOn(clock_.at(offset), e.noteOn.channel, e.noteOn.pitch, e.noteOn.velocity);
       engine_.noteOn(e.noteOn.channel, e.noteOn.pitch, e.noteOn.velocity);
     } else if (e.type == Event::kNoteOffEvent) {
-      os_log(logger, "note off: ch=%d note=%d", e.noteOff.channel, e.noteOff.pitch);
+      log_.noteOff(clock_.at(offset), e.noteOff.channel, e.noteOff.pitch);
       engine_.noteOff(e.noteOff.channel, e.noteOff.pitch);
     }
   }
 
-  bool hadOutput = engine_.stateChanged();
-  if (hadOutput)
-    sendState();
+  if (outputPending()) {
+    sendState(clock_.at(segment));
+    hadOutput = true;
+  }
 
   if (hadInput || hadOutput) {
     if (auto* msg = allocateMessage()) {
       msg->setMessageID("MidiActivity");
       if (hadInput)
         msg->getAttributes()->setInt("input", 1);
-      if (hadOutput)
+      if (hadOutput) {
         msg->getAttributes()->setInt("output", 1);
+        msg->getAttributes()->setFloat("backlogMs", wire_.backlogMillis(clock_.at(data.numSamples)));
+      }
       sendMessage(msg);
       msg->release();
     }
@@ -151,6 +195,7 @@ tresult PLUGIN_API Processor::notify(IMessage* message) {
   if (strcmp(message->getMessageID(), "SetMIDIPort") == 0) {
     int64 index = -1;
     if (message->getAttributes()->getInt("index", index) == kResultOk) {
+      resyncOutput_ = true;
       if (index < 0) {
         midiDest = 0;
         os_log(logger, "MIDI output: none");
@@ -165,13 +210,22 @@ tresult PLUGIN_API Processor::notify(IMessage* message) {
     return kResultOk;
   }
 
+  if (strcmp(message->getMessageID(), "SetLogLevel") == 0) {
+    int64 level = kLogOff;
+    if (message->getAttributes()->getInt("level", level) == kResultOk) {
+      log_.setLevel((int)level);
+      os_log(logger, "log level: %d", log_.level());
+    }
+    return kResultOk;
+  }
+
   return AudioEffect::notify(message);
 }
 
 tresult PLUGIN_API Processor::getState(IBStream* state) {
   if (!state)
     return kResultFalse;
-  int32_t buf[kNumGates * MidiEngine::kStateWordsPerGate];
+  int32_t buf[MidiEngine::kStateWords];
   engine_.serialize(buf);
   return state->write(buf, sizeof(buf)) == kResultOk ? kResultOk : kResultFalse;
 }
@@ -179,71 +233,74 @@ tresult PLUGIN_API Processor::getState(IBStream* state) {
 tresult PLUGIN_API Processor::setState(IBStream* state) {
   if (!state)
     return kResultFalse;
-  int32_t buf[kNumGates * MidiEngine::kStateWordsPerGate];
-  engine_.serialize(buf);
+  // At the end of the stream read() still returns kResultOk, with nothing read
+  engine_.readState([state](int32_t& word) {
+    int32 numBytesRead = 0;
+    return state->read(&word, sizeof(word), &numBytesRead) == kResultOk && numBytesRead == sizeof(word);
+  });
+  return kResultOk;
+}
 
-  for (int i = 0; i < kNumGates; i++) {
-    int32_t ch, note, mode;
-    int32_t dCh = -1, ccN = 1;
-    if (state->read(&ch, sizeof(ch)) != kResultOk)
-      break;
-    if (state->read(&note, sizeof(note)) != kResultOk)
-      break;
-    if (state->read(&mode, sizeof(mode)) != kResultOk)
-      break;
-    if (state->read(&dCh, sizeof(dCh)) != kResultOk) {
-      dCh = -1;
-      ccN = 1;
-    } else if (state->read(&ccN, sizeof(ccN)) != kResultOk) {
-      ccN = 1;
-    }
+// A change the queue had no room for, or that the wire budget held back,
+// stays pending and goes out merged into the next frame. A resync after
+// dropped frames resends everything.
+bool Processor::outputPending() {
+  return engine_.stateChanged() || resyncOutput_.load() || sender_.resyncPending();
+}
 
-    int off = i * MidiEngine::kStateWordsPerGate;
-    buf[off + 0] = ch;
-    buf[off + 1] = note;
-    buf[off + 2] = mode;
-    buf[off + 3] = dCh;
-    buf[off + 4] = ccN;
+void Processor::sendState(uint64_t hostNanos) {
+  if (!midiDest)
+    return;
+  bool immediate = hostNanos == 0;
+  if (immediate)
+    hostNanos = nowNanos();
+  if (hostNanos < lastQueuedNanos_)
+    hostNanos = lastQueuedNanos_;
+
+  // A dense clip can produce more than 3,125 bytes/s. Once the wire is
+  // behind, DAC refinements wait and merge into a later frame; gate edges
+  // still go, with the CV of the gates that moved so notes land in tune.
+  // Past the limit everything waits, which keeps latency bounded.
+  uint8_t dacMask = 0xFF;
+  uint64_t backlog = wire_.backlog(hostNanos);
+  if (!immediate && backlog > WireBudget::kRefineNanos) {
+    uint8_t edges = engine_.gateEdges();
+    if (!edges || backlog > WireBudget::kMaxBacklogNanos) {
+      log_.deferred(hostNanos, backlog);
+      return;
+    }
+    dacMask = edges;
   }
 
-  engine_.deserialize(buf);
-  return kResultOk;
-}
-
-void Processor::sendState() {
-  tram8_form_t form = TRAM8_FORM_GATES;
-  if (engine_.dacChanged() && engine_.hasPitchMode()) {
-    form = TRAM8_FORM_FULL;
-  } else if (engine_.dacChanged()) {
-    form = TRAM8_FORM_COARSE;
+  bool resync = resyncOutput_.exchange(false);
+  if (sender_.takeResync()) {
+    resync = true;
+    wire_.reset(); // the dropped frames never reached the wire
   }
+  if (resync)
+    encoder_.resync();
 
   uint16_t dac12[kNumGates];
   for (int i = 0; i < kNumGates; i++)
     dac12[i] = engine_.dacValues()[i] >> 2;
 
-  uint8_t buf[TRAM8_LEN_FULL];
-  uint8_t len = tram8_pack(buf, engine_.gateMask(), dac12, form);
-
-  static const char* formNames[] = {"gates", "coarse", "full"};
-  os_log(logger,
-         "send [%{public}s %dB] gates=0x%02X dac=[%u %u %u %u %u %u %u %u]",
-         formNames[form],
-         len,
-         engine_.gateMask(),
-         dac12[0],
-         dac12[1],
-         dac12[2],
-         dac12[3],
-         dac12[4],
-         dac12[5],
-         dac12[6],
-         dac12[7]);
-
-  if (!sendBytes(buf, len))
-    return;
+  uint8_t buf[Encoder::kMaxBytes];
+  uint32_t len = encoder_.encode(engine_.gateMask(), dac12, engine_.hasPitchMode(), buf, dacMask);
+
+  if (len > 0) {
+    if (!queue_.push(buf, len, hostNanos)) {
+      log_.queueFull(hostNanos);
+      if (resync)
+        resyncOutput_ = true; // still owed once there is room
+      return;
+    }
+    lastQueuedNanos_ = hostNanos;
+    wire_.commit(hostNanos, len);
+    log_.send(hostNanos, (uint8_t)encoder_.encoding(), (uint8_t)len, engine_.gateMask(), dac12);
+  }
 
-  engine_.markSent();
+  encoder_.commit();
+  engine_.markSent(dacMask);
 }
 
 #ifdef __APPLE__
@@ -296,16 +353,48 @@ void Processor::closeMidiOutput() {
   midiDest = 0;
 }
 
-bool Processor::sendBytes(const uint8_t* data, uint32_t length) {
+static const mach_timebase_info_data_t& timebase() {
+  static const mach_timebase_info_data_t info = [] {
+    mach_timebase_info_data_t i{};
+    mach_timebase_info(&i);
+    return i;
+  }();
+  return info;
+}
+
+uint64_t Processor::nowNanos() const {
+  const auto& tb = timebase();
+  return (uint64_t)((__uint128_t)mach_absolute_time() * tb.numer / tb.denom);
+}
+
+// Sender thread. One packet per frame, scheduled on the mach host clock.
+// MIDIPacketListAdd appends to the previous packet when the timestamps match,
+// so a SysEx frame next to another frame with the same time goes out in a
+// list of its own rather than sharing a packet with voice messages.
+bool Processor::sendFrames(const Frame* const* frames, uint32_t count) {
   if (!midiOutPort || !midiDest)
     return false;
 
-  uint8_t buf[512];
+  const auto& tb = timebase();
+  uint8_t buf[MidiSender::kMaxBatch * (sizeof(MIDIPacket) + Encoder::kMaxBytes)];
   MIDIPacketList* packetList = (MIDIPacketList*)buf;
   MIDIPacket* packet = MIDIPacketListInit(packetList);
-  packet = MIDIPacketListAdd(packetList, sizeof(buf), packet, 0, length, data);
-  if (!packet)
-    return false;
+  MIDITimeStamp lastWhen = 0;
+  bool lastSysex = false;
+  for (uint32_t i = 0; i < count; i++) {
+    MIDITimeStamp when = (MIDITimeStamp)((__uint128_t)frames[i]->hostNanos * tb.denom / tb.numer);
+    bool sysex = frames[i]->bytes[0] == TRAM8_SYSEX_START;
+    if (packetList->numPackets && when == lastWhen && (sysex || lastSysex)) {
+      if (MIDISend(midiOutPort, midiDest, packetList) != noErr)
+        return false;
+      packet = MIDIPacketListInit(packetList);
+    }
+    packet = MIDIPacketListAdd(packetList, sizeof(buf), packet, when, frames[i]->length, frames[i]->bytes);
+    if (!packet)
+      return false;
+    lastWhen = when;
+    lastSysex = sysex;
+  }
 
   return MIDISend(midiOutPort, midiDest, packetList) == noErr;
 }
@@ -313,7 +402,12 @@ bool Processor::sendBytes(const uint8_t* data, uint32_t length) {
 #else
 void Processor::openMidiOutput() {}
 void Processor::closeMidiOutput() {}
-bool Processor::sendBytes(const uint8_t*, uint32_t) {
+uint64_t Processor::nowNanos() const {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+bool Processor::sendFrames(const Frame* const*, uint32_t) {
   return false;
 }
 #endif
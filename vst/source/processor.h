@@ -1,6 +1,12 @@
 #pragma once
 
+#include "block_clock.h"
+#include "encoder.h"
+#include "frame_queue.h"
 #include "midi_engine.h"
+#include "midi_sender.h"
+#include "rt_log.h"
+#include "wire_budget.h"
 #include "public.sdk/source/vst/vstaudioeffect.h"
 
 #include <atomic>
@@ -35,8 +41,25 @@ class Processor : public Steinberg::Vst::AudioEffect {
 
  private:
   MidiEngine engine_;
+  Encoder encoder_;
+  BlockClock clock_;
+  std::atomic<bool> resyncOutput_{true};
 
-  void sendState();
+  // Encoded frames wait here for the sender thread; process() never calls
+  // into CoreMIDI itself
+  FrameQueue queue_;
+  MidiSender sender_;
+  uint64_t lastQueuedNanos_ = 0; // packet times must not go backwards
+  WireBudget wire_; // DIN time the queued frames will take
+
+  // process() logs through this ring; its thread does the formatting
+  RtLog log_;
+
+  // hostNanos 0 sends at once whatever the wire budget; otherwise the frame
+  // is scheduled for that time on the host clock (see BlockClock) and may be
+  // held back while the wire is behind (see WireBudget)
+  void sendState(uint64_t hostNanos = 0);
+  bool outputPending();
 
 #ifdef __APPLE__
   MIDIClientRef midiClient = 0;
@@ -47,7 +70,8 @@ class Processor : public Steinberg::Vst::AudioEffect {
 
   void openMidiOutput();
   void closeMidiOutput();
-  bool sendBytes(const uint8_t* data, uint32_t length);
+  uint64_t nowNanos() const;
+  bool sendFrames(const Frame* const* frames, uint32_t count);
 };
 
 } // namespace tram8
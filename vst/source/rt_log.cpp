@@ -0,0 +1,124 @@
+#include "rt_log.h"
+
+#include "encoder.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace tram8 {
+
+void RtLog::send(uint64_t hostNanos, uint8_t encoding, uint8_t length, uint8_t gates, const uint16_t dac[kNumGates]) {
+  if (!enabled(kLogSends))
+    return;
+  LogRecord* r = claim();
+  if (!r)
+    return;
+  r->hostNanos = hostNanos;
+  r->type = kLogSend;
+  r->a = encoding;
+  r->b = length;
+  r->c = gates;
+  for (int i = 0; i < kNumGates; i++)
+    r->values[i] = dac[i];
+  publish();
+}
+
+void RtLog::queueFull(uint64_t hostNanos) {
+  if (!enabled(kLogSends))
+    return;
+  LogRecord* r = claim();
+  if (!r)
+    return;
+  r->hostNanos = hostNanos;
+  r->type = kLogQueueFull;
+  publish();
+}
+
+void RtLog::deferred(uint64_t hostNanos, uint64_t backlogNanos) {
+  if (!enabled(kLogSends))
+    return;
+  LogRecord* r = claim();
+  if (!r)
+    return;
+  r->hostNanos = hostNanos;
+  r->type = kLogDeferred;
+  uint64_t tenths = backlogNanos / 100000;
+  r->values[0] = (uint16_t)(tenths > 0xFFFF ? 0xFFFF : tenths);
+  publish();
+}
+
+int RtLog::format(const LogRecord& r, char* out, size_t size) {
+  static const char* encodingNames[kEncodingCount] = {"gates", "coarse", "full", "delta", "voice"};
+  // host clock milliseconds, enough to line records up against each other
+  double ms = (double)(r.hostNanos % 1000000000000ull) / 1e6;
+
+  switch (r.type) {
+    case kLogNoteOn:
+      return snprintf(out, size, "[%.3f] note on: ch=%u note=%u vel=%.3f", ms, r.a, r.b, r.c / 127.0);
+    case kLogNoteOff:
+      return snprintf(out, size, "[%.3f] note off: ch=%u note=%u", ms, r.a, r.b);
+    case kLogSend:
+      return snprintf(out,
+                      size,
+                      "[%.3f] send [%s %uB] gates=0x%02X dac=[%u %u %u %u %u %u %u %u]",
+                      ms,
+                      r.a < kEncodingCount ? encodingNames[r.a] : "?",
+                      r.b,
+                      r.c,
+                      r.values[0],
+                      r.values[1],
+                      r.values[2],
+                      r.values[3],
+                      r.values[4],
+                      r.values[5],
+                      r.values[6],
+                      r.values[7]);
+    case kLogQueueFull:
+      return snprintf(out, size, "[%.3f] send queue full, change held for the next frame", ms);
+    case kLogDeferred:
+      return snprintf(out, size, "[%.3f] wire %.1f ms behind, change held for the next frame", ms, r.values[0] / 10.0);
+    default:
+      return snprintf(out, size, "[%.3f] unknown record %u", ms, r.type);
+  }
+}
+
+uint32_t RtLog::flush() {
+  char line[kLineSize];
+  uint32_t count = 0;
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  while (tail != head_.load(std::memory_order_acquire)) {
+    format(records_[tail & (kCapacity - 1)], line, sizeof(line));
+    tail_.store(++tail, std::memory_order_release);
+    sink_(line);
+    count++;
+  }
+
+  uint64_t drops = dropped();
+  if (drops != reportedDrops_) {
+    snprintf(line, sizeof(line), "log ring full, %llu records dropped", (unsigned long long)(drops - reportedDrops_));
+    reportedDrops_ = drops;
+    sink_(line);
+  }
+  return count;
+}
+
+void RtLog::start() {
+  if (running_.exchange(true))
+    return;
+  thread_ = std::thread([this] {
+    while (running_.load(std::memory_order_acquire)) {
+      flush();
+      std::this_thread::sleep_for(std::chrono::milliseconds(kPollMillis));
+    }
+    flush();
+  });
+}
+
+void RtLog::stop() {
+  if (!running_.exchange(false))
+    return;
+  if (thread_.joinable())
+    thread_.join();
+}
+
+} // namespace tram8
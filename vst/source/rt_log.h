@@ -0,0 +1,120 @@
+#pragma once
+
+#include "midi_engine.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace tram8 {
+
+enum LogLevel {
+  kLogOff = 0,
+  kLogSends = 1, // frames sent, refused and held back
+  kLogEvents = 2, // plus every note on/off
+  kLogLevelCount = 3,
+};
+
+enum LogType : uint8_t {
+  kLogNoteOn,
+  kLogNoteOff,
+  kLogSend,
+  kLogQueueFull,
+  kLogDeferred,
+};
+
+// Fixed-size binary record; the meaning of a-c and values depends on type
+struct LogRecord {
+  uint64_t hostNanos = 0;
+  uint8_t type = 0;
+  uint8_t a = 0; // note: channel; send: encoding
+  uint8_t b = 0; // note: pitch;   send: length
+  uint8_t c = 0; // note: velocity 0-127; send: gate mask
+  uint16_t values[kNumGates] = {}; // send: 12-bit DACs; deferred: backlog in 0.1 ms
+};
+
+// Real-time-safe logging. The audio thread copies records into a
+// preallocated ring without locks or formatting; a background thread turns
+// them into text for the sink. When a record's level is off the call costs
+// one relaxed load. A full ring drops records and says how many.
+class RtLog {
+ public:
+  static constexpr uint32_t kCapacity = 1024; // power of two, 32 KB
+  static constexpr int kPollMillis = 10;
+  static constexpr size_t kLineSize = 128;
+
+  using Sink = std::function<void(const char* line)>;
+
+  explicit RtLog(Sink sink) : sink_(std::move(sink)) {}
+  ~RtLog() { stop(); }
+
+  void setLevel(int level) {
+    level_.store(level < kLogOff ? kLogOff : (level >= kLogLevelCount ? kLogLevelCount - 1 : level),
+                 std::memory_order_relaxed);
+  }
+  int level() const { return level_.load(std::memory_order_relaxed); }
+  bool enabled(LogLevel level) const { return level_.load(std::memory_order_relaxed) >= level; }
+
+  // Producer side, wait-free
+  void noteOn(uint64_t hostNanos, int16_t channel, int16_t pitch, float velocity) {
+    if (!enabled(kLogEvents))
+      return;
+    float v = velocity < 0.f ? 0.f : (velocity > 1.f ? 1.f : velocity);
+    note(hostNanos, kLogNoteOn, channel, pitch, (uint8_t)(v * 127.f + 0.5f));
+  }
+  void noteOff(uint64_t hostNanos, int16_t channel, int16_t pitch) {
+    if (!enabled(kLogEvents))
+      return;
+    note(hostNanos, kLogNoteOff, channel, pitch, 0);
+  }
+  void send(uint64_t hostNanos, uint8_t encoding, uint8_t length, uint8_t gates, const uint16_t dac[kNumGates]);
+  void queueFull(uint64_t hostNanos);
+  void deferred(uint64_t hostNanos, uint64_t backlogNanos);
+
+  // Consumer side
+  void start();
+  void stop();
+  uint32_t flush(); // formats and emits every waiting record, returns the count
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  static int format(const LogRecord& r, char* out, size_t size);
+
+ private:
+  Sink sink_;
+  std::atomic<int> level_{kLogOff};
+  LogRecord records_[kCapacity];
+  alignas(64) std::atomic<uint32_t> head_{0};
+  alignas(64) std::atomic<uint32_t> tail_{0};
+  std::atomic<uint64_t> dropped_{0};
+  uint64_t reportedDrops_ = 0;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+
+  void note(uint64_t hostNanos, uint8_t type, int16_t channel, int16_t pitch, uint8_t velocity) {
+    LogRecord* r = claim();
+    if (!r)
+      return;
+    r->hostNanos = hostNanos;
+    r->type = type;
+    r->a = (uint8_t)channel;
+    r->b = (uint8_t)pitch;
+    r->c = velocity;
+    publish();
+  }
+
+  // Slot for the next record, nullptr (counted as dropped) when full
+  LogRecord* claim() {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == kCapacity) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &records_[head & (kCapacity - 1)];
+  }
+  void publish() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+};
+
+} // namespace tram8
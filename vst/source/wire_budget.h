@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../../protocol/tram8_sysex.h"
+
+#include <cstdint>
+
+namespace tram8 {
+
+// Tracks how much wire time the frames already handed to the sender will
+// take on the 31,250-baud DIN link. Each byte occupies TRAM8_BYTE_US; a frame
+// starts at its timestamp or when the previous one finishes, whichever is
+// later. backlog() is how far behind real time the link is running, so the
+// caller can merge state into later frames instead of letting the excess
+// queue up in CoreMIDI.
+class WireBudget {
+ public:
+  static constexpr uint64_t kByteNanos = TRAM8_BYTE_US * 1000ull;
+  // Up to this much backlog every change goes out as soon as it happens
+  static constexpr uint64_t kRefineNanos = 5000000ull;
+  // Past kRefineNanos only gate edges (and their own CV) go out; past this
+  // nothing does, which bounds latency at about this plus one frame
+  static constexpr uint64_t kMaxBacklogNanos = 20000000ull;
+
+  static uint64_t cost(uint32_t bytes) { return bytes * kByteNanos; }
+
+  // Wire time still owed at hostNanos
+  uint64_t backlog(uint64_t hostNanos) const { return busyUntil_ > hostNanos ? busyUntil_ - hostNanos : 0; }
+  double backlogMillis(uint64_t hostNanos) const { return backlog(hostNanos) / 1e6; }
+
+  void commit(uint64_t hostNanos, uint32_t bytes) {
+    busyUntil_ = (busyUntil_ > hostNanos ? busyUntil_ : hostNanos) + cost(bytes);
+  }
+
+  // After a stall the link is idle again; forget what was committed
+  void reset() { busyUntil_ = 0; }
+
+ private:
+  uint64_t busyUntil_ = 0;
+};
+
+} // namespace tram8
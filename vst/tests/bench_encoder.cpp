@@ -0,0 +1,147 @@
+#include "../source/encoder.h"
+#include "../source/midi_engine.h"
+#include <cstdio>
+
+using namespace tram8;
+
+// Byte-count benchmark: replays note sequences through MidiEngine and totals
+// the wire bytes each encoder strategy would send for the resulting states.
+
+struct NoteEvent {
+  int16_t channel;
+  int16_t note;
+  float velocity; // 0 = note off
+};
+
+enum Strategy { kLegacy, kDeltaOnly, kHybrid, kStrategyCount };
+
+static const char* kStrategyNames[kStrategyCount] = {"form 1/2/3", "+delta", "hybrid"};
+
+// Pre-encoder sendState(): Form 1 unless a DAC moved, then Form 3 with pitch
+// mode or Form 2 without.
+static uint32_t legacyCost(const MidiEngine& engine, bool allowDelta) {
+  if (!engine.dacChanged())
+    return TRAM8_LEN_GATES;
+  uint32_t len = engine.hasPitchMode() ? TRAM8_LEN_FULL : TRAM8_LEN_COARSE;
+  if (allowDelta) {
+    uint32_t delta = tram8_delta_len(engine.dacChangedMask());
+    if (delta < len)
+      len = delta;
+  }
+  return len;
+}
+
+static void run(const char* name, MidiEngine& engine, const NoteEvent* events, int count) {
+  uint32_t total[kStrategyCount] = {};
+  Encoder encoder;
+  int sends = 0;
+
+  for (int i = 0; i < count; i++) {
+    const NoteEvent& e = events[i];
+    if (e.velocity > 0.f)
+      engine.noteOn(e.channel, e.note, e.velocity);
+    else
+      engine.noteOff(e.channel, e.note);
+
+    if (!engine.stateChanged())
+      continue;
+
+    uint16_t dac12[kNumGates];
+    for (int g = 0; g < kNumGates; g++)
+      dac12[g] = engine.dacValues()[g] >> 2;
+
+    uint8_t buf[Encoder::kMaxBytes];
+    total[kLegacy] += legacyCost(engine, false);
+    total[kDeltaOnly] += legacyCost(engine, true);
+    total[kHybrid] += encoder.encode(engine.gateMask(), dac12, engine.hasPitchMode(), buf);
+    encoder.commit();
+    engine.markSent();
+    sends++;
+  }
+
+  printf("%-14s %6d sends", name, sends);
+  for (int s = 0; s < kStrategyCount; s++)
+    printf("  %s %7u B", kStrategyNames[s], total[s]);
+  printf("  (%.2fx)\n", (double)total[kLegacy] / (double)total[kHybrid]);
+}
+
+// Monophonic bass line: gate 0 on any note, DAC 0 pitch, DAC 1 velocity
+static void benchMonoPitch() {
+  static NoteEvent events[4096];
+  static const int16_t kLine[] = {36, 36, 48, 36, 39, 41, 43, 46, 36, 36, 48, 51, 50, 48, 43, 41};
+  int n = 0;
+  for (int bar = 0; bar < 128; bar++) {
+    for (int16_t note : kLine) {
+      float vel = 0.5f + 0.03f * (float)(bar % 16);
+      events[n++] = {0, note, vel};
+      events[n++] = {0, note, 0.f};
+    }
+  }
+
+  MidiEngine engine;
+  engine.setGateNote(0, -1);
+  engine.setDacMode(0, kDacPitch);
+  engine.setDacMode(1, kDacVelocity);
+  for (int g = 2; g < kNumGates; g++)
+    engine.setDacMode(g, kDacOff);
+  run("mono pitch", engine, events, n);
+}
+
+// Drum pattern: one voice per channel, gate and velocity DAC per voice
+static void benchDrums() {
+  static NoteEvent events[8192];
+  static const uint8_t kPattern[16] = {0x05, 0x10, 0x14, 0x10, 0x07, 0x10, 0x34, 0x90,
+                                       0x05, 0x10, 0x14, 0x50, 0x07, 0x10, 0x34, 0xD0};
+  int n = 0;
+  for (int bar = 0; bar < 128; bar++) {
+    for (uint8_t hits : kPattern) {
+      for (int g = 0; g < kNumGates; g++) {
+        if ((hits >> g) & 1)
+          events[n++] = {(int16_t)g, 36, 0.4f + 0.07f * (float)g};
+      }
+      for (int g = 0; g < kNumGates; g++) {
+        if ((hits >> g) & 1)
+          events[n++] = {(int16_t)g, 36, 0.f};
+      }
+    }
+  }
+
+  MidiEngine engine;
+  for (int g = 0; g < kNumGates; g++) {
+    engine.setGateChannel(g, (int8_t)g);
+    engine.setGateNote(g, -1);
+    engine.setDacChannel(g, (int8_t)g);
+  }
+  run("drums", engine, events, n);
+}
+
+// Four-voice chords: gates 0-3 on any note per channel, pitch on DACs 0-3
+static void benchChords() {
+  static NoteEvent events[4096];
+  static const int16_t kChords[4][4] = {{36, 40, 43, 47}, {33, 36, 40, 43}, {29, 33, 36, 40}, {31, 35, 38, 41}};
+  int n = 0;
+  for (int bar = 0; bar < 128; bar++) {
+    const int16_t* chord = kChords[bar % 4];
+    for (int v = 0; v < 4; v++)
+      events[n++] = {(int16_t)v, chord[v], 0.8f};
+    for (int v = 0; v < 4; v++)
+      events[n++] = {(int16_t)v, chord[v], 0.f};
+  }
+
+  MidiEngine engine;
+  for (int g = 0; g < kNumGates; g++) {
+    engine.setGateChannel(g, g < 4 ? (int8_t)g : 15);
+    engine.setGateNote(g, -1);
+    engine.setDacChannel(g, g < 4 ? (int8_t)g : 15);
+    engine.setDacMode(g, g < 4 ? kDacPitch : kDacOff);
+  }
+  run("chords", engine, events, n);
+}
+
+int main() {
+  printf("Encoder byte-count benchmark\n\n");
+  benchMonoPitch();
+  benchDrums();
+  benchChords();
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include "../source/midi_sender.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace tram8;
+
+// Audio-thread cost of handing frames to the sender. A producer pushes
+// 20-byte frames at a fixed rate while the sender thread drains them into a
+// sink that sleeps like a slow MIDI driver. Reports push() time percentiles
+// and how often the queue refused a frame.
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t nowNanos() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct Scenario {
+  const char* name;
+  int framesPerMs; // producer rate
+  int sinkMicros; // time the sink takes per batch
+};
+
+static void run(const Scenario& s) {
+  FrameQueue queue;
+  uint64_t batches = 0;
+  MidiSender sender(
+      queue,
+      [&](const Frame* const*, uint32_t) {
+        batches++;
+        if (s.sinkMicros)
+          std::this_thread::sleep_for(std::chrono::microseconds(s.sinkMicros));
+        return true;
+      },
+      nowNanos);
+  sender.start();
+
+  const int ms = 500;
+  std::vector<uint32_t> pushNanos;
+  pushNanos.reserve((size_t)ms * s.framesPerMs);
+  uint32_t refused = 0;
+  uint8_t frame[TRAM8_LEN_FULL] = {0xF0};
+
+  auto start = Clock::now();
+  for (int t = 0; t < ms; t++) {
+    for (int i = 0; i < s.framesPerMs; i++) {
+      auto a = Clock::now();
+      bool ok = queue.push(frame, sizeof(frame), nowNanos());
+      auto b = Clock::now();
+      pushNanos.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count());
+      refused += !ok;
+    }
+    std::this_thread::sleep_until(start + std::chrono::milliseconds(t + 1));
+  }
+  while (queue.size())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  sender.stop();
+
+  std::sort(pushNanos.begin(), pushNanos.end());
+  size_t n = pushNanos.size();
+  printf("%-14s %6zu pushes  push p50 %4u ns  p99 %5u ns  max %6u ns  refused %5u  sent %6llu in %5llu batches\n",
+         s.name,
+         n,
+         pushNanos[n / 2],
+         pushNanos[n * 99 / 100],
+         pushNanos[n - 1],
+         refused,
+         (unsigned long long)sender.sent(),
+         (unsigned long long)batches);
+}
+
+int main() {
+  printf("MIDI sender benchmark (500 ms per scenario)\n\n");
+  const Scenario scenarios[] = {
+      {"light", 1, 0},
+      {"dense", 8, 0},
+      {"slow driver", 8, 2000},
+      {"stalled", 8, 20000},
+  };
+  for (const auto& s : scenarios)
+    run(s);
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include "../source/midi_engine.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace tram8;
+
+// Time per note on/off for the NoteSet against the fixed NoteStack it
+// replaced, over a few held-note patterns, then whole MidiEngine events
+// with all eight gates listening (two sets per gate per event).
+
+// The NoteStack MidiEngine used before NoteSet, kept here as the baseline
+struct NoteStack {
+  static constexpr int kMaxNotes = 16;
+  NoteEntry entries[kMaxNotes];
+  int count = 0;
+
+  void push(int16_t channel, int16_t note, uint8_t velocity) {
+    remove(channel, note);
+    if (count < kMaxNotes) {
+      entries[count].channel = channel;
+      entries[count].note = note;
+      entries[count].velocity = velocity;
+      count++;
+    }
+  }
+
+  void remove(int16_t channel, int16_t note) {
+    for (int i = 0; i < count; i++) {
+      if (entries[i].channel == channel && entries[i].note == note) {
+        for (int j = i; j < count - 1; j++)
+          entries[j] = entries[j + 1];
+        count--;
+        return;
+      }
+    }
+  }
+
+  NoteEntry top(uint8_t) const {
+    if (count <= 0)
+      return NoteEntry{};
+    return entries[count - 1];
+  }
+};
+
+using Clock = std::chrono::steady_clock;
+
+struct Op {
+  bool on;
+  int16_t channel;
+  int16_t note;
+};
+
+static const int kOps = 1 << 16;
+static Op ops[kOps];
+
+// held notes churn around a steady count: release the oldest, press a new one
+static void makeChurn(int held, int channels) {
+  int ring[NoteSet::kMaxHeld];
+  int head = 0, tail = 0;
+  for (int i = 0; i < kOps; i++) {
+    if (head - tail < held) {
+      int16_t ch = (int16_t)(rand() % channels);
+      int16_t n = (int16_t)(24 + rand() % 72);
+      ops[i] = {true, ch, n};
+      ring[head++ % NoteSet::kMaxHeld] = ch << 7 | n;
+    } else {
+      int k = ring[tail++ % NoteSet::kMaxHeld];
+      ops[i] = {false, (int16_t)(k >> 7), (int16_t)(k & 0x7F)};
+    }
+  }
+}
+
+template <typename T>
+static double nanosPerOp(uint8_t priority, long* checksum) {
+  T set;
+  const int rounds = 64;
+  auto start = Clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < kOps; i++) {
+      const Op& op = ops[i];
+      if (op.on)
+        set.push(op.channel, op.note, 100);
+      else
+        set.remove(op.channel, op.note);
+      *checksum += set.top(priority).note;
+    }
+  }
+  double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  return ns / ((double)rounds * kOps);
+}
+
+static void runSets(const char* name, int held, int channels) {
+  makeChurn(held, channels);
+  long checksum = 0;
+  double stack = nanosPerOp<NoteStack>(kPriorityLast, &checksum);
+  double last = nanosPerOp<NoteSet>(kPriorityLast, &checksum);
+  double low = nanosPerOp<NoteSet>(kPriorityLowest, &checksum);
+  double high = nanosPerOp<NoteSet>(kPriorityHighest, &checksum);
+  printf("%-18s  stack %6.2f ns   set last %6.2f  lowest %6.2f  highest %6.2f  (%ld)\n",
+         name,
+         stack,
+         last,
+         low,
+         high,
+         checksum & 0xFF);
+}
+
+static void runEngine(const char* name, int held) {
+  makeChurn(held, 1);
+  MidiEngine engine;
+  for (int g = 0; g < kNumGates; g++) {
+    engine.setGateNote(g, -1);
+    engine.setDacMode(g, kDacPitch);
+    engine.setNotePriority(g, (uint8_t)(g % kPriorityCount));
+  }
+  const int rounds = 16;
+  long checksum = 0;
+  auto start = Clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < kOps; i++) {
+      const Op& op = ops[i];
+      if (op.on)
+        engine.noteOn(op.channel, op.note, 0.8f);
+      else
+        engine.noteOff(op.channel, op.note);
+      checksum += engine.dacValues()[0];
+    }
+  }
+  double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  printf("%-18s  %6.1f ns per event  (%ld)\n", name, ns / ((double)rounds * kOps), checksum & 0xFF);
+}
+
+int main() {
+  srand(1);
+  printf("Note tracking per push/remove + top() (ns)\n\n");
+  runSets("mono, 1 held", 1, 1);
+  runSets("chord, 4 held", 4, 1);
+  runSets("pad, 12 held", 12, 2);
+  runSets("full, 16 held", 16, 4);
+  runSets("64 held (drops)", 64, 16);
+
+  printf("\nMidiEngine noteOn/noteOff, 8 omni pitch gates\n\n");
+  runEngine("chord, 4 held", 4);
+  runEngine("full, 16 held", 16);
+  return 0;
+}
@@ -0,0 +1,57 @@
+#include "../source/block_clock.h"
+#include <cassert>
+#include <cstdio>
+
+using namespace tram8;
+
+static void test_offsets_follow_sample_rate() {
+  BlockClock clock;
+  clock.begin(true, 5000000000ll, 5000000000ull, 48000.0);
+  assert(clock.at(0) == 5000000000ull);
+  assert(clock.at(48) == 5001000000ull); // 1 ms
+  assert(clock.at(1024) == 5000000000ull + 21333333ull);
+  printf("offsets_follow_sample_rate passed\n");
+}
+
+static void test_host_time_preferred() {
+  BlockClock clock;
+  // hosts usually process ahead of the block's playback time
+  clock.begin(true, 2010000000ll, 2000000000ull, 44100.0);
+  assert(clock.start() == 2010000000ull);
+  clock.begin(true, 1990000000ll, 2000000000ull, 44100.0);
+  assert(clock.start() == 1990000000ull);
+  printf("host_time_preferred passed\n");
+}
+
+static void test_falls_back_to_now() {
+  BlockClock clock;
+  clock.begin(false, 0, 7000000000ull, 44100.0);
+  assert(clock.start() == 7000000000ull);
+  assert(clock.at(441) == 7010000000ull);
+
+  // a system time on some other clock is ignored
+  clock.begin(true, 123, 7000000000ull, 44100.0);
+  assert(clock.start() == 7000000000ull);
+  clock.begin(true, 7000000000ll + (int64_t)BlockClock::kMaxSkewNanos + 1, 7000000000ull, 44100.0);
+  assert(clock.start() == 7000000000ull);
+  printf("falls_back_to_now passed\n");
+}
+
+static void test_bad_offsets() {
+  BlockClock clock;
+  clock.begin(true, 3000000000ll, 3000000000ull, 96000.0);
+  assert(clock.at(-5) == 3000000000ull);
+
+  clock.begin(true, 3000000000ll, 3000000000ull, 0.0);
+  assert(clock.at(512) == 3000000000ull);
+  printf("bad_offsets passed\n");
+}
+
+int main() {
+  test_offsets_follow_sample_rate();
+  test_host_time_preferred();
+  test_falls_back_to_now();
+  test_bad_offsets();
+  printf("\nAll block clock tests passed!\n");
+  return 0;
+}
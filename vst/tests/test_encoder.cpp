@@ -0,0 +1,283 @@
+#include "../source/encoder.h"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace tram8;
+
+// Mirrors the firmware SysEx-mode decoder: frames and channel voice messages
+// interleaved. Running status is rejected: CoreMIDI packets may not use it.
+struct HardwareModel {
+  uint8_t gates = 0;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  uint8_t running = 0;
+  uint8_t data[2] = {};
+  int have = 0;
+  uint8_t syx[TRAM8_LEN_MAX] = {};
+  int syxLen = -1;
+
+  void feed(const uint8_t* bytes, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++)
+      feedByte(bytes[i]);
+  }
+
+  void feedByte(uint8_t b) {
+    if (b == TRAM8_SYSEX_START) {
+      syxLen = 0;
+      syx[syxLen++] = b;
+      running = 0;
+      return;
+    }
+    if (syxLen >= 0) {
+      assert(syxLen < TRAM8_LEN_MAX);
+      syx[syxLen++] = b;
+      if (b == TRAM8_SYSEX_END) {
+        uint8_t gateMask, dacMask;
+        uint16_t values[TRAM8_NUM_GATES];
+        tram8_form_t form;
+        assert(tram8_parse(syx, (uint8_t)syxLen, &gateMask, values, &dacMask, &form) == 0);
+        gates = gateMask;
+        for (int ch = 0; ch < TRAM8_NUM_GATES; ch++) {
+          if ((dacMask >> ch) & 1)
+            dac[ch] = values[ch];
+        }
+        syxLen = -1;
+      }
+      return;
+    }
+    if (b & 0x80) {
+      running = b;
+      have = 0;
+      return;
+    }
+    assert(running != 0);
+    data[have++] = b;
+    if (have < 2)
+      return;
+    have = 0;
+    uint8_t status = running;
+    running = 0;
+    if ((status & 0xF0) == TRAM8_CV_BEND) {
+      dac[status & 0x0F] = tram8_bend_to_dac(data[0], data[1]);
+    } else {
+      assert(status == (TRAM8_CV_NOTE_ON | TRAM8_CV_GATE_CHANNEL));
+      assert(data[0] < TRAM8_NUM_GATES);
+      if (data[1])
+        gates |= (1 << data[0]);
+      else
+        gates &= ~(1 << data[0]);
+    }
+  }
+};
+
+static uint32_t send(Encoder& enc, HardwareModel& hw, uint8_t gates, const uint16_t* dac, bool full = true) {
+  uint8_t buf[Encoder::kMaxBytes];
+  uint32_t len = enc.encode(gates, dac, full, buf);
+  assert(len <= (uint32_t)Encoder::kMaxBytes);
+  hw.feed(buf, len);
+  enc.commit();
+  return len;
+}
+
+static void test_first_send_is_absolute() {
+  Encoder enc;
+  HardwareModel hw;
+  hw.gates = 0xFF;
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    hw.dac[ch] = 1234;
+
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  uint32_t len = send(enc, hw, 0x00, dac);
+  assert(enc.encoding() == kEncFull);
+  assert(len == TRAM8_LEN_FULL);
+  assert(hw.gates == 0x00);
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    assert(hw.dac[ch] == 0);
+
+  printf("first_send_is_absolute passed\n");
+}
+
+static void test_single_gate_uses_note() {
+  Encoder enc;
+  HardwareModel hw;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  send(enc, hw, 0x00, dac);
+
+  assert(send(enc, hw, 0x01, dac) == 3);
+  assert(enc.encoding() == kEncVoice);
+  assert(hw.gates == 0x01);
+
+  // no running status: the next change pays for its status byte again
+  assert(send(enc, hw, 0x00, dac) == 3);
+  assert(hw.gates == 0x00);
+
+  printf("single_gate_uses_note passed\n");
+}
+
+static void test_single_dac_uses_bend() {
+  Encoder enc;
+  HardwareModel hw;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  send(enc, hw, 0x00, dac);
+
+  dac[3] = 0xABC;
+  assert(send(enc, hw, 0x00, dac) == 3);
+  assert(enc.encoding() == kEncVoice);
+  assert(hw.dac[3] == 0xABC);
+
+  printf("single_dac_uses_bend passed\n");
+}
+
+static void test_many_dacs_use_sysex() {
+  Encoder enc;
+  HardwareModel hw;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  send(enc, hw, 0x00, dac);
+
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    dac[ch] = (uint16_t)(100 * ch + 7);
+  assert(send(enc, hw, 0xFF, dac) == TRAM8_LEN_FULL);
+  assert(enc.encoding() == kEncFull);
+
+  // 4 bends + 3 notes would take 21 bytes; the delta frame carries gates for free
+  for (int ch = 0; ch < 4; ch++)
+    dac[ch] = (uint16_t)(dac[ch] + 1);
+  uint32_t len = send(enc, hw, 0xF8, dac);
+  assert(enc.encoding() == kEncDelta);
+  assert(len == tram8_delta_len(0x0F));
+
+  assert(hw.gates == 0xF8);
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    assert(hw.dac[ch] == dac[ch]);
+
+  printf("many_dacs_use_sysex passed\n");
+}
+
+static void test_coarse_allowed_without_pitch() {
+  Encoder enc;
+  HardwareModel hw;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  assert(send(enc, hw, 0x00, dac, false) == TRAM8_LEN_COARSE);
+  assert(enc.encoding() == kEncCoarse);
+
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    dac[ch] = (uint16_t)(ch * 3) << 5;
+  assert(send(enc, hw, 0x00, dac, false) == TRAM8_LEN_COARSE);
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    assert(hw.dac[ch] == dac[ch]);
+
+  printf("coarse_allowed_without_pitch passed\n");
+}
+
+static void test_unchanged_sends_nothing() {
+  Encoder enc;
+  HardwareModel hw;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  send(enc, hw, 0x05, dac);
+
+  uint8_t buf[Encoder::kMaxBytes];
+  assert(enc.encode(0x05, dac, true, buf) == 0);
+
+  printf("unchanged_sends_nothing passed\n");
+}
+
+static void test_uncommitted_encode_is_retried() {
+  Encoder enc;
+  HardwareModel hw;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  send(enc, hw, 0x00, dac);
+
+  // Dropped send: the same change must be encoded again
+  uint8_t buf[Encoder::kMaxBytes];
+  assert(enc.encode(0x02, dac, true, buf) == 3);
+  assert(enc.encode(0x02, dac, true, buf) == 3);
+  hw.feed(buf, 3);
+  enc.commit();
+  assert(hw.gates == 0x02);
+
+  printf("uncommitted_encode_is_retried passed\n");
+}
+
+static void test_resync_forces_absolute() {
+  Encoder enc;
+  HardwareModel hw;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  send(enc, hw, 0x00, dac);
+
+  enc.resync();
+  uint8_t buf[Encoder::kMaxBytes];
+  assert(enc.encode(0x00, dac, true, buf) == TRAM8_LEN_FULL);
+
+  printf("resync_forces_absolute passed\n");
+}
+
+static void test_dac_mask_holds_channels() {
+  Encoder enc;
+  HardwareModel hw;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  send(enc, hw, 0x00, dac);
+
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    dac[ch] = (uint16_t)(100 + ch);
+  uint8_t buf[Encoder::kMaxBytes];
+  uint32_t len = enc.encode(0x01, dac, true, buf, 0x01);
+  assert(enc.encoding() == kEncVoice);
+  assert(len == 6); // one bend, one note
+  hw.feed(buf, len);
+  enc.commit();
+  assert(hw.gates == 0x01);
+  assert(hw.dac[0] == 100);
+  assert(hw.dac[1] == 0);
+
+  // The held channels are still owed
+  len = enc.encode(0x01, dac, true, buf);
+  hw.feed(buf, len);
+  enc.commit();
+  for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+    assert(hw.dac[ch] == dac[ch]);
+
+  // An unsynced encoder ignores the mask
+  enc.resync();
+  assert(enc.encode(0x01, dac, true, buf, 0x00) == TRAM8_LEN_FULL);
+
+  printf("dac_mask_holds_channels passed\n");
+}
+
+static void test_random_states_match_hardware() {
+  Encoder enc;
+  HardwareModel hw;
+  uint16_t dac[TRAM8_NUM_GATES] = {};
+  srand(1234);
+
+  for (int step = 0; step < 10000; step++) {
+    uint8_t gates = hw.gates;
+    if (rand() % 2)
+      gates ^= (uint8_t)(1 << (rand() % TRAM8_NUM_GATES));
+    int changes = rand() % 4 == 0 ? rand() % (TRAM8_NUM_GATES + 1) : rand() % 2;
+    for (int i = 0; i < changes; i++)
+      dac[rand() % TRAM8_NUM_GATES] = (uint16_t)(rand() & TRAM8_DAC_MAX);
+
+    send(enc, hw, gates, dac);
+    assert(hw.gates == gates);
+    for (int ch = 0; ch < TRAM8_NUM_GATES; ch++)
+      assert(hw.dac[ch] == dac[ch]);
+  }
+
+  printf("random_states_match_hardware passed\n");
+}
+
+int main() {
+  test_first_send_is_absolute();
+  test_single_gate_uses_note();
+  test_single_dac_uses_bend();
+  test_many_dacs_use_sysex();
+  test_coarse_allowed_without_pitch();
+  test_unchanged_sends_nothing();
+  test_uncommitted_encode_is_retried();
+  test_resync_forces_absolute();
+  test_dac_mask_holds_channels();
+  test_random_states_match_hardware();
+  printf("\nAll encoder tests passed!\n");
+  return 0;
+}
@@ -1,68 +1,174 @@
 #include "../source/midi_engine.h"
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
 using namespace tram8;
 
-static void test_note_stack_push_pop() {
-  NoteStack stack;
-  assert(stack.empty());
+static void test_note_set_push_pop() {
+  NoteSet set;
+  assert(set.empty());
 
-  stack.push(0, 60, 100);
-  assert(!stack.empty());
-  assert(stack.top().note == 60);
-  assert(stack.top().velocity == 100);
+  set.push(0, 60, 100);
+  assert(!set.empty());
+  assert(set.top().note == 60);
+  assert(set.top().velocity == 100);
 
-  stack.push(0, 64, 80);
-  assert(stack.top().note == 64);
-  assert(stack.top().velocity == 80);
+  set.push(0, 64, 80);
+  assert(set.top().note == 64);
+  assert(set.top().velocity == 80);
 
-  stack.remove(0, 64);
-  assert(stack.top().note == 60);
+  set.remove(0, 64);
+  assert(set.top().note == 60);
 
-  stack.remove(0, 60);
-  assert(stack.empty());
+  set.remove(0, 60);
+  assert(set.empty());
 
-  printf("note_stack_push_pop passed\n");
+  printf("note_set_push_pop passed\n");
 }
 
-static void test_note_stack_retrigger() {
-  NoteStack stack;
-  stack.push(0, 60, 100);
-  stack.push(0, 64, 80);
-  stack.push(0, 60, 90);
+static void test_note_set_retrigger() {
+  NoteSet set;
+  set.push(0, 60, 100);
+  set.push(0, 64, 80);
+  set.push(0, 60, 90);
 
-  assert(stack.top().note == 60);
-  assert(stack.top().velocity == 90);
-  assert(stack.count == 2);
+  assert(set.top().note == 60);
+  assert(set.top().velocity == 90);
+  assert(set.count == 2);
 
-  printf("note_stack_retrigger passed\n");
+  set.remove(0, 60);
+  assert(set.top().note == 64);
+
+  printf("note_set_retrigger passed\n");
+}
+
+static void test_note_set_full_releases_oldest() {
+  NoteSet set;
+  for (int ch = 0; ch < 16; ch++) {
+    for (int n = 0; n < 128; n++)
+      set.push((int16_t)ch, (int16_t)n, (uint8_t)n);
+  }
+  // only the newest kMaxHeld keys, channel 15's, are still held
+  assert(set.count == NoteSet::kMaxHeld);
+  assert(set.top().note == 127);
+  assert(set.top().channel == 15);
+  assert(set.top(kPriorityLowest).channel == 15);
+  assert(set.top(kPriorityLowest).note == 0);
+  assert(set.top(kPriorityLowest).velocity == 0);
+
+  set.remove(0, 5); // long gone
+  assert(set.count == NoteSet::kMaxHeld);
+
+  // a retrigger moves a key to the newest end, so it outlives the others
+  set.push(15, 0, 99);
+  set.push(0, 0, 1);
+  assert(set.count == NoteSet::kMaxHeld);
+  assert(set.top(kPriorityLowest).channel == 0); // 15:0 and 0:0 both held
+  set.remove(0, 0);
+  assert(set.top(kPriorityLowest).channel == 15);
+  assert(set.top(kPriorityLowest).velocity == 99);
+  assert(set.top(kPriorityHighest).note == 127);
+
+  for (int n = 0; n < 128; n++)
+    set.remove(15, (int16_t)n);
+  assert(set.empty());
+
+  printf("note_set_full_releases_oldest passed\n");
+}
+
+static void test_note_set_channel_isolation() {
+  NoteSet set;
+  set.push(0, 60, 100);
+  set.push(1, 60, 80);
+  assert(set.count == 2);
+
+  set.remove(0, 60);
+  assert(set.count == 1);
+  assert(set.top().channel == 1);
+  assert(set.top().note == 60);
+
+  // A release on a channel that never pressed it changes nothing
+  set.remove(2, 60);
+  assert(set.count == 1);
+
+  printf("note_set_channel_isolation passed\n");
 }
 
-static void test_note_stack_overflow() {
-  NoteStack stack;
-  for (int i = 0; i < NoteStack::kMaxNotes + 4; i++)
-    stack.push(0, i, 64);
+static void test_note_set_priorities() {
+  NoteSet set;
+  set.push(0, 64, 10);
+  set.push(0, 0, 20);
+  set.push(0, 127, 30);
+  set.push(0, 63, 40);
+
+  assert(set.top(kPriorityLast).note == 63);
+  assert(set.top(kPriorityLowest).note == 0);
+  assert(set.top(kPriorityLowest).velocity == 20);
+  assert(set.top(kPriorityHighest).note == 127);
 
-  assert(stack.count == NoteStack::kMaxNotes);
-  assert(stack.top().note == NoteStack::kMaxNotes - 1);
+  set.remove(0, 0);
+  set.remove(0, 127);
+  assert(set.top(kPriorityLowest).note == 63);
+  assert(set.top(kPriorityHighest).note == 64);
 
-  printf("note_stack_overflow passed\n");
+  set.remove(0, 63);
+  assert(set.top(kPriorityLowest).note == 64);
+  assert(set.top(kPriorityLast).note == 64);
+
+  set.remove(0, 64);
+  set.push(0, 5, 1);
+  assert(set.top(kPriorityHighest).note == 5);
+
+  printf("note_set_priorities passed\n");
 }
 
-static void test_note_stack_channel_isolation() {
-  NoteStack stack;
-  stack.push(0, 60, 100);
-  stack.push(1, 60, 80);
-  assert(stack.count == 2);
+static void erase(int* order, int& size, int key) {
+  for (int i = 0; i < size; i++) {
+    if (order[i] == key) {
+      memmove(&order[i], &order[i + 1], (size - i - 1) * sizeof(int));
+      size--;
+      return;
+    }
+  }
+}
 
-  stack.remove(0, 60);
-  assert(stack.count == 1);
-  assert(stack.top().channel == 1);
-  assert(stack.top().note == 60);
+// Against a plain list of (channel, note) keys in press order
+static void test_note_set_random_matches_model() {
+  NoteSet set;
+  int order[3 * 24]; // every key the loop can press
+  int size = 0;
+  srand(7);
+  for (int step = 0; step < 20000; step++) {
+    int ch = rand() % 3;
+    int n = 40 + rand() % 24;
+    int key = ch << 7 | n;
+    erase(order, size, key);
+    if (rand() % 2) {
+      set.push((int16_t)ch, (int16_t)n, (uint8_t)(step & 0x7F));
+      order[size++] = key;
+    } else {
+      set.remove((int16_t)ch, (int16_t)n);
+    }
+
+    assert(set.count == size);
+    if (size == 0)
+      continue;
+    int lo = 127, hi = 0;
+    for (int i = 0; i < size; i++) {
+      int note = order[i] & 0x7F;
+      lo = note < lo ? note : lo;
+      hi = note > hi ? note : hi;
+    }
+    NoteEntry last = set.top(kPriorityLast);
+    assert(last.note == (order[size - 1] & 0x7F));
+    assert(last.channel == (order[size - 1] >> 7));
+    assert(set.top(kPriorityLowest).note == lo);
+    assert(set.top(kPriorityHighest).note == hi);
+  }
 
-  printf("note_stack_channel_isolation passed\n");
+  printf("note_set_random_matches_model passed\n");
 }
 
 static void test_velocity_mode() {
@@ -168,6 +274,57 @@ static void test_last_note_priority() {
   printf("last_note_priority passed\n");
 }
 
+static void test_low_high_note_priority() {
+  MidiEngine engine;
+  engine.setGateChannel(0, -1);
+  engine.setGateNote(0, -1);
+  engine.setDacMode(0, kDacPitch);
+  engine.setDacChannel(0, -1);
+  engine.setNotePriority(0, kPriorityLowest);
+
+  engine.noteOn(0, 48, 0.8f);
+  uint16_t pitch48 = engine.dacValues()[0];
+  engine.noteOn(0, 55, 0.8f);
+  assert(engine.dacValues()[0] == pitch48);
+  engine.noteOn(0, 36, 0.8f);
+  uint16_t pitch36 = engine.dacValues()[0];
+  assert(pitch36 < pitch48);
+
+  // Switching priority with notes held retunes at once
+  engine.setNotePriority(0, kPriorityHighest);
+  uint16_t pitch55 = engine.dacValues()[0];
+  assert(pitch55 > pitch48);
+
+  engine.noteOff(0, 55);
+  assert(engine.dacValues()[0] == pitch48);
+  engine.noteOff(0, 48);
+  assert(engine.dacValues()[0] == pitch36);
+  assert(engine.gateMask() & 1);
+  engine.noteOff(0, 36);
+  assert(!(engine.gateMask() & 1));
+
+  engine.setNotePriority(0, 99);
+  int32_t buf[MidiEngine::kStateWords];
+  engine.serialize(buf);
+  assert(buf[kNumGates * MidiEngine::kStateWordsPerGate] == kPriorityLast);
+
+  printf("low_high_note_priority passed\n");
+}
+
+static void test_out_of_range_notes_ignored() {
+  MidiEngine engine;
+  engine.setGateChannel(0, -1);
+  engine.setGateNote(0, -1);
+
+  engine.noteOn(0, 128, 0.8f);
+  engine.noteOn(16, 60, 0.8f);
+  engine.noteOn(-1, 60, 0.8f);
+  assert(engine.gateMask() == 0);
+  engine.noteOff(0, -5);
+
+  printf("out_of_range_notes_ignored passed\n");
+}
+
 static void test_cc_mode() {
   MidiEngine engine;
   engine.setGateChannel(0, -1);
@@ -275,6 +432,56 @@ static void test_dac_changed() {
   printf("dac_changed passed\n");
 }
 
+static void test_dac_changed_mask() {
+  MidiEngine engine;
+  engine.setDacMode(0, kDacPitch);
+  engine.setDacMode(1, kDacVelocity);
+  engine.setDacChannel(0, 0);
+  engine.setDacChannel(1, 0);
+  for (int g = 2; g < kNumGates; g++)
+    engine.setDacChannel(g, 5);
+
+  assert(engine.dacChangedMask() == 0);
+
+  engine.noteOn(0, 48, 0.5f);
+  assert(engine.dacChangedMask() == 0x03);
+
+  engine.markSent();
+  assert(engine.dacChangedMask() == 0);
+
+  engine.noteOn(0, 48, 1.0f);
+  assert(engine.dacChangedMask() == 0x02);
+
+  printf("dac_changed_mask passed\n");
+}
+
+static void test_partial_mark_sent() {
+  MidiEngine engine;
+  engine.setGateChannel(0, -1);
+  engine.setGateNote(0, 60);
+  engine.setDacMode(0, kDacVelocity);
+  engine.setDacChannel(0, -1);
+  engine.setDacMode(1, kDacVelocity);
+  engine.setDacChannel(1, 0);
+  for (int g = 2; g < kNumGates; g++)
+    engine.setDacChannel(g, 5);
+
+  engine.noteOn(0, 60, 0.8f);
+  assert(engine.gateEdges() == 0x01);
+  assert(engine.dacChangedMask() == 0x03);
+
+  // Only the edge gate's DAC went out; the other stays pending
+  engine.markSent(engine.gateEdges());
+  assert(engine.gateEdges() == 0);
+  assert(engine.dacChangedMask() == 0x02);
+  assert(engine.stateChanged());
+
+  engine.markSent();
+  assert(!engine.stateChanged());
+
+  printf("partial_mark_sent passed\n");
+}
+
 static void test_has_pitch_mode() {
   MidiEngine engine;
   assert(!engine.hasPitchMode());
@@ -295,14 +502,16 @@ static void test_serialize_deserialize() {
   engine.setDacMode(0, kDacPitch);
   engine.setDacChannel(0, 3);
   engine.setCcNum(0, 42);
+  engine.setNotePriority(3, kPriorityHighest);
 
-  int32_t buf[kNumGates * MidiEngine::kStateWordsPerGate];
+  int32_t buf[MidiEngine::kStateWords];
   engine.serialize(buf);
+  assert(buf[kNumGates * MidiEngine::kStateWordsPerGate + 3] == kPriorityHighest);
 
   MidiEngine engine2;
   engine2.deserialize(buf);
 
-  int32_t buf2[kNumGates * MidiEngine::kStateWordsPerGate];
+  int32_t buf2[MidiEngine::kStateWords];
   engine2.serialize(buf2);
 
   assert(memcmp(buf, buf2, sizeof(buf)) == 0);
@@ -310,6 +519,42 @@ static void test_serialize_deserialize() {
   printf("serialize_deserialize passed\n");
 }
 
+// A state saved before note priorities ends after the gate words: whatever
+// the engine held, priorities come back as last-note
+static void test_read_state_without_priorities() {
+  MidiEngine saved;
+  saved.setGateChannel(2, 9);
+  saved.setDacMode(4, kDacPitch);
+  saved.setCcNum(5, 74);
+  int32_t words[MidiEngine::kStateWords];
+  saved.serialize(words);
+  const int oldWords = kNumGates * MidiEngine::kStateWordsPerGate;
+
+  MidiEngine engine;
+  engine.setNotePriority(3, kPriorityHighest);
+  int pos = 0;
+  engine.readState([&](int32_t& word) {
+    if (pos == oldWords)
+      return false; // end of the stream
+    word = words[pos++];
+    return true;
+  });
+  assert(pos == oldWords);
+
+  int32_t buf[MidiEngine::kStateWords];
+  engine.serialize(buf);
+  assert(memcmp(buf, words, oldWords * sizeof(int32_t)) == 0);
+  for (int i = 0; i < kNumGates; i++)
+    assert(buf[oldWords + i] == kPriorityLast);
+
+  // an empty state leaves the gates alone
+  engine.readState([](int32_t&) { return false; });
+  engine.serialize(buf);
+  assert(memcmp(buf, words, oldWords * sizeof(int32_t)) == 0);
+
+  printf("read_state_without_priorities passed\n");
+}
+
 static void test_reset() {
   MidiEngine engine;
   engine.setGateChannel(0, -1);
@@ -773,7 +1018,7 @@ static void test_deserialize_clears_runtime() {
   assert(engine.gateMask() & 1);
   assert(engine.dacValues()[0] > 0);
 
-  int32_t buf[kNumGates * MidiEngine::kStateWordsPerGate];
+  int32_t buf[MidiEngine::kStateWords];
   MidiEngine defaults;
   defaults.serialize(buf);
 
@@ -820,15 +1065,15 @@ static void test_dac_channel_change_zeros_pitch() {
   printf("dac_channel_change_zeros_pitch passed\n");
 }
 
-static void test_note_stack_top_empty() {
-  NoteStack stack;
-  assert(stack.empty());
-  const NoteEntry& e = stack.top();
+static void test_note_set_top_empty() {
+  NoteSet set;
+  assert(set.empty());
+  NoteEntry e = set.top(kPriorityHighest);
   assert(e.note == 0);
   assert(e.velocity == 0);
   assert(e.channel == 0);
 
-  printf("note_stack_top_empty passed\n");
+  printf("note_set_top_empty passed\n");
 }
 
 static void test_cc_updates_without_active_note() {
@@ -904,24 +1149,31 @@ static void test_out_of_bounds_gate_ignored() {
 }
 
 int main() {
-  test_note_stack_top_empty();
-  test_note_stack_push_pop();
-  test_note_stack_retrigger();
-  test_note_stack_overflow();
-  test_note_stack_channel_isolation();
+  test_note_set_top_empty();
+  test_note_set_push_pop();
+  test_note_set_retrigger();
+  test_note_set_full_releases_oldest();
+  test_note_set_channel_isolation();
+  test_note_set_priorities();
+  test_note_set_random_matches_model();
   test_velocity_mode();
   test_velocity_zero_as_note_off();
   test_pitch_mode();
   test_pitch_hold_on_note_off();
   test_last_note_priority();
+  test_low_high_note_priority();
+  test_out_of_range_notes_ignored();
   test_cc_mode();
   test_gate_note_filter();
   test_gate_channel_filter();
   test_dac_independence();
   test_state_changed();
   test_dac_changed();
+  test_dac_changed_mask();
+  test_partial_mark_sent();
   test_has_pitch_mode();
   test_serialize_deserialize();
+  test_read_state_without_priorities();
   test_reset();
   test_multi_gate();
   test_dac_off_mode();
@@ -0,0 +1,162 @@
+#include "../source/midi_sender.h"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace tram8;
+
+// Records what reached the sink; fail makes the next call refuse its batch
+struct Wire {
+  std::vector<uint8_t> bytes;
+  std::vector<uint64_t> times;
+  std::vector<uint32_t> batches;
+  bool fail = false;
+
+  MidiSender::Sink sink() {
+    return [this](const Frame* const* frames, uint32_t count) {
+      if (fail)
+        return false;
+      batches.push_back(count);
+      for (uint32_t i = 0; i < count; i++) {
+        bytes.insert(bytes.end(), frames[i]->bytes, frames[i]->bytes + frames[i]->length);
+        times.push_back(frames[i]->hostNanos);
+      }
+      return true;
+    };
+  }
+};
+
+static uint64_t fakeNow = 1000000000ull;
+
+static MidiSender::Clock fakeClock() {
+  return [] { return fakeNow; };
+}
+
+static void push(FrameQueue& q, uint8_t b, uint64_t t) {
+  uint8_t frame[3] = {0x90, b, 0x7F};
+  assert(q.push(frame, 3, t));
+}
+
+static void test_queue_order_and_full() {
+  FrameQueue q;
+  assert(q.peek(0) == nullptr);
+  for (uint32_t i = 0; i < FrameQueue::kCapacity; i++)
+    push(q, (uint8_t)i, fakeNow + i);
+  uint8_t extra[1] = {0xF8};
+  assert(!q.push(extra, 1, fakeNow));
+  assert(q.size() == FrameQueue::kCapacity);
+
+  assert(q.peek(0)->bytes[1] == 0);
+  assert(q.peek(5)->bytes[1] == 5);
+  assert(q.peek(FrameQueue::kCapacity) == nullptr);
+  q.pop(2);
+  assert(q.peek(0)->bytes[1] == 2);
+  assert(q.push(extra, 1, fakeNow));
+
+  uint8_t big[Encoder::kMaxBytes + 1] = {};
+  q.pop(q.size());
+  assert(!q.push(big, sizeof(big), fakeNow));
+  assert(q.size() == 0);
+  printf("queue_order_and_full passed\n");
+}
+
+static void test_batches_in_order() {
+  FrameQueue q;
+  Wire wire;
+  MidiSender sender(q, wire.sink(), fakeClock());
+  for (uint32_t i = 0; i < MidiSender::kMaxBatch + 4; i++)
+    push(q, (uint8_t)i, fakeNow + i);
+
+  assert(sender.service() == MidiSender::kMaxBatch);
+  assert(sender.service() == 4);
+  assert(sender.service() == 0);
+  assert(wire.batches.size() == 2);
+  for (uint32_t i = 0; i < MidiSender::kMaxBatch + 4; i++) {
+    assert(wire.bytes[i * 3 + 1] == i);
+    assert(wire.times[i] == fakeNow + i);
+  }
+  assert(sender.sent() == MidiSender::kMaxBatch + 4);
+  assert(!sender.resyncPending());
+  printf("batches_in_order passed\n");
+}
+
+static void test_stale_backlog_resyncs() {
+  FrameQueue q;
+  Wire wire;
+  MidiSender sender(q, wire.sink(), fakeClock());
+  push(q, 1, fakeNow - MidiSender::kStaleNanos - 1);
+  push(q, 2, fakeNow); // a diff against the stale one, so it goes too
+
+  assert(sender.service() == 0);
+  assert(q.size() == 0);
+  assert(wire.bytes.empty());
+  assert(sender.dropped() == 2);
+  assert(sender.resyncPending());
+  assert(sender.takeResync());
+  assert(!sender.takeResync());
+
+  // due just inside the window still goes out
+  push(q, 3, fakeNow - MidiSender::kStaleNanos);
+  assert(sender.service() == 1);
+  printf("stale_backlog_resyncs passed\n");
+}
+
+static void test_sink_failure_resyncs() {
+  FrameQueue q;
+  Wire wire;
+  MidiSender sender(q, wire.sink(), fakeClock());
+  push(q, 1, fakeNow);
+  push(q, 2, fakeNow);
+  wire.fail = true;
+  assert(sender.service() == 0);
+  assert(q.size() == 0);
+  assert(sender.dropped() == 2);
+  assert(sender.takeResync());
+
+  wire.fail = false;
+  push(q, 3, fakeNow);
+  assert(sender.service() == 1);
+  assert(wire.bytes.size() == 3 && wire.bytes[1] == 3);
+  printf("sink_failure_resyncs passed\n");
+}
+
+// A producer pushing as fast as it can against the real thread: nothing is
+// lost or reordered, and a full queue only ever makes push() return false
+static void test_threaded_order() {
+  FrameQueue q;
+  Wire wire;
+  MidiSender sender(
+      q, wire.sink(), [] { return (uint64_t)0; }); // nothing goes stale
+  sender.start();
+
+  const uint32_t total = 20000;
+  uint32_t next = 0;
+  while (next < total) {
+    uint8_t frame[4] = {0xF0, (uint8_t)(next & 0x7F), (uint8_t)((next >> 7) & 0x7F), 0xF7};
+    if (q.push(frame, 4, next))
+      next++;
+  }
+  while (q.size())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  sender.stop();
+
+  assert(wire.times.size() == total);
+  for (uint32_t i = 0; i < total; i++) {
+    assert(wire.times[i] == i);
+    assert(wire.bytes[i * 4 + 1] == (i & 0x7F));
+  }
+  assert(sender.dropped() == 0);
+  printf("threaded_order passed\n");
+}
+
+int main() {
+  test_queue_order_and_full();
+  test_batches_in_order();
+  test_stale_backlog_resyncs();
+  test_sink_failure_resyncs();
+  test_threaded_order();
+  printf("\nAll sender tests passed!\n");
+  return 0;
+}
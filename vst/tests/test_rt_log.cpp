@@ -0,0 +1,137 @@
+#include "../source/encoder.h"
+#include "../source/rt_log.h"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tram8;
+
+struct Lines {
+  std::vector<std::string> lines;
+  RtLog::Sink sink() {
+    return [this](const char* line) { lines.push_back(line); };
+  }
+};
+
+static const uint16_t kDac[kNumGates] = {0, 1, 2, 3, 4, 5, 6, 4095};
+
+static void test_off_records_nothing() {
+  Lines out;
+  RtLog log(out.sink());
+  assert(log.level() == kLogOff);
+  log.noteOn(1000000, 0, 60, 1.f);
+  log.send(1000000, kEncFull, 20, 0x01, kDac);
+  log.queueFull(1000000);
+  assert(log.flush() == 0);
+  assert(out.lines.empty());
+  assert(log.dropped() == 0);
+  printf("off_records_nothing passed\n");
+}
+
+static void test_levels() {
+  Lines out;
+  RtLog log(out.sink());
+  log.setLevel(kLogSends);
+  log.noteOn(1000000, 0, 60, 1.f);
+  log.noteOff(2000000, 0, 60);
+  log.send(3000000, kEncDelta, 5, 0x81, kDac);
+  log.queueFull(4000000);
+  log.deferred(5000000, 12345678);
+  assert(log.flush() == 3);
+  assert(out.lines[0] == "[3.000] send [delta 5B] gates=0x81 dac=[0 1 2 3 4 5 6 4095]");
+  assert(out.lines[1].find("[4.000] send queue full") == 0);
+  assert(out.lines[2].find("[5.000] wire 12.3 ms behind") == 0);
+
+  out.lines.clear();
+  log.setLevel(kLogEvents);
+  log.noteOn(1500000, 9, 36, 0.5f);
+  log.noteOff(2500000, 9, 36);
+  assert(log.flush() == 2);
+  assert(out.lines[0] == "[1.500] note on: ch=9 note=36 vel=0.504");
+  assert(out.lines[1] == "[2.500] note off: ch=9 note=36");
+
+  log.setLevel(-1);
+  assert(log.level() == kLogOff);
+  log.setLevel(99);
+  assert(log.level() == kLogEvents);
+  printf("levels passed\n");
+}
+
+static void test_full_ring_counts_drops() {
+  Lines out;
+  RtLog log(out.sink());
+  log.setLevel(kLogEvents);
+  for (uint32_t i = 0; i < RtLog::kCapacity + 10; i++)
+    log.noteOn(i, 0, (int16_t)(i & 0x7F), 1.f);
+  assert(log.dropped() == 10);
+
+  assert(log.flush() == RtLog::kCapacity);
+  assert(out.lines.size() == RtLog::kCapacity + 1);
+  assert(out.lines.back() == "log ring full, 10 records dropped");
+
+  // room again, and the drop report is not repeated
+  out.lines.clear();
+  log.noteOff(0, 0, 1);
+  assert(log.flush() == 1);
+  assert(out.lines.size() == 1);
+  printf("full_ring_counts_drops passed\n");
+}
+
+static void test_format_truncates() {
+  LogRecord r;
+  r.type = kLogSend;
+  r.a = 200; // out of range encoding
+  char small[16];
+  int n = RtLog::format(r, small, sizeof(small));
+  assert(n > (int)sizeof(small));
+  assert(strlen(small) == sizeof(small) - 1);
+
+  char line[RtLog::kLineSize];
+  RtLog::format(r, line, sizeof(line));
+  assert(strstr(line, "send [? 0B]"));
+  printf("format_truncates passed\n");
+}
+
+// The writer thread drains a producer that never waits: every record either
+// arrives in order or is counted as dropped
+static void test_threaded_writer() {
+  Lines out;
+  RtLog log(out.sink());
+  log.setLevel(kLogEvents);
+  log.start();
+
+  const uint32_t total = 20000;
+  for (uint32_t i = 0; i < total; i++) {
+    log.noteOn(i * 1000000ull, 0, 60, 1.f);
+    if ((i & 0xFF) == 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  log.stop();
+
+  uint64_t received = 0;
+  double last = -1;
+  for (const auto& line : out.lines) {
+    double ms;
+    if (sscanf(line.c_str(), "[%lf] note on", &ms) != 1)
+      continue;
+    assert(ms > last);
+    last = ms;
+    received++;
+  }
+  assert(received + log.dropped() == total);
+  printf("threaded_writer passed (%llu dropped)\n", (unsigned long long)log.dropped());
+}
+
+int main() {
+  test_off_records_nothing();
+  test_levels();
+  test_full_ring_counts_drops();
+  test_format_truncates();
+  test_threaded_writer();
+  printf("\nAll log tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include "../source/wire_budget.h"
+#include <cassert>
+#include <cstdio>
+
+using namespace tram8;
+
+static const uint64_t kMs = 1000000ull;
+
+static void test_idle_wire_has_no_backlog() {
+  WireBudget wire;
+  assert(wire.backlog(0) == 0);
+  assert(wire.backlog(123 * kMs) == 0);
+  assert(WireBudget::cost(1) == 320000ull);
+  printf("idle_wire_has_no_backlog passed\n");
+}
+
+static void test_frames_queue_behind_each_other() {
+  WireBudget wire;
+  uint64_t t = 1000 * kMs;
+  wire.commit(t, TRAM8_LEN_FULL); // 20 bytes, 6.4 ms
+  assert(wire.backlog(t) == 6400000ull);
+  wire.commit(t + kMs, TRAM8_LEN_FULL); // starts when the first ends
+  assert(wire.backlog(t + kMs) == 11800000ull);
+  assert(wire.backlogMillis(t + 2 * kMs) > 10.79 && wire.backlogMillis(t + 2 * kMs) < 10.81);
+  assert(wire.backlog(t + 20 * kMs) == 0);
+  printf("frames_queue_behind_each_other passed\n");
+}
+
+static void test_idle_gap_is_not_banked() {
+  WireBudget wire;
+  wire.commit(0, 3);
+  // a frame after the wire went idle starts at its own time
+  wire.commit(100 * kMs, 3);
+  assert(wire.backlog(100 * kMs) == WireBudget::cost(3));
+  printf("idle_gap_is_not_banked passed\n");
+}
+
+static void test_reset() {
+  WireBudget wire;
+  wire.commit(0, 100);
+  assert(wire.backlog(0) > WireBudget::kMaxBacklogNanos);
+  wire.reset();
+  assert(wire.backlog(0) == 0);
+  printf("reset passed\n");
+}
+
+// 3,125 bytes/s sustained: a steady stream at exactly the wire rate never
+// builds up, anything faster grows without bound unless the caller holds back
+static void test_sustained_rate() {
+  WireBudget wire;
+  uint64_t t = 0;
+  for (int i = 0; i < 1000; i++, t += WireBudget::cost(10))
+    wire.commit(t, 10);
+  assert(wire.backlog(t) == 0);
+
+  WireBudget over;
+  t = 0;
+  uint32_t held = 0;
+  for (int i = 0; i < 1000; i++, t += WireBudget::cost(5)) {
+    if (over.backlog(t) > WireBudget::kMaxBacklogNanos) {
+      held++;
+      continue;
+    }
+    over.commit(t, 10);
+  }
+  assert(held > 0);
+  assert(over.backlog(t) <= WireBudget::kMaxBacklogNanos + WireBudget::cost(10));
+  printf("sustained_rate passed\n");
+}
+
+int main() {
+  test_idle_wire_has_no_backlog();
+  test_frames_queue_behind_each_other();
+  test_idle_gap_is_not_banked();
+  test_reset();
+  test_sustained_rate();
+  printf("\nAll wire budget tests passed!\n");
+  return 0;
+}